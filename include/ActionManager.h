@@ -17,10 +17,17 @@
 #ifndef ACTION_MANAGER_H_
 #define ACTION_MANAGER_H_
 
-#include <queue>
 #include <pthread.h>
 #include <ctime>
+#include <cstddef>
 #include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <sstream>
+#include <atomic>
+
+#include "TimerWheel.h"
 
 /**
  *  Represents a generic request, pending actions are stored in a queue.
@@ -40,12 +47,41 @@ public:
         USER
     };
 
+    /**
+     *  Priority classes, actions of a class are executed before the actions
+     *  of the lower ones if they have different keys.
+     */
+    enum Priority
+    {
+        PRIORITY_USER    = 0, /**< Operations requested by users (API)     */
+        PRIORITY_DRIVER  = 1, /**< Driver callbacks and internal actions   */
+        PRIORITY_MONITOR = 2, /**< Monitoring updates                      */
+        PRIORITY_TIMER   = 3  /**< Timer and finalize actions              */
+    };
+
+    static const int PRIORITIES = 4;
+
+    static const char * priority_to_str(Priority p)
+    {
+        switch (p)
+        {
+            case PRIORITY_USER:    return "USER";
+            case PRIORITY_DRIVER:  return "DRIVER";
+            case PRIORITY_MONITOR: return "MONITOR";
+            case PRIORITY_TIMER:   return "TIMER";
+        }
+
+        return "";
+    }
+
     Type type() const
     {
         return _type;
     }
 
-    ActionRequest(Type __type): _type(__type){};
+    ActionRequest(Type __type): _type(__type), _time(0), _next(0){};
+
+    ActionRequest(const ActionRequest& o): _type(o._type), _time(0), _next(0){};
 
     virtual ~ActionRequest(){};
 
@@ -54,8 +90,53 @@ public:
         return new ActionRequest(_type);
     }
 
+    /**
+     *  Key used to order the actions. Actions with the same key (e.g. the VM
+     *  id) are executed in order, whatever their priority. With a pool of
+     *  workers, actions with different keys are executed in parallel.
+     *    @return the key, or -1 if the action has no key (it is executed by
+     *    the manager thread, in order with the other actions without key)
+     */
+    virtual int key() const
+    {
+        return -1;
+    }
+
+    /**
+     *  Priority class of the action. By default user actions are executed
+     *  with driver priority, timer and finalize actions with the lowest one.
+     *    @return the priority
+     */
+    virtual Priority priority() const
+    {
+        return _type == USER ? PRIORITY_DRIVER : PRIORITY_TIMER;
+    }
+
+    /**
+     *  Action requests (and the clones of the derived classes) are allocated
+     *  from a pool of blocks shared by all the managers, see ActionManager.cc
+     */
+    static void * operator new(size_t size);
+
+    static void operator delete(void * ptr, size_t size);
+
 protected:
     Type _type;
+
+private:
+    friend class ActionQueue;
+
+    friend class ActionManager;
+
+    /**
+     *  Time (ns, monotonic clock) when the action was triggered
+     */
+    long long _time;
+
+    /**
+     *  Next action in the ActionManager queue
+     */
+    std::atomic<ActionRequest *> _next;
 };
 
 /**
@@ -117,6 +198,124 @@ private:
 };
 
 
+/**
+ *  Multi-producer single-consumer queue of actions. Producers link the
+ *  actions in a lock-free list (intrusive, through ActionRequest::_next).
+ *  The consumer moves them to a FIFO queue per key, so the actions of a key
+ *  are always executed in order. Priorities apply across keys: the next
+ *  action is taken from the key whose first action has the highest priority
+ *  class. A class is not starved: after being skipped STARVATION_LIMIT times
+ *  it is served before the higher priority ones. Actions without key (-1)
+ *  share a single queue.
+ */
+class ActionQueue
+{
+public:
+    ActionQueue();
+
+    ~ActionQueue();
+
+    /**
+     *  Adds an action to the queue, and wakes up the consumer if it is waiting
+     */
+    void push(ActionRequest * ar);
+
+    /**
+     *  Gets the next action from the queue (consumer thread only)
+     *    @return the action or 0 if the queue is empty. A 0 may also be
+     *    returned while a push is in progress, a wake up follows in that case
+     */
+    ActionRequest * pop();
+
+    /**
+     *  Waits for new actions (consumer thread only)
+     *    @param ms maximum time to wait in milliseconds, -1 to wait forever
+     */
+    void wait(int ms);
+
+    /**
+     *  Checks if there are pending actions (consumer thread only)
+     *    @return true if the queue is empty
+     */
+    bool empty()
+    {
+        return num_pending == 0 && incoming_empty();
+    }
+
+private:
+    /**
+     *  Number of actions from higher priority classes executed before a
+     *  pending action of a lower priority class
+     */
+    static const unsigned int STARVATION_LIMIT = 16;
+
+    // -------------------------------------------------------------------------
+    // Lock-free list of incoming actions
+    // -------------------------------------------------------------------------
+    std::atomic<ActionRequest *> head;
+
+    ActionRequest *              tail;
+
+    ActionRequest                stub;
+
+    bool incoming_empty()
+    {
+        return tail == &stub && head.load() == &stub;
+    }
+
+    /**
+     *  Links the action at the head of the list
+     */
+    void link(ActionRequest * ar);
+
+    /**
+     *  Removes the oldest action from the list
+     */
+    ActionRequest * unlink();
+
+    // -------------------------------------------------------------------------
+    // Pending actions, consumer thread only
+    // -------------------------------------------------------------------------
+    /**
+     *  Pending actions of each key, in trigger order
+     */
+    std::unordered_map<int, std::deque<ActionRequest *> > keys;
+
+    /**
+     *  Keys with pending actions, by the priority of their first action
+     */
+    std::deque<int>              ready[ActionRequest::PRIORITIES];
+
+    /**
+     *  Number of times a class had pending actions and was not served
+     */
+    unsigned int                 skipped[ActionRequest::PRIORITIES];
+
+    size_t                       num_pending;
+
+    /**
+     *  Moves the incoming actions to the queues of their keys
+     */
+    void drain();
+
+    /**
+     *  The consumer sets this flag before sleeping; a push clears it and
+     *  wakes up the consumer through the eventfd. Actions pushed while the
+     *  consumer is busy do not need any system call.
+     */
+    std::atomic<bool>            waiting;
+
+    /**
+     *  eventfd to wake up the consumer, created the first time it needs to
+     *  wait
+     */
+    int                          efd;
+};
+
+struct ActionWorker;
+
+extern "C" void * action_worker_loop(void *arg);
+
 /**
  *  ActionManager. Provides action support for a class implementing
  *  the ActionListener interface.
@@ -147,7 +346,33 @@ public:
     }
 
     /**
-     * The calling thread will be suspended until an action is triggered.
+     *  Checks if there are pending actions in the queue. It MUST be called
+     *  from the thread running the action loop
+     *    @return true if the queue is empty
+     */
+    bool empty()
+    {
+        return actions.empty();
+    }
+
+    /**
+     *  Enables the worker pool mode. Actions with a key (see
+     *  ActionRequest::key) are executed by a pool of worker threads, actions
+     *  with the same key are always executed by the same worker and in order.
+     *  Timer, finalize and actions without key are executed by the thread
+     *  running the loop. The listener MUST be thread safe for different keys.
+     *  It has to be called before loop().
+     *    @param num number of workers, 0 or 1 to disable the pool
+     */
+    void set_workers(unsigned int num)
+    {
+        num_workers = num > 1 ? num : 0;
+    }
+
+    /**
+     * The calling thread will be suspended until an action is triggered. The
+     * periodic action is triggered by the TimerWheel, and it is scheduled
+     * again after being executed.
      *   @param timeout for the periodic action.
      *   @param timer_args arguments for the timer action
      */
@@ -202,6 +427,16 @@ public:
         loop(_timeout, trequest);
     }
 
+    /**
+     *  Prints the statistics of each priority class:
+     *    - DEPTH, pending actions
+     *    - ACTIONS, total number of executed actions
+     *    - WAIT_AVG, average time (us) from trigger to execution
+     *    - WAIT_MAX, maximum wait time (us) since the last call
+     *    @param oss the output stream
+     */
+    void to_xml(std::ostringstream& oss);
+
     /**
      *   Register the calling object in this action manager.
      *      @param listener a pointer to the action listner
@@ -212,39 +447,94 @@ public:
     };
 
 private:
+    friend void * action_worker_loop(void *arg);
+
     /**
-     *  Queue of pending actions, processed in a FIFO manner
+     *  Pending actions
      */
-    std::queue<ActionRequest *> actions;
+    ActionQueue                 actions;
 
     /**
-     *  Action synchronization is implemented using the pthread library,
-     *  with condition variable and its associated mutex
+     *  Number of trigger calls in progress. The manager waits for them before
+     *  being destroyed (e.g. a SyncRequest is freed after being notified).
      */
-    pthread_mutex_t mutex;
-    pthread_cond_t  cond;
+    std::atomic<int>            triggers;
 
     /**
      *  The listener notified by this manager
      */
-    ActionListener * listener;
+    ActionListener *            listener;
 
     /**
-     *  Function to lock the Manager mutex
+     *  Queue statistics of a priority class, wait times in ns
      */
-    void lock()
+    struct PriorityStats
     {
-        pthread_mutex_lock(&mutex);
+        PriorityStats():depth(0), actions(0), wait_total(0), wait_max(0){};
+
+        std::atomic<long long> depth;
+
+        std::atomic<long long> actions;
+
+        std::atomic<long long> wait_total;
+
+        std::atomic<long long> wait_max;
     };
 
+    PriorityStats               stats[ActionRequest::PRIORITIES];
+
     /**
-     *  Function to unlock the Manager mutex
+     *  Timer of the periodic action, triggers the timer request of the loop
      */
-    void unlock()
+    class ActionTimer : public Timer
     {
-        pthread_mutex_unlock(&mutex);
+    public:
+        ActionTimer():am(0), request(0){};
+
+        ActionManager *       am;
+
+        const ActionRequest * request;
+
+        void expired()
+        {
+            am->trigger(*request);
+        }
     };
 
+    ActionTimer                 tick;
+
+    /**
+     *  Worker pool, started and stopped by the action loop
+     */
+    unsigned int                num_workers;
+
+    std::vector<ActionWorker *> workers;
+
+    /**
+     *  Starts the worker threads
+     */
+    void start_workers();
+
+    /**
+     *  Stops the workers, after they execute their pending actions
+     */
+    void stop_workers();
+
+    /**
+     *  Executes an action in the manager thread or sends it to a worker
+     *    @return true if the action was sent to a worker
+     */
+    bool dispatch(ActionRequest * ar);
+
+    /**
+     *  Action loop of a worker
+     */
+    void worker_loop(ActionWorker * worker);
+
+    /**
+     *  Executes an action and updates the statistics of its priority class
+     */
+    void execute(const ActionRequest& ar);
 };
 
 #endif /*ACTION_MANAGER_H_*/
@@ -79,10 +79,7 @@ class AuthManager : public MadManager, public ActionListener
 {
 public:
 
-    AuthManager(
-        time_t                    timer,
-        vector<const VectorAttribute*>& _mads):
-            MadManager(_mads), timer_period(timer)
+    AuthManager(vector<const VectorAttribute*>& _mads):MadManager(_mads)
     {
         am.addListener(this);
     };
@@ -148,11 +145,6 @@ private:
      */
     ActionManager           am;
 
-    /**
-     *  Timer for the Manager (periocally triggers timer action)
-     */
-    time_t                  timer_period;
-
     /**
      *  Generic name for the Auth driver
      */
@@ -212,11 +204,6 @@ private:
     // -------------------------------------------------------------------------
     // Action Listener interface
     // -------------------------------------------------------------------------
-    void timer_action(const ActionRequest& ar)
-    {
-        check_time_outs_action();
-    };
-
     void finalize_action(const ActionRequest& ar)
     {
         NebulaLog::log("AuM",Log::INFO,"Stopping Authorization Manager...");
@@ -24,6 +24,10 @@
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <map>
+#include <list>
+
+#include <pthread.h>
 
 #include "NebulaLog.h"
 
@@ -85,7 +89,8 @@ public:
 		 xmlrpc_c::value * const result);
 
 	/**
-     *  Performs a xmlrpc call
+     *  Performs a xmlrpc call. Connections are taken from a pool of keep-alive
+     *  clients for the endpoint, so consecutive calls reuse the HTTP session
      *    @param endpoint of server
      *    @param method name
      *    @param plist initialized param list
@@ -110,6 +115,13 @@ public:
     void call(const std::string &method, const std::string format,
 		xmlrpc_c::value * const result, ...);
 
+    /**
+     *  Closes the pooled connections to the given endpoint, e.g. when the
+     *  server is no longer the leader of the zone
+     *    @param endpoint of server
+     */
+    static void close_connections(const std::string& endpoint);
+
 private:
     /**
      * Creates a new xml-rpc client with specified options.
@@ -131,6 +143,53 @@ private:
 	unsigned int timeout;
 
     static Client * _client;
+
+    // -------------------------------------------------------------------------
+    // Connection pool for the static call interface
+    // -------------------------------------------------------------------------
+    /**
+     *  A keep-alive xmlrpc client. The curl transport keeps the HTTP session
+     *  open between synchronous calls.
+     */
+    struct Connection
+    {
+        Connection(const std::string& endpoint, unsigned int tout):
+            transport(xmlrpc_c::clientXmlTransport_curl::constrOpt().timeout(tout)),
+            carriage(endpoint),
+            client(&transport){};
+
+        xmlrpc_c::clientXmlTransport_curl transport;
+
+        xmlrpc_c::carriageParm_curl0 carriage;
+
+        xmlrpc_c::client_xml client;
+    };
+
+    /**
+     *  Max number of idle connections kept per endpoint
+     */
+    static const unsigned int POOL_SIZE = 8;
+
+    /**
+     *  Idle connections indexed by <endpoint, timeout>
+     */
+    typedef std::pair<std::string, unsigned int> ConnectionKey;
+
+    static std::map<ConnectionKey, std::list<Connection *> > connections;
+
+    static pthread_mutex_t connections_mutex;
+
+    /**
+     *  Gets an idle connection for the endpoint or creates a new one
+     */
+    static Connection * get_connection(const ConnectionKey& key);
+
+    /**
+     *  Returns a connection to the pool
+     *    @param reuse false to close the connection (e.g. after an error)
+     */
+    static void free_connection(const ConnectionKey& key, Connection * conn,
+            bool reuse);
 };
 
 #endif /*ONECLIENT_H_*/
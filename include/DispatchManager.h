@@ -71,6 +71,14 @@ public:
         return new DMAction(*this);
     }
 
+    /**
+     *  Actions are ordered per VM
+     */
+    int key() const
+    {
+        return _vm_id;
+    }
+
 private:
     Actions _action;
 
@@ -81,10 +89,16 @@ class DispatchManager : public ActionListener
 {
 public:
 
-    DispatchManager():
+    /**
+     *    @param workers number of threads to process the actions, actions of
+     *    the same VM are processed in order
+     */
+    DispatchManager(unsigned int workers):
             hpool(0), vmpool(0), vrouterpool(0), tm(0), vmm(0), lcm(0), imagem(0)
     {
         am.addListener(this);
+
+        am.set_workers(workers);
     };
 
     ~DispatchManager(){};
@@ -114,6 +128,15 @@ public:
         am.finalize();
     }
 
+    /**
+     *  Prints the statistics of the action queue, see ActionManager::to_xml
+     *    @param oss the output stream
+     */
+    void queue_to_xml(ostringstream& oss)
+    {
+        am.to_xml(oss);
+    }
+
     /**
      *  This functions creates a new thread for the Dispatch Manager. This
      *  thread will wait in an action loop till it receives ACTION_FINALIZE.
@@ -49,21 +49,22 @@ public:
     }
 
     /**
-     *  Updates the current index in the server and applies the command to the
-     *  server. It also stores the record in the zone log [SLAVE]
-     *    @param index of the record
-     *    @param prev of index preceding this one
-     *    @param sql command to apply to DB
+     *  Updates the current index in the server and applies a batch of
+     *  consecutive records to the server in a single transaction. It also
+     *  stores the records in the zone log [SLAVE]
+     *    @param prev index preceding the first record of the batch
+     *    @param records compressed SQL commands indexed by fed_index
      *    @return 0 on success, last_index if missing records, -1 on DB error
      */
-    int apply_log_record(int index, int prev, const std::string& sql);
+    int apply_log_records(int prev, const std::map<int, std::string>& records);
 
     /**
-     *  Record was successfully replicated on zone, increase next index and
+     *  Records were successfully replicated on zone, increase next index and
      *  send any pending records.
      *    @param zone_id
+     *    @param last index replicated in the zone
      */
-    void replicate_success(int zone_id);
+    void replicate_success(int zone_id, int last);
 
     /**
      *  Record could not be replicated on zone, decrease next index and
@@ -73,7 +74,7 @@ public:
     void replicate_failure(int zone_id, int zone_last);
 
     /**
-     *  XML-RPC API call to replicate a log entry on slaves
+     *  XML-RPC API call to replicate a batch of log entries on slaves
      *     @param zone_id
      *     @param success status of API call
      *     @param last index replicate in zone slave
@@ -130,6 +131,13 @@ public:
      */
     void delete_zone(int zone_id);
 
+    /**
+     *  Return the replication status of each zone in XML format, includes
+     *  the replication lag (pending records) of the zone
+     *    @param xml document with the replication status
+     */
+    std::string& to_xml(std::string& xml);
+
     /**
      *  @return the id of fed. replica thread
      */
@@ -162,13 +170,23 @@ private:
     //   - zones list of zones in the federation with:
     //     - list of servers <id, xmlrpc endpoint>
     //     - next index to send to this zone
+    //     - replication statistics for the zone
+    //   - batch_size max number of records sent in a replicate call
+    //   - batch_bytes max size of the (compressed) records in a batch
+    //   - single_until, after a DB error in the zone the records up to this
+    //     index are sent one by one, a failing record is skipped
     // -------------------------------------------------------------------------
     static const time_t xmlrpc_timeout_ms;
 
+    static const unsigned int batch_size;
+
+    static const size_t batch_bytes;
+
     struct ZoneServers
     {
         ZoneServers(int z, unsigned int l, const std::string& s):
-            zone_id(z), endpoint(s), next(l), last(-1){};
+            zone_id(z), endpoint(s), next(l), last(-1), single_until(-1),
+            last_success(0), last_batch(0), last_rtt_ms(0), errors(0){};
 
         ~ZoneServers(){};
 
@@ -179,6 +197,16 @@ private:
         int next;
 
         int last;
+
+        int single_until;
+
+        time_t last_success;
+
+        unsigned int last_batch;
+
+        unsigned int last_rtt_ms;
+
+        unsigned int errors;
     };
 
     std::map<int, ZoneServers *> zones;
@@ -196,16 +224,36 @@ private:
     void finalize_action(const ActionRequest& ar);
 
     /**
-     *  Get the nerxt record to replicate in a zone
+     *  Get the next batch of records to replicate in a zone
      *    @param zone_id of the zone
      *    @param zedp zone endpoint
-     *    @param lr log record
+     *    @param records compressed SQL commands indexed by fed_index
      *    @param error description if any
      *
      *    @return 0 on success, -1 otherwise
      */
-    int get_next_record(int zone_id, std::string& zedp, LogDBRecord& lr,
-            std::string& error);
+    int get_next_records(int zone_id, std::string& zedp,
+            std::map<int, std::string>& records, std::string& error);
+
+    /**
+     *  Handles a DB error in a zone while applying a batch of records. The
+     *  records of the batch are sent one by one, a single failing record is
+     *  skipped.
+     *    @param zone_id of the zone
+     *    @param first index of the batch
+     *    @param last index of the batch
+     *
+     *    @return the last index replicated in the zone, -1 if unknown
+     */
+    int replicate_error(int zone_id, int first, int last);
+
+    /**
+     *  Updates the replication statistics of a zone after a replicate call
+     *    @param zone_id of the zone
+     *    @param rtt_ms duration of the call
+     *    @param error true if the call failed
+     */
+    void update_stats(int zone_id, unsigned int rtt_ms, bool error);
 
 };
 
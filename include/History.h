@@ -219,6 +219,15 @@ private:
      */
     int insert_replace(SqlDB *db, bool replace);
 
+    /**
+     *  Renders the values of the history row, as used in the INSERT or
+     *  REPLACE statements: "(vid, seq, body, stime, etime)"
+     *    @param db The SQL DB, to escape the strings
+     *    @param values of the row
+     *    @return 0 on success
+     */
+    int to_row(SqlDB *db, string& values);
+
     /**
      *  Callback function to unmarshall a history object (History::select)
      *    @param num the number of columns read from the DB
@@ -24,6 +24,7 @@
 #include "ObjectCollection.h"
 #include "NebulaLog.h"
 #include "NebulaUtil.h"
+#include "MonitorPayload.h"
 
 using namespace std;
 
@@ -59,6 +60,17 @@ public:
         OFFLINE              = 8  /**< The host is set offline, see above */
     };
 
+    /**
+     *  POLL values of a VM as last written to the DB. Used to skip the update
+     *  of the VMs whose monitoring information has not changed.
+     */
+    struct PollDigest
+    {
+        time_t last_update;
+
+        vector<pair<string, string> > values;
+    };
+
     /**
      * Function to print the Host object into a string in XML format
      *  @param xml the resulting XML string
@@ -164,16 +176,20 @@ public:
                     const string&   reserved_mem);
     /**
      * Extracts the DS attributes from the given template
-     * @param parse_str string with values to be parsed
+     * @param parse_str string with values to be parsed, text template or
+     *   binary payload
      * @param ds map of DS monitoring information
      * @param template object parsed from parse_str
+     * @param payload to decode binary information, it keeps the VM
+     *   monitoring information
      *
      * @return 0 on success
      */
     int extract_ds_info(
             string          &parse_str,
             Template        &tmpl,
-            map<int, const VectorAttribute*> &ds);
+            map<int, const VectorAttribute*> &ds,
+            MonitorPayload  &payload);
 
     /**
      * Update host after a failed monitor. It state
@@ -184,12 +200,24 @@ public:
     void error_info(const string& message, set<int> &vm_ids);
 
     /**
-     * Inserts the last monitoring, and deletes old monitoring entries.
-     *
-     * @param db pointer to the db
-     * @return 0 on success
+     *  Selects the VMs found in the last monitoring cycle whose POLL values
+     *  have not changed since they were last written: same attributes and
+     *  non-numeric values, and numeric values within the threshold. The
+     *  digests of the other VMs are updated.
+     *    @param found VMs and POLL information, as returned by update_info
+     *    @param threshold max. change (%) of the numeric values
+     *    @param refresh_time max. time (s) between updates of a VM, 0 to
+     *      update all the VMs every cycle
+     *    @param unchanged VMs that need not be updated
+     */
+    void unchanged_vms(const map<int,string>& found, float threshold,
+            time_t refresh_time, set<int>& unchanged);
+
+    /**
+     *  Gets the numeric metrics stored in the monitoring history
+     *    @param metrics of the host
      */
-    int update_monitoring(SqlDB * db);
+    void monitoring_metrics(MonitoringStore::Metrics& metrics) const;
 
     /**
      * Retrieves host state
@@ -474,6 +502,11 @@ private:
      */
     set<int> * prev_rediscovered_vms;
 
+    /**
+     * POLL values of the VMs found in the host, as last written to the DB
+     */
+    map<int, PollDigest> * vm_polls;
+
     // -------------------------------------------------------------------------
     //  VM Collection
     // -------------------------------------------------------------------------
@@ -506,8 +539,6 @@ private:
 
     static const char * table;
 
-    static const char * monit_db_names;
-
     static const char * monit_db_bootstrap;
 
     static const char * monit_table;
@@ -521,6 +552,16 @@ private:
      */
     int insert_replace(SqlDB *db, bool replace, string& error_str);
 
+    /**
+     *  Renders the values of the Host row in the pool table, as used in the
+     *  INSERT or REPLACE statements: "(oid, name, body, ...)"
+     *    @param db The SQL DB, to escape the strings
+     *    @param values of the row
+     *    @param error_str Returns the error reason, if any
+     *    @return 0 on success
+     */
+    int to_row(SqlDB *db, string& values, string& error_str);
+
     /**
      *  Bootstraps the database table(s) associated to the Host
      *    @return 0 on success
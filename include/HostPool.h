@@ -21,11 +21,13 @@
 #include "Host.h"
 
 #include <time.h>
+#include <pthread.h>
 #include <sstream>
 
 #include <iostream>
 
 #include <vector>
+#include <queue>
 
 using namespace std;
 
@@ -37,7 +39,7 @@ class HostPool : public PoolSQL
 public:
     HostPool(SqlDB * db, vector<const VectorAttribute *> hook_mads,
         const string& hook_location, const string& remotes_location,
-        time_t expire_time);
+        time_t expire_time, time_t minute_expire_time, time_t hour_expire_time);
 
     ~HostPool();
 
@@ -76,6 +78,8 @@ public:
             h->tmp_zombie_vms = &(hv->tmp_zombie_vms);
 
             h->prev_rediscovered_vms = &(hv->prev_rediscovered_vms);
+
+            h->vm_polls = &(hv->vm_polls);
         }
 
         return h;
@@ -101,6 +105,8 @@ public:
             h->tmp_zombie_vms = &(hv->tmp_zombie_vms);
 
             h->prev_rediscovered_vms = &(hv->prev_rediscovered_vms);
+
+            h->vm_polls = &(hv->vm_polls);
         }
 
         return h;
@@ -129,13 +135,31 @@ public:
     };
 
     /**
-     * Get the least monitored hosts
-     *   @param discovered hosts
-     *   @param host_limit max. number of hosts to monitor at a time
-     *   @param target_time Filters hosts with last_mon_time <= target_time
-     *   @return int 0 if success
+     *  Gets the hosts whose monitoring deadline has expired, earliest first.
+     *  The hosts are removed from the monitoring schedule, so they MUST be
+     *  scheduled again with schedule_monitor.
+     *    @param discovered_hosts ids of the hosts to be monitored
+     *    @param host_limit max. number of hosts to monitor at a time
+     *    @param now current time
+     */
+    void discover(set<int> * discovered_hosts, int host_limit, time_t now);
+
+    /**
+     *  Sets the next monitoring deadline of a host, any previous deadline of
+     *  the host is replaced.
+     *    @param oid of the host
+     *    @param deadline time to check the host again
+     */
+    void schedule_monitor(int oid, time_t deadline);
+
+    /**
+     *  Adds the hosts in the DB that are not in the monitoring schedule. The
+     *  deadline of each host is its last monitoring time plus the monitoring
+     *  period; overdue hosts are spread evenly over the next period.
+     *    @param monitor_period time between two monitoring actions
+     *    @return 0 on success
      */
-    int discover(set<int> * discovered_hosts, int host_limit, time_t target_time);
+    int init_schedule(time_t monitor_period);
 
     /**
      * Allocates a given capacity to the host
@@ -209,6 +233,8 @@ public:
         if ( rc == 0 )
         {
             delete_host_vm(host->oid);
+
+            unschedule_monitor(host->oid);
         }
 
         return rc;
@@ -247,53 +273,126 @@ public:
      *
      *  @param oss the output stream to dump the pool contents
      *  @param where filter for the objects, defaults to all
+     *  @param res resolution of the samples (raw, minute or hour rollups)
+     *  @param start_time of the samples, -1 for no limit
+     *  @param end_time of the samples, -1 for no limit
      *
      *  @return 0 on success
      */
-    int dump_monitoring(ostringstream& oss,
-                        const string&  where);
+    int dump_monitoring(ostringstream&              oss,
+                        const string&               where,
+                        MonitoringStore::Resolution res = MonitoringStore::RAW,
+                        time_t                      start_time = -1,
+                        time_t                      end_time = -1);
 
     /**
      *  Dumps the HOST monitoring information for a single HOST
      *
      *  @param oss the output stream to dump the pool contents
      *  @param hostid id of the target HOST
+     *  @param res resolution of the samples (raw, minute or hour rollups)
+     *  @param start_time of the samples, -1 for no limit
+     *  @param end_time of the samples, -1 for no limit
      *
      *  @return 0 on success
      */
-    int dump_monitoring(ostringstream& oss,
-                        int            hostid)
+    int dump_monitoring(ostringstream&              oss,
+                        int                         hostid,
+                        MonitoringStore::Resolution res = MonitoringStore::RAW,
+                        time_t                      start_time = -1,
+                        time_t                      end_time = -1)
     {
         ostringstream filter;
 
         filter << "oid = " << hostid;
 
-        return dump_monitoring(oss, filter.str());
+        return dump_monitoring(oss, filter.str(), res, start_time, end_time);
     }
 
     /**
-     * Inserts the last monitoring, and deletes old monitoring entries for this
-     * host
+     *  Updates a monitored Host. The Host is written to the DB with the next
+     *  flush of the pool batch, or right away in HA servers (no batch). The
+     *  Host SHOULD be locked.
+     *    @param host pointer to the Host
+     *
+     *    @return 0 on success.
+     */
+    int update_batch(Host * host)
+    {
+        string values;
+        string error;
+
+        if ( batch == 0 )
+        {
+            return update(host);
+        }
+
+        if ( host->to_row(db, values, error) != 0 )
+        {
+            return -1;
+        }
+
+        batch->add(Host::table, Host::db_names, host->get_oid(), values);
+
+        do_hooks(host, Hook::UPDATE);
+
+        return 0;
+    };
+
+    /**
+     *  Writes the Hosts of the pool batch to the DB
+     */
+    void flush_updates()
+    {
+        flush_batch();
+    };
+
+    /**
+     * Adds the last monitoring sample of the host to the monitoring history
      *
      * @param host pointer to the host object
      * @return 0 on success
      */
     int update_monitoring(Host * host)
+    {
+        return update_monitoring(host, host->get_last_monitored());
+    };
+
+    /**
+     * Adds the current values of the host to the monitoring history, with
+     * the given timestamp. Used for hosts that are not monitored (OFFLINE)
+     *
+     * @param host pointer to the host object
+     * @param timestamp of the sample
+     * @return 0 on success
+     */
+    int update_monitoring(Host * host, time_t timestamp)
     {
         if ( _monitor_expiration <= 0 )
         {
             return 0;
         }
 
-        return host->update_monitoring(db);
+        MonitoringStore::Metrics metrics;
+
+        host->monitoring_metrics(metrics);
+
+        return monitoring.append(host->get_oid(), timestamp, metrics);
     };
 
     /**
-     * Deletes the expired monitoring entries for all hosts
-     *
-     * @return 0 on success
+     * Writes the monitoring entries of all hosts whose time window has ended.
+     * Expired entries are deleted in the background by the store.
      */
-    int clean_expired_monitoring();
+    void write_ended_monitoring();
+
+    /**
+     * Writes the monitoring samples kept in memory to the DB
+     */
+    void flush_monitoring()
+    {
+        monitoring.flush();
+    };
 
 private:
     /**
@@ -316,6 +415,11 @@ private:
          * VMs reported as found from the poweroff state.
          */
         set<int> prev_rediscovered_vms;
+
+        /**
+         * Last POLL values written for each VM.
+         */
+        map<int, Host::PollDigest> vm_polls;
     };
 
     map<int, HostVM *> host_vms;
@@ -334,17 +438,46 @@ private:
     };
 
     /**
-     *  Callback function to get the IDs of the hosts to be monitored
-     *  (Host::discover)
+     *  Monitoring deadline of a host, ordered by time
+     */
+    typedef pair<time_t, int> Deadline;
+
+    /**
+     *  Monitoring schedule, earliest deadline first. Rescheduled or dropped
+     *  hosts leave stale entries in the queue, an entry is only valid if it
+     *  matches the deadline of the host in monitor_deadlines.
+     */
+    priority_queue<Deadline, vector<Deadline>, greater<Deadline> >
+        monitor_queue;
+
+    /**
+     *  Current monitoring deadline of each scheduled host
+     */
+    map<int, time_t> monitor_deadlines;
+
+    /**
+     *  Protects the monitoring schedule
+     */
+    pthread_mutex_t schedule_mutex;
+
+    /**
+     *  Removes a host from the monitoring schedule
+     *    @param oid of the host
+     */
+    void unschedule_monitor(int oid);
+
+    /**
+     *  Callback function to get the hosts and their last monitoring time
+     *  (HostPool::init_schedule)
      *
-     *    @param _set the set<int>* of host ids
+     *    @param _hosts the vector<Deadline>* of hosts
      *    @param num the number of columns read from the DB
      *    @param values the column values
      *    @param names the column names
      *
      *    @return 0 on success
      */
-    int discover_cb(void * _set, int num, char **values, char **names);
+    int init_schedule_cb(void * _hosts, int num, char **values, char **names);
 
     /**
      * Deletes all monitoring entries for all hosts
@@ -357,6 +490,11 @@ private:
      * Size, in seconds, of the historical monitoring information
      */
     static time_t _monitor_expiration;
+
+    /**
+     * Monitoring history of the hosts
+     */
+    MonitoringStore monitoring;
 };
 
 #endif /*HOST_POOL_H_*/
@@ -19,6 +19,7 @@
 
 #include "ObjectXML.h"
 #include "Template.h"
+#include "MonitoringStore.h"
 #include <time.h>
 #include <set>
 
@@ -352,6 +353,12 @@ public:
      */
     void update_capacity(Host *host);
 
+    /**
+     *  Gets the capacity and usage counters as monitoring metrics
+     *    @param metrics "HOST_SHARE/<COUNTER>" -> value
+     */
+    void monitoring_metrics(MonitoringStore::Metrics& metrics) const;
+
     /**
      *  Return the number of running VMs in this host
      */
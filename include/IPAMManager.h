@@ -78,8 +78,7 @@ class IPAMManager : public MadManager, public ActionListener
 {
 public:
 
-    IPAMManager(time_t timer, std::vector<const VectorAttribute*>& _mads):
-            MadManager(_mads), timer_period(timer)
+    IPAMManager(std::vector<const VectorAttribute*>& _mads):MadManager(_mads)
     {
         am.addListener(this);
     };
@@ -143,11 +142,6 @@ private:
      */
     ActionManager           am;
 
-    /**
-     *  Timer for the Manager (periocally triggers timer action)
-     */
-    time_t                  timer_period;
-
     /**
      *  Generic name for the IPAM driver
      */
@@ -218,11 +212,6 @@ private:
     // -------------------------------------------------------------------------
     // Action Listener interface
     // -------------------------------------------------------------------------
-    void timer_action(const ActionRequest& ar)
-    {
-        check_time_outs_action();
-    };
-
     void finalize_action(const ActionRequest& ar)
     {
         NebulaLog::log("IPM",Log::INFO,"Stopping IPAM Manager...");
@@ -83,6 +83,16 @@ public:
         am.finalize();
     };
 
+    /**
+     *  Prints the statistics of the monitor message queue, see
+     *  MonitorThreadPool::to_xml
+     *    @param oss the output stream
+     */
+    void queue_to_xml(ostringstream& oss)
+    {
+        mtpool.to_xml(oss);
+    }
+
     /**
      *   Load the information drivers
      *     @return 0 on success
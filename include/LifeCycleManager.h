@@ -140,6 +140,51 @@ public:
         return new LCMAction(*this);
     }
 
+    /**
+     *  Actions are ordered per VM
+     */
+    int key() const
+    {
+        return _vm_id;
+    }
+
+    /**
+     *  Operations sent by the DM are requested by users, so they are not
+     *  delayed by the monitoring updates of other VMs. The actions of a VM are
+     *  always executed in order (see key()).
+     */
+    Priority priority() const
+    {
+        switch (_action)
+        {
+            case DEPLOY:
+            case SUSPEND:
+            case RESTORE:
+            case STOP:
+            case CANCEL:
+            case MIGRATE:
+            case LIVE_MIGRATE:
+            case SHUTDOWN:
+            case UNDEPLOY:
+            case UNDEPLOY_HARD:
+            case POWEROFF:
+            case POWEROFF_HARD:
+            case RESTART:
+            case DELETE:
+            case DELETE_RECREATE:
+                return PRIORITY_USER;
+
+            case MONITOR_SUSPEND:
+            case MONITOR_DONE:
+            case MONITOR_POWEROFF:
+            case MONITOR_POWERON:
+                return PRIORITY_MONITOR;
+
+            default:
+                return PRIORITY_DRIVER;
+        }
+    }
+
 private:
     Actions _action;
 
@@ -159,11 +204,17 @@ class LifeCycleManager : public ActionListener
 {
 public:
 
-    LifeCycleManager():
+    /**
+     *    @param workers number of threads to process the actions, actions of
+     *    the same VM are processed in order
+     */
+    LifeCycleManager(unsigned int workers):
         vmpool(0), hpool(0), ipool(0), sgpool(0), clpool(0), tm(0), vmm(0),
         dm(0), imagem(0)
     {
         am.addListener(this);
+
+        am.set_workers(workers);
     };
 
     ~LifeCycleManager(){};
@@ -186,6 +237,15 @@ public:
         am.finalize();
     }
 
+    /**
+     *  Prints the statistics of the action queue, see ActionManager::to_xml
+     *    @param oss the output stream
+     */
+    void queue_to_xml(ostringstream& oss)
+    {
+        am.to_xml(oss);
+    }
+
     /**
      *  This functions starts a new thread for the Life-cycle Manager. This
      *  thread will wait in  an action loop till it receives ACTION_FINALIZE.
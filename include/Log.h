@@ -20,6 +20,9 @@
 #include <string>
 #include <fstream>
 #include <stdexcept>
+#include <vector>
+#include <memory>
+#include <atomic>
 #include <syslog.h>
 
 #include "PoolObjectSQL.h"
@@ -67,6 +70,16 @@ public:
         const MessageType       type,
         const char *            message) = 0;
 
+    /**
+     *  Reopens the log destination (e.g. after the file has been rotated)
+     */
+    virtual void reopen(){};
+
+    /**
+     *  Waits for the messages logged so far to be written
+     */
+    virtual void flush(){};
+
 protected:
     /**
      *  Minimum log level for the messages
@@ -137,6 +150,122 @@ private:
     pthread_mutex_t log_mutex;
 };
 
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+extern "C" void * file_log_writer(void *arg);
+
+/**
+ *  Log messages to a log file asynchronously. Each thread formats its
+ *  messages in a private ring buffer (no locks), and a writer thread writes
+ *  the pending messages of all the buffers every flush interval, in the order
+ *  they were logged: a message is held back until all the older ones have
+ *  been published by their threads. The log file is kept open.
+ */
+class FileLogAsync : public Log
+{
+public:
+    /**
+     *    @param file_name of the log file
+     *    @param level for the messages
+     *    @param mode to open the file (ios_base::trunc or ios_base::app)
+     *    @param flush_interval time between writes, in milliseconds
+     */
+    FileLogAsync(const string&       file_name,
+                 const MessageType   level,
+                 ios_base::openmode  mode,
+                 unsigned int        flush_interval);
+
+    /**
+     *  Writes the pending messages and stops the writer thread
+     */
+    ~FileLogAsync();
+
+    void log(
+        const char *            module,
+        const MessageType       type,
+        const char *            message);
+
+    /**
+     *  The file is reopened by the writer thread before the next write
+     */
+    void reopen();
+
+    void flush();
+
+private:
+    friend void * file_log_writer(void *arg);
+
+    struct LogBuffer;
+
+    string                log_file_name;
+
+    unsigned int          flush_interval;
+
+    int                   fd;
+
+    /**
+     *  Order of the messages, used to merge the thread buffers
+     */
+    std::atomic<unsigned long long> sequence;
+
+    std::atomic<bool>     reopen_file;
+
+    /**
+     *  Thread buffers, and messages too large for them
+     */
+    std::vector<std::shared_ptr<LogBuffer> > buffers;
+
+    std::vector<std::pair<unsigned long long, string> > large;
+
+    pthread_mutex_t       buffers_mutex;
+
+    /**
+     *  Writer thread synchronization
+     */
+    pthread_t             writer;
+
+    pthread_mutex_t       mutex;
+
+    pthread_cond_t        cond;
+
+    pthread_cond_t        flush_cond;
+
+    bool                  wakeup;
+
+    bool                  stop;
+
+    unsigned long long    flush_requests;
+
+    unsigned long long    flushed;
+
+    /**
+     *  Gets the buffer of the calling thread, it is created the first time
+     */
+    LogBuffer * thread_buffer();
+
+    /**
+     *  Wakes up the writer thread
+     */
+    void wake_writer();
+
+    /**
+     *  Writes the pending messages of all the buffers, older than any
+     *  message still being published
+     *    @return true if some messages were held back
+     */
+    bool write_pending();
+
+    /**
+     *  Opens the log file
+     *    @param flags for the open call
+     *    @return 0 on success
+     */
+    int open_file(int flags);
+
+    void writer_loop();
+};
+
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
@@ -20,8 +20,12 @@
 #include <string>
 #include <sstream>
 #include <set>
+#include <map>
 
 #include "SqlDB.h"
+#include "NebulaUtil.h"
+
+extern "C" void * logdb_apply_loop(void *arg);
 
 /**
  *  This class represents a log record
@@ -48,6 +52,14 @@ public:
      */
     std::string sql;
 
+    /**
+     *  Compressed SQL command (raw zlib). It is stored in the log as base64
+     *  text and it is sent to followers as is. Servers before 5.3.85 send
+     *  plain SQL text, so all the servers of a zone (and all the zones of
+     *  a federation) must be upgraded together to replicate.
+     */
+    std::string zsql;
+
     /**
      *  Time when the record has been applied to DB. 0 if not applied
      */
@@ -99,11 +111,22 @@ public:
     int get_log_record(unsigned int index, LogDBRecord& lr);
 
     /**
-     *  Applies the SQL command of the given record to the database. The
-     *  timestamp of the record is updated.
+     *  Notifies the applier thread that the log records up to commit_index
+     *  can be applied to the database. This function does not wait for the
+     *  records to be applied, use wait_log_record for that.
+     *    @param commit_index of the log
+     *    @return 0 on success
+     */
+    int apply_log_records(unsigned int commit_index);
+
+    /**
+     *  Waits until a log record has been applied to the database
      *    @param index of the log record
+     *    @param timeout_ms max time to wait in ms, 0 to wait forever
+     *    @return 0 on success, -1 if the record could not be applied or the
+     *    timeout expired
      */
-	int apply_log_records(unsigned int commit_index);
+    int wait_log_record(unsigned int index, unsigned int timeout_ms = 0);
 
     /**
      *  Deletes the record in start_index and all that follow it
@@ -125,6 +148,40 @@ public:
     int insert_log_record(unsigned int index, unsigned int term,
             std::ostringstream& sql, time_t timestamp, int fed_index);
 
+    /**
+     *  Inserts a new log record in the database. The SQL command is already
+     *  compressed, as sent by the leader (see LogDBRecord::zsql).
+     *    @param index for the record
+     *    @param term for the record
+     *    @param zsql compressed command of the record
+     *    @param timestamp associated to this record
+     *    @param fed_index index in the federation -1 if not federated
+     *
+     *    @return -1 on failure, index of the inserted record on success
+     */
+    int insert_log_record(unsigned int index, unsigned int term,
+            const std::string& zsql, time_t timestamp, int fed_index);
+
+    /**
+     *  Compress a SQL command to be stored in the log.
+     *    @param sql command
+     *    @return pointer to the compressed command (must be freed) or 0
+     */
+    static std::string * compress_sql(const std::string& sql)
+    {
+        return one_util::zlib_compress(sql, false, 1);
+    }
+
+    /**
+     *  Decompress a SQL command as stored in the log
+     *    @param zsql compressed command
+     *    @return pointer to the SQL command (must be freed) or 0
+     */
+    static std::string * decompress_sql(const std::string& zsql)
+    {
+        return one_util::zlib_decompress(zsql, false);
+    }
+
     //--------------------------------------------------------------------------
     // Functions to manage the Raft state. Log record 0, term -1
     // -------------------------------------------------------------------------
@@ -171,11 +228,26 @@ public:
         return _exec_wr(cmd, index);
     }
 
+    /**
+     *  Replicates a batch of federated records (received from the federation
+     *  master) on followers and applies them in a single transaction. The
+     *  records are stored as consecutive log entries, the applier does not
+     *  split a run of federated entries across transactions.
+     *    @param records compressed SQL commands indexed by their fed_index
+     *    @return 0 on success
+     */
+    int exec_federated_wr(const std::map<int, std::string>& records);
+
     int exec_local_wr(ostringstream& cmd)
     {
         return db->exec_local_wr(cmd);
     }
 
+    int exec_local_trx(const std::vector<std::string>& cmds)
+    {
+        return db->exec_local_trx(cmds);
+    }
+
     int exec_rd(ostringstream& cmd, Callbackable* obj)
     {
         return db->exec_rd(cmd, obj);
@@ -234,6 +306,11 @@ public:
 
     int next_federated(int index);
 
+    /**
+     *  @return number of federated records after the given index
+     */
+    int pending_federated(int index);
+
 protected:
     int exec(std::ostringstream& cmd, Callbackable* obj, bool quiet)
     {
@@ -278,6 +355,72 @@ private:
      */
     unsigned int log_retention;
 
+    // -------------------------------------------------------------------------
+    // Log applier. Committed records are applied to the DB by a separate
+    // thread in batches, each batch is applied in a single transaction.
+    // -------------------------------------------------------------------------
+    friend void * logdb_apply_loop(void *arg);
+
+    /**
+     *  Max number of records applied in a single transaction
+     */
+    static const unsigned int apply_batch_size;
+
+    /**
+     *  Thread applying log records
+     */
+    pthread_t apply_thread;
+
+    /**
+     *  Signals the applier that new records have been committed or that it
+     *  needs to end
+     */
+    pthread_cond_t apply_cond;
+
+    /**
+     *  Signals writers that records have been applied (or failed)
+     */
+    pthread_cond_t applied_cond;
+
+    /**
+     *  Index of the last log entry that can be applied to the DB state
+     */
+    unsigned int commit_index;
+
+    /**
+     *  The record failed_index could not be applied. The applier will retry
+     *  in the next call to apply_log_records
+     */
+    bool apply_failed;
+
+    unsigned int failed_index;
+
+    /**
+     *  True when the applier thread has to end
+     */
+    bool apply_end;
+
+    /**
+     *  Applier thread loop, it applies the committed records
+     */
+    void apply_loop();
+
+    /**
+     *  Applies the records in the range [start, end] in a single transaction.
+     *  If end is in a run of federated records the range is extended up to
+     *  the end of the run (or commit), so a federated batch is always applied
+     *  in the same transaction. If the transaction fails records are applied
+     *  one by one (federated runs in their own transaction), to isolate the
+     *  failing one.
+     *    @param start index of the first record to apply
+     *    @param end index of the last record to apply
+     *    @param commit index of the last record that can be applied
+     *    @param applied index of the last record successfully applied
+     *    @return 0 on success
+     */
+    int apply_log_records(unsigned int start, unsigned int end,
+            unsigned int commit, unsigned int& applied);
+
     // -------------------------------------------------------------------------
     // Federated Log
     // -------------------------------------------------------------------------
@@ -319,21 +462,43 @@ private:
     /**
      *  Applies the SQL command of the given record to the database. The
      *  timestamp of the record is updated.
-     *    @param lr the log record
+     *    @param index of the log record
+     *    @param sql command of the log record
      */
-    int apply_log_record(LogDBRecord * lr);
+    int apply_log_record(unsigned int index, const std::string& sql);
 
     /**
-     *  Inserts or update a log record in the database
+     *  Inserts or update a log record in the database. The command is
+     *  stored base64 encoded.
      *    @param index of the log entry
      *    @param term for the log entry
-     *    @param sql command to modify DB state
+     *    @param zsql compressed command to modify DB state
      *    @param ts timestamp of record application to DB state
      *    @param fi the federated index -1 if none
      *
      *    @return 0 on success
      */
-    int insert(int index, int term, const std::string& sql, time_t ts, int fi);
+    int insert(int index, int term, const std::string& zsql, time_t ts, int fi);
+
+    /**
+     *  Builds the INSERT statement for a log record
+     *    @param oss the statement
+     *    @return 0 on success
+     */
+    int insert_sql(std::ostringstream& oss, int index, int term,
+            const std::string& zsql, time_t ts, int fi);
+
+    /**
+     *  Inserts a batch of federated records as consecutive log entries, in a
+     *  single transaction.
+     *    @param term for the records
+     *    @param records compressed SQL commands indexed by their fed_index
+     *    @param timestamp associated to the records
+     *
+     *    @return -1 on failure, index of the last record on success
+     */
+    int insert_log_records(unsigned int term,
+            const std::map<int, std::string>& records, time_t timestamp);
 
     /**
      *  Inserts a new log record in the database. If the record is successfully
@@ -347,6 +512,20 @@ private:
      */
     int insert_log_record(unsigned int term, std::ostringstream& sql,
             time_t timestamp, int federated);
+
+    /**
+     *  Inserts a new log record in the database, the SQL command is already
+     *  compressed. If the record is successfully inserted the index is
+     *  incremented
+     *    @param term for the record
+     *    @param zsql compressed command of the record
+     *    @param timestamp associated to this record
+     *    @param federated, if true it will set fed_index == index, -1 otherwise
+     *
+     *    @return -1 on failure, index of the inserted record on success
+     */
+    int insert_log_record(unsigned int term, const std::string& zsql,
+            time_t timestamp, int federated);
 };
 
 // -----------------------------------------------------------------------------
@@ -367,6 +546,11 @@ public:
         return _logdb->exec_local_wr(cmd);
     }
 
+    int exec_local_trx(const std::vector<std::string>& cmds)
+    {
+        return _logdb->exec_local_trx(cmds);
+    }
+
     int exec_rd(ostringstream& cmd, Callbackable* obj)
     {
         return _logdb->exec_rd(cmd, obj);
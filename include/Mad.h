@@ -21,6 +21,7 @@
 #include <sys/types.h>
 
 #include <map>
+#include <set>
 #include <string>
 #include <sstream>
 
@@ -51,8 +52,11 @@ protected:
             uid(userid),
             attributes(attrs),
             sudo_execution(sudo),
-            pid(-1)
-    {};
+            pid(-1),
+            framed(false)
+    {
+        pthread_mutex_init(&write_mutex, 0);
+    };
 
     /**
      *  The destructor of the class finalizes the driver process, and all its
@@ -68,15 +72,21 @@ protected:
     void write(
         ostringstream&  os) const
     {
-        string        str;
-        const char *  cstr;
-
-        str  = os.str();
-        cstr = str.c_str();
-
-        ::write(nebula_mad_pipe, cstr, str.size());
+        write_message(os.str());
     };
 
+    /**
+     *  Send a command with a (large) data argument to the driver. When using
+     *  the framed protocol the data is sent raw after the command line.
+     *  Otherwise it is base64 encoded and added as the last argument.
+     *    @param os an output string stream with the message, it must NOT be
+     *    terminated with the end of line character.
+     *    @param data the last argument of the message
+     */
+    void write(
+        ostringstream&  os,
+        const string&   data) const;
+
     /**
      *  Send a DRIVER_CANCEL command to the driver
      *    @param oid identifies the action (that associated with oid)
@@ -117,6 +127,17 @@ protected:
         return lt;
     }
 
+    /**
+     *  Checks if the driver supports a protocol extension. Drivers announce
+     *  their capabilities (e.g. FRAMED, BATCH) in the INIT response.
+     *    @param name of the capability
+     *    @return true if supported
+     */
+    bool capability(const string& name) const
+    {
+        return capabilities.count(name) > 0;
+    }
+
 private:
     friend class MadManager;
 
@@ -154,6 +175,42 @@ private:
      */
     pid_t               pid;
 
+    /**
+     *  True if the framed protocol has been negotiated with the driver. The
+     *  protocol is negotiated at INIT time, see negotiate_protocol
+     */
+    bool                framed;
+
+    /**
+     *  Protocol extensions announced by the driver in the INIT response
+     */
+    set<string>         capabilities;
+
+    /**
+     *  Serializes writes to the driver pipe
+     */
+    mutable pthread_mutex_t write_mutex;
+
+    /**
+     *  Writes a message (a line or a frame) to the driver pipe
+     *    @param msg terminated with the end of line character
+     */
+    void write_message(const string& msg) const;
+
+    /**
+     *  Writes the buffer to the driver pipe, concurrent writes are serialized
+     *    @param buf the data
+     */
+    void write_pipe(const string& buf) const;
+
+    /**
+     *  Switches to the framed protocol if the driver supports it (it returns
+     *  FRAMED in the INIT response): oned sends "PROTOCOL FRAMED" and
+     *  the driver confirms with "PROTOCOL SUCCESS". From then on, messages
+     *  in both directions are frames (see MadReader).
+     */
+    void negotiate_protocol();
+
     /**
      *  Starts the MAD. This function creates a new process, sets up the
      *  communication pipes and sends the initialization command to the driver.
@@ -176,6 +233,16 @@ private:
      */
     virtual void protocol(const string& message) const = 0;
 
+    /**
+     *  Returns the id of the object a message refers to. Messages with the
+     *  same key are processed in order, the rest may be processed
+     *  concurrently. By default it is the ID field of the message
+     *  (ACTION RESULT ID INFO)
+     *    @param message the string read from the driver
+     *    @return the key, -1 if the message has no associated object
+     */
+    virtual int message_key(const string& message) const;
+
     /**
      *  This function is called whenever the driver crashes. This function
      *  should perform the actions needed to recover the VMs.
@@ -24,8 +24,11 @@
 #include <vector>
 #include <sstream>
 #include <vector>
+#include <map>
+#include <queue>
 
 #include "Mad.h"
+#include "MadReader.h"
 #include "Attribute.h"
 
 using namespace std;
@@ -34,6 +37,8 @@ class SyncRequest;
 
 extern "C" void * mad_manager_listener(void * _mm);
 
+extern "C" void * mad_manager_dispatcher(void * _dw);
+
 /**
  * Provides general functionality for driver management. The MadManager serves
  * Nebula managers as base clase.
@@ -62,7 +67,19 @@ public:
      */
     void notify_request(int id, bool result, const string& message);
 
+    /**
+     *  Fails a pending request and notifies the client. It is executed by the
+     *  TimerWheel when the request expires.
+     *    @param id for the request
+     */
+    void timeout_request(int id);
+
 protected:
+    /**
+     *  Time (seconds) to expire a request
+     */
+    static const unsigned int REQUEST_TIMEOUT = 90;
+
 
     MadManager(vector<const VectorAttribute *>& _mads);
 
@@ -102,14 +119,8 @@ protected:
     int add(Mad *mad);
 
     /**
-     *  This function can be periodically executed to check time_outs on
-     *  request. It will fail requests with an expired timeout and will notify
-     *  the clients.
-     */
-    void check_time_outs_action();
-
-    /**
-     *  Add a new request to the Request map
+     *  Add a new request to the Request map. The request expires after
+     *  REQUEST_TIMEOUT seconds.
      *    @param ar pointer to the request
      *    @return the id for the request
      */
@@ -145,6 +156,12 @@ private:
      */
     friend void * mad_manager_listener(void * _mm);
 
+    /**
+     *  Function to execute the dispatcher workers within a new pthread
+     *  (requires C linkage)
+     */
+    friend void * mad_manager_dispatcher(void * _dw);
+
     /**
      *  Synchronization mutex (listener & manager threads)
      */
@@ -168,10 +185,9 @@ private:
     int                     pipe_w;
 
     /**
-     *  This vector contains the file descriptors of the driver pipes (to read
-     *  Mads responses)
+     *  epoll instance used by the listener to wait for driver messages
      */
-    vector<int>             fds;
+    int                     epoll_fd;
 
     /**
      *  The sets of Mads managed by the MadManager
@@ -179,10 +195,11 @@ private:
     vector<Mad *>           mads;
 
     /**
-     *  Read buffer for the listener. This variable is in the class so it
-     *  can be free upon listener thread cancellation.
+     *  Read buffers for the driver pipes (to read Mads responses), indexed
+     *  by file descriptor. They are in the class so they can be free upon
+     *  listener thread cancellation.
      */
-    ostringstream           buffer;
+    map<int, MadReader *>   readers;
 
     /**
      *  List of pending requests
@@ -193,6 +210,85 @@ private:
      *  Listener thread implementation.
      */
     void listener();
+
+    // -------------------------------------------------------------------------
+    // Message dispatch. Driver messages are processed by a pool of workers.
+    // Messages for the same object (see Mad::message_key) are always handled
+    // by the same worker, so they are processed in order.
+    // -------------------------------------------------------------------------
+    /**
+     *  Number of dispatch workers
+     */
+    static const unsigned int DISPATCH_WORKERS = 8;
+
+    struct DispatchWorker
+    {
+        MadManager * mm;
+
+        pthread_t    thread;
+
+        pthread_cond_t cond;
+
+        /**
+         *  Pending messages and the driver that sent them
+         */
+        std::queue<std::pair<Mad *, std::string> > messages;
+    };
+
+    vector<DispatchWorker *> workers;
+
+    /**
+     *  Number of messages of each driver queued or being processed
+     */
+    map<Mad *, unsigned int> in_flight;
+
+    /**
+     *  Protects the worker queues
+     */
+    pthread_mutex_t         dispatch_mutex;
+
+    /**
+     *  Signals that all the messages of a driver have been processed
+     */
+    pthread_cond_t          idle_cond;
+
+    /**
+     *  True when the workers have to end
+     */
+    bool                    dispatch_end;
+
+    /**
+     *  Sends a message to the worker associated to its object
+     *    @param mad that sent the message
+     *    @param message from the driver
+     */
+    void dispatch(Mad * mad, const string& message);
+
+    /**
+     *  Worker loop, it process the messages in its queue
+     *    @param dw the worker
+     */
+    void dispatch_loop(DispatchWorker * dw);
+
+    /**
+     *  Waits until all the dispatched messages of a driver have been
+     *  processed. Used before reloading or freeing the driver
+     *    @param mad the driver
+     */
+    void wait_dispatch(Mad * mad);
+
+    /**
+     *  Adds the pipes of new drivers to the listener epoll set. Must be
+     *  called with the manager locked.
+     */
+    void update_readers();
+
+    /**
+     *  Removes the reader of a driver from the listener epoll set. Must be
+     *  called with the manager locked.
+     *    @param fd of the reader
+     */
+    void delete_reader(int fd);
 };
 
 #endif /*MAD_MANAGER_H_*/
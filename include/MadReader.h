@@ -0,0 +1,128 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+
+#ifndef MAD_READER_H_
+#define MAD_READER_H_
+
+#include <string>
+#include <vector>
+
+/**
+ *  Buffered reader for the driver to oned pipe. Data is read in large chunks
+ *  from a non-blocking file descriptor and split in driver messages (lines).
+ *  Incomplete lines are kept until the rest of the message is received.
+ *
+ *  When the framed protocol is negotiated with the driver, messages are
+ *  length-prefixed frames instead of lines:
+ *    - 4 bytes, payload length (network byte order)
+ *    - 1 byte, flags. FRAME_ZLIB if the payload is zlib compressed
+ *    - payload
+ */
+class MadReader
+{
+public:
+    /**
+     *  @param _fd file descriptor to read from, it is set to non-blocking
+     */
+    MadReader(int _fd, bool _framed = false);
+
+    ~MadReader(){};
+
+    /**
+     *  Reads all the data available in the file descriptor.
+     *    @param lines complete messages read, including the trailing '\n' (the
+     *    payload for framed messages)
+     *    @return 0 on success, -1 if the other end was closed or on error.
+     *    Note that complete messages are returned in lines in both cases.
+     */
+    int read_lines(std::vector<std::string>& lines);
+
+    /**
+     *  Builds a frame for the given message, the payload is compressed if
+     *  it is larger than FRAME_COMPRESS_SIZE
+     *    @param msg the message
+     *    @param frame the resulting frame
+     */
+    static void encode_frame(const std::string& msg, std::string& frame);
+
+    /**
+     *  Frame flags
+     */
+    static const unsigned char FRAME_ZLIB = 0x01;
+
+    /**
+     *  Size of the frame header
+     */
+    static const size_t FRAME_HEADER_SIZE = 5;
+
+    /**
+     *  Payloads larger than this are compressed
+     */
+    static const size_t FRAME_COMPRESS_SIZE = 4096;
+
+    /**
+     *  Max size of a frame payload, larger frames are considered an error
+     */
+    static const size_t FRAME_MAX_SIZE = 256 * 1024 * 1024;
+
+    /**
+     *  Max size of a message line, larger lines are considered an error
+     */
+    static const size_t LINE_MAX_SIZE = 256 * 1024 * 1024;
+
+    /**
+     *  @return the file descriptor of the reader
+     */
+    int get_fd() const
+    {
+        return fd;
+    };
+
+private:
+    /**
+     *  Size of each read(2) call
+     */
+    static const size_t READ_SIZE = 65536;
+
+    /**
+     *  File descriptor to read from
+     */
+    int fd;
+
+    /**
+     *  True if the driver uses the framed protocol
+     */
+    bool framed;
+
+    /**
+     *  Last incomplete message
+     */
+    std::string partial;
+
+    /**
+     *  Extract the complete lines from partial
+     */
+    void split_lines(std::vector<std::string>& lines);
+
+    /**
+     *  Extract the complete frames from partial
+     *    @return -1 if a frame is malformed
+     */
+    int split_frames(std::vector<std::string>& lines);
+};
+
+#endif /*MAD_READER_H_*/
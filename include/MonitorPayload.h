@@ -0,0 +1,157 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+#ifndef MONITOR_PAYLOAD_H_
+#define MONITOR_PAYLOAD_H_
+
+#include <string>
+#include <sstream>
+#include <vector>
+#include <map>
+
+#include "Template.h"
+#include "VirtualMachineMonitorInfo.h"
+
+using namespace std;
+
+/**
+ *  Compact binary encoding of the host monitoring information, as sent by the
+ *  probes instead of the KEY=VALUE template. It is decoded directly into the
+ *  host template and the VM monitoring information, the template parser is
+ *  not used. Format:
+ *
+ *    payload := "ONEM" VERSION record*
+ *    record  := ATTR name value                 host attribute
+ *             | VM zigzag(ID) varint(n) (name value){n}
+ *                  varint(m) (name value){m}    VM attributes, POLL fields
+ *    name    := varint(0) string                new name, added to the table
+ *             | varint(i)                       i-th name of the table
+ *    value   := INT zigzag | FLOAT double | STRING string
+ *             | VECTOR varint(n) (name value){n}, with single values
+ *    string  := varint(length) bytes
+ *
+ *  Tags and types are single bytes, varints are LEB128 and doubles are
+ *  little-endian.
+ */
+class MonitorPayload
+{
+public:
+    MonitorPayload(){};
+
+    ~MonitorPayload();
+
+    /**
+     *  Checks if the monitoring information uses the binary encoding
+     *    @param data decoded from base64 and decompressed
+     *    @return true if the data is a binary payload
+     */
+    static bool is_binary(const string& data);
+
+    /**
+     *  Decodes a binary payload. The host attributes are added to the
+     *  template, as if it were parsed from the text template. The POLL
+     *  attribute of each VM is also rendered, and the POLL fields are kept as
+     *  monitoring information of the VM.
+     *    @param data binary payload
+     *    @param tmpl for the host attributes
+     *    @param error description if any
+     *    @return 0 on success
+     */
+    int decode(const string& data, Template& tmpl, string& error);
+
+    /**
+     *  Gets the monitoring information of a VM decoded from the payload
+     *    @param deploy_id of the VM
+     *    @return the information, 0 if not included in the payload
+     */
+    VirtualMachineMonitorInfo * get_poll(const string& deploy_id)
+    {
+        map<string, VirtualMachineMonitorInfo *>::iterator it;
+
+        it = polls.find(deploy_id);
+
+        if ( it == polls.end() )
+        {
+            return 0;
+        }
+
+        return it->second;
+    };
+
+private:
+    static const char * MAGIC;
+
+    static const char VERSION = 1;
+
+    /**
+     *  Record tags
+     */
+    enum RecordType
+    {
+        ATTR = 1,
+        VM   = 2
+    };
+
+    /**
+     *  Value types
+     */
+    enum ValueType
+    {
+        INT    = 0,
+        FLOAT  = 1,
+        STRING = 2,
+        VECTOR = 3
+    };
+
+    /**
+     *  VM monitoring information by DEPLOY_ID
+     */
+    map<string, VirtualMachineMonitorInfo *> polls;
+
+    // -------------------------------------------------------------------------
+    // Decoding state
+    // -------------------------------------------------------------------------
+    const string * data;
+
+    size_t pos;
+
+    vector<string> names;
+
+    int read_varint(unsigned long long& value);
+
+    int read_string(string& str);
+
+    int read_name(string& name);
+
+    /**
+     *  Reads a single value (INT, FLOAT or STRING) as a string
+     *    @param type of the value
+     *    @param value read
+     */
+    int read_single(int type, string& value);
+
+    /**
+     *  Reads a value (single or VECTOR) as an attribute
+     *    @param name of the attribute
+     *    @param poll to append the attribute in the POLL format, if not 0
+     *    @return the attribute, 0 on failure
+     */
+    Attribute * read_attribute(const string& name, ostringstream * poll);
+
+    int decode_vm(Template& tmpl);
+};
+
+#endif /*MONITOR_PAYLOAD_H_*/
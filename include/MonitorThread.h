@@ -19,6 +19,11 @@
 #define MONITOR_THREAD_H_
 
 #include <string>
+#include <sstream>
+#include <map>
+#include <set>
+#include <list>
+#include <vector>
 #include <pthread.h>
 
 class HostPool;
@@ -30,15 +35,13 @@ class VirtualMachinePool;
 
 class MonitorThreadPool;
 
-extern "C" void * do_message_thread(void *arg);
+extern "C" void * monitor_thread_loop(void *arg);
 
 class MonitorThread
 {
 private:
     friend class MonitorThreadPool;
 
-    friend void * do_message_thread(void *arg);
-
     MonitorThread(int hid, std::string res, std::string inf):host_id(hid),
         result(res), hinfo64(inf){};
 
@@ -66,23 +69,33 @@ private:
 
     static VirtualMachinePool * vmpool;
 
-    static MonitorThreadPool * mthpool;
-
     static time_t monitor_interval;
+
+    // Running VMs with no relevant changes are not updated, see
+    // VM_MONITORING_DELTA in oned.conf
+    static float poll_threshold;
+
+    static time_t poll_refresh;
 };
 
 // -----------------------------------------------------------------------------
 // -----------------------------------------------------------------------------
 
+/**
+ *  Pool of threads to process the monitor messages. Only the last pending
+ *  message of each host is kept, a message received while another one of the
+ *  same host is pending replaces it (it is stale). Messages of the same host
+ *  are not processed concurrently.
+ */
 class MonitorThreadPool
 {
 public:
     MonitorThreadPool(int num_threads);
 
-    ~MonitorThreadPool(){};
+    ~MonitorThreadPool();
 
     /**
-     *  Creates a new thread to parse and process a monitor message
+     *  Queues a monitor message to be processed by the pool, it does not block
      *    @param hid host id
      *    @param result of the monitor operation
      *    @oaram hinfo the information sent by the driver
@@ -90,20 +103,47 @@ public:
     void do_message(int hid, const std::string& result, const std::string& hinfo);
 
     /**
-     *  Terminates a running thread, and signal the main control thread.
+     *  Prints the queue statistics: pending messages (DEPTH), processed
+     *  messages (MESSAGES) and stale messages dropped (DROPPED)
+     *    @param oss the output stream
      */
-    void exit_monitor_thread();
+    void to_xml(std::ostringstream& oss);
 
 private:
+    friend void * monitor_thread_loop(void *arg);
+
+    /**
+     *  Last pending message of each host
+     */
+    std::map<int, MonitorThread *> pending;
+
+    /**
+     *  Hosts with a pending message ready to be processed, in arrival order
+     */
+    std::list<int> ready;
+
+    /**
+     *  Hosts with a message being processed
+     */
+    std::set<int> running;
+
+    std::vector<pthread_t> threads;
 
-    int concurrent_threads; /**< Max number of concurrent threads*/
+    unsigned long long processed;
 
-    int running_threads;    /**< Number of running threads*/
+    unsigned long long dropped;
+
+    bool stop;
 
     //Concurrency control variables
     pthread_mutex_t mutex;
 
     pthread_cond_t  cond;
+
+    /**
+     *  Loop of the pool threads
+     */
+    void thread_loop();
 };
 
 /* -------------------------------------------------------------------------- */
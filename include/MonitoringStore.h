@@ -0,0 +1,457 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+#ifndef MONITORING_STORE_H_
+#define MONITORING_STORE_H_
+
+#include <pthread.h>
+#include <time.h>
+
+#include <map>
+#include <vector>
+#include <string>
+#include <sstream>
+
+#include "SqlDB.h"
+#include "Callbackable.h"
+
+using namespace std;
+
+extern "C" void * monitoring_expire_loop(void *arg);
+
+/**
+ *  Time series store for the numeric monitoring metrics of the pool objects
+ *  (Hosts, VMs). The samples of each object are grouped in segments that
+ *  span a time window. Each metric is a column of fixed point values, delta
+ *  and varint encoded.
+ *
+ *  Besides the raw samples, the store keeps per-minute and per-hour rollups
+ *  with the average, min (<NAME>_MIN) and max (<NAME>_MAX) of each metric.
+ *  Rollups are computed as the samples arrive and stored as segments of
+ *  their own resolution, with their own expiration time.
+ *
+ *  The open segment of each object is kept in memory, it is sealed when it
+ *  is full or its time window ends. Sealed segments are written in batches
+ *  (multi-row REPLACE) when WRITE_SEGMENTS are pending or write_ended is
+ *  called. write_ended also writes the open segments with new samples, so
+ *  the history survives a restart. A segment is always a single row, each
+ *  write replaces the previous one; the expiration drops whole segments.
+ *
+ *  Expired segments are deleted by a background thread, every EXPIRE_PERIOD
+ *  seconds. Each DELETE statement covers the segments of EXPIRE_OIDS objects
+ *  (a range of the primary key), with a pause between statements so the
+ *  table is not locked for long.
+ *
+ *  The segment table has the columns:
+ *    <oid_column> INTEGER, resolution INTEGER, start_time INTEGER,
+ *    end_time INTEGER, body MEDIUMTEXT,
+ *    PRIMARY KEY(<oid_column>, resolution, start_time)
+ *  where resolution is the period of the samples in seconds, 0 for raw ones.
+ */
+class MonitoringStore : public Callbackable
+{
+public:
+    /**
+     *  Metrics of a sample, name -> value. Names can have one level, e.g.
+     *  "MONITORING/CPU" renders as <MONITORING><CPU>...</CPU></MONITORING>.
+     *  Non numeric values are ignored.
+     */
+    typedef map<string, string> Metrics;
+
+    /**
+     *  Resolution of the series
+     */
+    enum Resolution
+    {
+        RAW    = 0,
+        MINUTE = 1,
+        HOUR   = 2
+    };
+
+    static const int RESOLUTIONS = 3;
+
+    /**
+     *  Gets the resolution from its period in seconds (0, 60 or 3600)
+     *    @return 0 on success, -1 if the period is not supported
+     */
+    static int resolution(int seconds, Resolution& res);
+
+    /**
+     *  @param db pointer to the DB
+     *  @param table with the segments
+     *  @param oid_column of the segment table
+     *  @param pool_table to join the segments with, to filter the objects
+     *  @param root XML element of each sample, e.g. "VM"
+     *  @param time_elem XML element with the sample timestamp
+     *  @param raw_expiration of the samples in seconds
+     *  @param minute_expiration of the minute rollups, 0 disables them
+     *  @param hour_expiration of the hour rollups, 0 disables them
+     */
+    MonitoringStore(SqlDB * db, const char * table, const char * oid_column,
+        const char * pool_table, const char * root, const char * time_elem,
+        time_t raw_expiration, time_t minute_expiration, time_t hour_expiration);
+
+    ~MonitoringStore();
+
+    /**
+     *  Adds a sample to the object series. Samples not newer than the last
+     *  one of the series are ignored.
+     *    @param oid of the object
+     *    @param timestamp of the sample
+     *    @param metrics of the sample
+     *    @return 0 on success
+     */
+    int append(int oid, time_t timestamp, const Metrics& metrics);
+
+    /**
+     *  Dumps the samples of a set of objects in XML format, ordered by object
+     *  and time:
+     *    <MONITORING_DATA><root><ID/><time_elem/>...</root>...
+     *
+     *    @param oss the output stream
+     *    @param where SQL filter for the pool table
+     *    @param oids of the objects that match the filter
+     *    @param res resolution of the samples
+     *    @param start_time of the samples, -1 for no limit
+     *    @param end_time of the samples, -1 for no limit
+     *    @return 0 on success
+     */
+    int dump(ostringstream& oss, const string& where, const vector<int>& oids,
+            Resolution res, time_t start_time, time_t end_time);
+
+    /**
+     *  Writes the segments and rollups whose time window has ended, and the
+     *  samples added to the open segments since the last call. Expired
+     *  segments are deleted in the background.
+     */
+    void write_ended();
+
+    /**
+     *  Drops all the segments
+     *    @return 0 on success
+     */
+    int clean_all();
+
+    /**
+     *  Writes the open segments and rollups to the DB, called before exiting
+     */
+    void flush();
+
+private:
+    friend void * monitoring_expire_loop(void *arg);
+
+    /**
+     *  Period of the samples for each resolution
+     */
+    static const time_t PERIOD[RESOLUTIONS];
+
+    /**
+     *  Time window of a segment in seconds, for each resolution
+     */
+    static const time_t SEGMENT_TIME[RESOLUTIONS];
+
+    /**
+     *  Max number of samples in a segment
+     */
+    static const unsigned int SEGMENT_SAMPLES = 256;
+
+    /**
+     *  Max decimal digits of the fixed point values
+     */
+    static const unsigned int MAX_SCALE = 6;
+
+    /**
+     *  Number of sealed segments that triggers a write to the DB
+     */
+    static const unsigned int WRITE_SEGMENTS = 64;
+
+    /**
+     *  Max size (bytes) of each REPLACE statement
+     */
+    static const unsigned int MAX_STATEMENT = 1048576;
+
+    /**
+     *  Seconds between expirations of the segments
+     */
+    static const time_t EXPIRE_PERIOD = 300;
+
+    /**
+     *  Number of objects whose segments are deleted by each statement
+     */
+    static const int EXPIRE_OIDS = 100;
+
+    /**
+     *  Pause (ms) between delete statements
+     */
+    static const unsigned int EXPIRE_PAUSE = 100;
+
+    /**
+     *  A metric of the segment. Each value is encoded as the varint of the
+     *  samples skipped since the previous value (the metric may be missing)
+     *  and the zig-zag varint of the delta with the previous value.
+     */
+    struct Column
+    {
+        Column():scale(0), count(0), last_index(-1), last_value(0){};
+
+        unsigned int scale;
+
+        unsigned int count;
+
+        int          last_index;
+
+        long long    last_value;
+
+        string       data;
+
+        /**
+         *  Adds a value at the given sample position. The column is rescaled
+         *  if the value needs more decimal digits.
+         *    @return 0 on success, -1 if the value (or the rescaled column)
+         *    does not fit in the column. The value is not added
+         */
+        int add(int index, long long value, unsigned int vscale);
+
+        /**
+         *  Decodes the column, appends the (index, value) pairs
+         */
+        int decode(vector<pair<int, long long> >& values) const;
+    };
+
+    /**
+     *  Samples of an object in a time window
+     */
+    struct Segment
+    {
+        Segment():start(0), last(0), count(0), written(0){};
+
+        time_t  start;
+
+        time_t  last;
+
+        unsigned int count;
+
+        /**
+         *  Number of samples when the open segment was last written
+         */
+        unsigned int written;
+
+        /**
+         *  Varint deltas of the sample timestamps with the previous one
+         */
+        string  times;
+
+        map<string, Column> columns;
+
+        void add(time_t timestamp, const Metrics& metrics);
+
+        /**
+         *  Serializes the segment, the result is base64 encoded
+         */
+        void encode(string& body) const;
+
+        /**
+         *  Renders the samples of a base64 encoded segment in a time range
+         *    @return 0 on success
+         */
+        static int to_xml(ostringstream& oss, const string& body, int oid,
+                const string& root, const string& time_elem,
+                time_t start_time, time_t end_time);
+    };
+
+    /**
+     *  Aggregated values of the samples of an object in a rollup period
+     */
+    struct Rollup
+    {
+        struct Aggregate
+        {
+            double       min;
+            double       max;
+            double       sum;
+            unsigned int count;
+            unsigned int scale;
+        };
+
+        Rollup():start(0){};
+
+        time_t start;
+
+        map<string, Aggregate> metrics;
+
+        void add(const Metrics& sample);
+
+        /**
+         *  Gets the average, min and max of each metric as a sample
+         */
+        void to_metrics(Metrics& sample) const;
+    };
+
+    /**
+     *  Encoded segment of an object
+     */
+    struct Body
+    {
+        time_t start;
+
+        time_t end;
+
+        string body;
+    };
+
+    /**
+     *  Sealed segments to be written to the DB
+     */
+    typedef vector<pair<int, Segment *> > SegmentList;
+
+    SqlDB * db;
+
+    string  table;
+
+    string  oid_column;
+
+    string  pool_table;
+
+    string  root;
+
+    string  time_elem;
+
+    time_t  expiration[RESOLUTIONS];
+
+    /**
+     *  Open segment of each object, for each resolution
+     */
+    map<int, Segment *> open[RESOLUTIONS];
+
+    /**
+     *  Segments sealed and not yet written to the DB
+     */
+    multimap<int, Segment *> sealed[RESOLUTIONS];
+
+    /**
+     *  Sealed segments waiting for the next write
+     */
+    SegmentList pending[RESOLUTIONS];
+
+    unsigned int num_pending;
+
+    /**
+     *  Current minute and hour rollup of each object
+     */
+    map<int, Rollup> rollups[RESOLUTIONS];
+
+    pthread_mutex_t mutex;
+
+    /**
+     *  Serializes the DB writes, so a segment is never replaced by an older
+     *  copy of itself. It MUST be locked before the mutex.
+     */
+    pthread_mutex_t write_mutex;
+
+    // -------------------------------------------------------------------------
+    // Expiration thread
+    // -------------------------------------------------------------------------
+    bool            expire_started;
+
+    bool            expire_stop;
+
+    pthread_t       expire_thread;
+
+    pthread_mutex_t expire_mutex;
+
+    pthread_cond_t  expire_cond;
+
+    /**
+     *  Deletes the expired segments every EXPIRE_PERIOD until stopped
+     */
+    void expire_loop();
+
+    /**
+     *  Deletes the segments expired at the given time, in chunks of
+     *  EXPIRE_OIDS objects
+     *    @return 0 on success, -1 if stopped or on a DB error
+     */
+    int expire(time_t the_time);
+
+    /**
+     *  Waits for the given time or until the thread is stopped. This function
+     *  MUST be called with the expire_mutex locked.
+     *    @return false if the thread has been stopped
+     */
+    bool expire_wait(unsigned int ms);
+
+    /**
+     *  Time window of a sample. Windows are shifted for each object so
+     *  segments are not sealed at the same time.
+     */
+    time_t window(Resolution res, int oid, time_t timestamp)
+    {
+        return (timestamp + (oid * 61) % SEGMENT_TIME[res]) / SEGMENT_TIME[res];
+    };
+
+    /**
+     *  Adds a sample to the open segment of the object, the previous segment
+     *  is added to the full list if the sample does not fit in it. This
+     *  function MUST be called with the mutex locked.
+     */
+    void add_sample(Resolution res, int oid, time_t timestamp,
+            const Metrics& metrics, SegmentList& full);
+
+    /**
+     *  Adds the sample to the rollups of the object, the rollups of previous
+     *  periods are added as samples of their series. This function MUST be
+     *  called with the mutex locked.
+     */
+    void add_rollups(int oid, time_t timestamp, const Metrics& metrics,
+            SegmentList full[RESOLUTIONS]);
+
+    /**
+     *  Adds the sealed segments to the pending lists. The pending segments
+     *  are moved to the write list if there are WRITE_SEGMENTS of them or
+     *  all is true. This function MUST be called with the mutex locked.
+     */
+    void add_pending(SegmentList segments[RESOLUTIONS], bool all);
+
+    /**
+     *  Writes the sealed segments of the given objects to the DB, and
+     *  removes them from the sealed map.
+     */
+    void write(Resolution res, const SegmentList& segments);
+
+    /**
+     *  Writes a copy of the open segments with samples not yet in the DB.
+     */
+    void write_open();
+
+    /**
+     *  Writes the segments to the DB (REPLACE of one row per segment). The
+     *  write_mutex MUST be locked.
+     */
+    void write_rows(Resolution res, const SegmentList& segments);
+
+    /**
+     *  Removes the segments from the sealed map and frees them. This
+     *  function MUST be called with the mutex locked.
+     */
+    void drop_sealed(Resolution res, const SegmentList& segments);
+
+    /**
+     *  Callback for the segment rows (oid, start_time, end_time, body)
+     */
+    int dump_cb(void * _bodies, int num, char **values, char **names);
+};
+
+#endif /*MONITORING_STORE_H_*/
@@ -61,6 +61,14 @@ public:
      */
     char * escape_str(const string& str);
 
+    /**
+     *  Executes the commands in a single transaction. The DB is not used by
+     *  other threads until the transaction is committed or rolled back.
+     *    @param cmds the SQL commands
+     *    @return 0 on success
+     */
+    int exec_local_trx(const std::vector<std::string>& cmds);
+
     /**
      *  Frees a previously scaped string
      *    @param str pointer to the str
@@ -157,6 +165,8 @@ public:
 
     void free_str(char * str){};
 
+    int exec_local_trx(const std::vector<std::string>& cmds){return -1;};
+
     bool multiple_values_support(){return true;};
 
 protected:
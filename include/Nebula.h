@@ -253,6 +253,12 @@ public:
      */
     NebulaLog::LogType get_log_system() const;
 
+    /**
+     *  Returns the value of LOG->FLUSH_INTERVAL in oned.conf file
+     *      @return milliseconds between log writes, 0 to write each message
+     */
+    unsigned int get_log_flush_interval() const;
+
     /**
      *  Returns the value of ONE_LOCATION env variable. When this variable is
      *  not defined the nebula location is "/".
@@ -375,7 +381,7 @@ public:
      */
     static string local_db_version()
     {
-        return "5.3.80";
+        return "5.3.85";
     }
 
     /**
@@ -43,12 +43,18 @@ public:
     // Logging
     // ---------------------------------------------------------------
 
+    /**
+     *  Initializes the log system
+     *    @param flush_interval for FILE_TS logs, if not 0 messages are written
+     *    asynchronously every flush_interval milliseconds
+     */
     static void init_log_system(
         LogType             ltype,
         Log::MessageType    clevel,
         const char *        filename,
         ios_base::openmode  mode,
-        const string&       daemon)
+        const string&       daemon,
+        unsigned int        flush_interval = 0)
     {
         _log_type = ltype;
 
@@ -58,7 +64,15 @@ public:
                 NebulaLog::logger = new FileLog(filename, clevel, mode);
                 break;
             case FILE_TS:
-                NebulaLog::logger = new FileLogTS(filename, clevel, mode);
+                if ( flush_interval != 0 )
+                {
+                    NebulaLog::logger = new FileLogAsync(filename, clevel, mode,
+                            flush_interval);
+                }
+                else
+                {
+                    NebulaLog::logger = new FileLogTS(filename, clevel, mode);
+                }
                 break;
             case SYSLOG:
                 NebulaLog::logger = new SysLog(clevel, daemon);
@@ -94,6 +108,28 @@ public:
         delete logger;
     }
 
+    /**
+     *  Reopens the log file, used to rotate the logs (SIGHUP)
+     */
+    static void reopen_log_system()
+    {
+        if ( logger != 0 )
+        {
+            logger->reopen();
+        }
+    }
+
+    /**
+     *  Waits for the pending messages to be written
+     */
+    static void flush_log_system()
+    {
+        if ( logger != 0 )
+        {
+            logger->flush();
+        }
+    }
+
     static void log(
         const char *           module,
         const Log::MessageType type,
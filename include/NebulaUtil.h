@@ -244,10 +244,13 @@ namespace one_util
      *  Compress the input string unsing zlib
      *    @param in input string
      *    @param bool64 true to base64 encode output
+     *    @param level zlib compression level 1 (fastest) to 9 (best), -1 for
+     *    the zlib default
      *    @return pointer to the compressed sting (must be freed) or 0 in case
      *    of error
      */
-	std::string * zlib_compress(const std::string& in, bool base64);
+	std::string * zlib_compress(const std::string& in, bool base64,
+            int level = -1);
 
 	/**
      *  Decompress the input string unsing zlib
@@ -26,6 +26,7 @@
 #include "PoolObjectSQL.h"
 #include "Log.h"
 #include "Hook.h"
+#include "UpdateBatch.h"
 
 using namespace std;
 
@@ -123,6 +124,8 @@ public:
     {
         int rc;
 
+        flush_batch(objsql->get_oid());
+
         rc = objsql->update(db);
 
         if ( rc == 0 )
@@ -142,6 +145,8 @@ public:
      */
     virtual int drop(PoolObjectSQL * objsql, string& error_msg)
     {
+        flush_batch(objsql->get_oid());
+
         int rc = objsql->drop(db);
 
         if ( rc != 0 )
@@ -267,6 +272,36 @@ protected:
      */
     SqlDB * db;
 
+    /**
+     *  Deferred writes of the pool objects, 0 if the pool does not use them.
+     *  It is created by the pool and freed by PoolSQL.
+     */
+    UpdateBatch * batch;
+
+    /**
+     *  Writes the deferred rows of an object, if any. MUST be called before
+     *  any direct access to the object in the DB.
+     *    @param oid of the object
+     */
+    void flush_batch(int oid)
+    {
+        if ( batch != 0 )
+        {
+            batch->flush(oid);
+        }
+    };
+
+    /**
+     *  Writes all the deferred rows of the pool objects
+     */
+    void flush_batch()
+    {
+        if ( batch != 0 )
+        {
+            batch->flush();
+        }
+    };
+
     /**
      *  Dumps the pool in XML format. A filter and limit can be also added
      *  to the query
@@ -17,6 +17,8 @@
 #ifndef RAFT_MANAGER_H_
 #define RAFT_MANAGER_H_
 
+#include <set>
+
 #include "ActionManager.h"
 #include "ReplicaManager.h"
 #include "ReplicaRequest.h"
@@ -50,10 +52,11 @@ public:
      *   @param bcast heartbeat broadcast timeout
      *   @param election timeout
      *   @param xmlrpc timeout for RAFT related xmlrpc API calls
+     *   @param lreads true to serve linearizable reads on followers
      **/
     RaftManager(int server_id, const VectorAttribute * leader_hook_mad,
         const VectorAttribute * follower_hook_mad, time_t log_purge,
-        long long bcast, long long election, time_t xmlrpc,
+        long long bcast, long long election, time_t xmlrpc, bool lreads,
         const string& remotes_location);
 
     ~RaftManager()
@@ -87,6 +90,45 @@ public:
      */
     void replicate_log(ReplicaRequest * rr);
 
+    /**
+     *  Follower acknowledged a heartbeat. It is used to keep the leader lease
+     *    @param follower_id of the server
+     *    @param sent time when the heartbeat was sent
+     */
+    void heartbeat_success(int follower_id, const struct timespec& sent);
+
+    // -------------------------------------------------------------------------
+    // Linearizable reads on followers (read index protocol)
+    // -------------------------------------------------------------------------
+    /**
+     *  Returns the index that followers need to apply before serving a read
+     *  (LEADER). The leader needs to hold a lease: a majority of the servers
+     *  acknowledged a heartbeat sent within the last election timeout, so no
+     *  other leader can be elected; and it needs to know the commit index of
+     *  the previous terms.
+     *    @param index the commit index
+     *    @return 0 on success, -1 otherwise
+     */
+    int get_read_index(unsigned int& index);
+
+    /**
+     *  Waits until this server has applied all the records committed by the
+     *  leader when the call is made (FOLLOWER). Reads served afterwards from
+     *  the local DB are linearizable.
+     *    @param error description if any
+     *    @return 0 on success, -1 otherwise (the read should be forwarded to
+     *    the leader)
+     */
+    int read_barrier(std::string& error);
+
+    /**
+     *  @return true if followers serve linearizable reads
+     */
+    bool linearizable_reads_enabled()
+    {
+        return linearizable_reads;
+    }
+
 
     /**
      *  Finalizes the Raft Consensus Manager
@@ -147,7 +189,9 @@ public:
     }
 
 	/**
-     *  Update the commit index = min(leader_commit, log index).
+     *  Update the commit index = min(leader_commit, log index). When the log
+     *  is behind the leader the commit index is set to a previous leader
+     *  commit, so a federated batch is not partially applied.
 	 *  @param leader_commit index sent by leader in a replicate xml-rpc call
 	 *  @param index of the last record inserted in the database
 	 *  @return the updated commit index
@@ -170,6 +214,15 @@ public:
 	 */
 	void update_last_heartbeat(int leader_id);
 
+    /**
+     *  Checks if the zone has a live leader: this server is the leader, or
+     *  it got a heartbeat from the leader within the election timeout. Votes
+     *  are not granted in that case, so the leader lease used to serve reads
+     *  is not broken by a new election.
+     *    @return true if there is a live leader
+     */
+    bool leader_alive();
+
     /**
      *  @return true if the server is the leader of the zone, runs in solo mode
 	 *  or is a follower
@@ -254,6 +307,15 @@ public:
             unsigned int lterm, bool& success, unsigned int& fterm,
             std::string& error);
 
+    /**
+     *  Calls the read index xml-rpc method on the leader
+     *    @param index the read index returned by the leader
+     *    @param error describing error if any
+     *    @return -1 if the call fails (network error or leader rejected the
+     *    call), 0 otherwise
+     */
+    int xmlrpc_read_index(unsigned int& index, std::string& error);
+
     // -------------------------------------------------------------------------
     // Server related interface
     // -------------------------------------------------------------------------
@@ -317,9 +379,16 @@ private:
 
 	/**
 	 *  Time when the last heartbeat was sent (LEADER) or received (FOLLOWER)
+     *  (CLOCK_MONOTONIC)
 	 */
 	struct timespec last_heartbeat;
 
+    /**
+     *  Time when the last heartbeat from a leader was received (FOLLOWER),
+     *  (CLOCK_MONOTONIC)
+     */
+    struct timespec leader_heartbeat;
+
     /**
      *  ID of the last candidate we voted for  ( -1 if none )
      */
@@ -358,6 +427,8 @@ private:
     // Volatile log index variables
     //   - commit, highest log known to be committed
     //   - applied, highest log applied to DB (in LogDB)
+    //   - leader_commits, commit indexes sent by the leader beyond the log of
+    //     this follower. They are the boundaries of federated batches
     //
     //---------------------------- LEADER VARIABLES ----------------------------
     //
@@ -371,12 +442,27 @@ private:
 
     unsigned int commit;
 
+    std::set<unsigned int> leader_commits;
+
     std::map<int, unsigned int> next;
 
     std::map<int, unsigned int> match;
 
     std::map<int, std::string>  servers;
 
+    //--------------------------------------------------------------------------
+    // Leader lease & linearizable reads
+    //   - linearizable_reads, followers get the read index from the leader
+    //   - lease, time of the last heartbeat acked by each follower
+    //     <follower, time>
+    //   - term_index, last log index when this server became leader
+    // -------------------------------------------------------------------------
+    bool linearizable_reads;
+
+    std::map<int, struct timespec> lease;
+
+    unsigned int term_index;
+
     // -------------------------------------------------------------------------
     // Hooks
     // -------------------------------------------------------------------------
@@ -24,6 +24,7 @@
 #include "AuthRequest.h"
 #include "PoolObjectSQL.h"
 #include "Quotas.h"
+#include "MonitoringStore.h"
 
 using namespace std;
 
@@ -179,6 +180,8 @@ protected:
 
     bool leader_only; //Method can be only execute by leaders or solo servers
 
+    bool read_only; //Method only reads the DB, linearizable reads on followers
+
     static const long long xmlrpc_timeout; //Timeout (ms) for request forwarding
 
     /* ---------------------------------------------------------------------- */
@@ -195,6 +198,8 @@ protected:
         log_method_call = true;
 
         leader_only     = true;
+
+        read_only       = false;
     };
 
     virtual ~Request(){};
@@ -321,6 +326,23 @@ protected:
     bool basic_authorization(int oid, AuthRequest::Operation op,
         RequestAttributes& att);
 
+    /**
+     *  Gets the optional time range and resolution of the monitoring
+     *  requests: [start_time, end_time, resolution (seconds)] starting at
+     *  the given parameter. A failure response is sent on error.
+     *    @param paramList of the request
+     *    @param index of the start_time parameter
+     *    @param res resolution of the samples, RAW by default
+     *    @param start_time of the samples, -1 by default
+     *    @param end_time of the samples, -1 by default
+     *    @param att the specific request attributes
+     *
+     *    @return true if the parameters are valid.
+     */
+    bool monitoring_range(xmlrpc_c::paramList const& paramList,
+        unsigned int index, MonitoringStore::Resolution& res,
+        time_t& start_time, time_t& end_time, RequestAttributes& att);
+
     /**
      *  Performs a basic authorization for this request using the uid/gid
      *  from the request. The function gets the object from the pool to get
@@ -82,7 +82,7 @@ public:
     HostMonitoring():
         RequestManagerHost("one.host.monitoring",
                             "Returns the host monitoring records",
-                            "A:si")
+                            "A:si,A:sii,A:siii,A:siiii")
     {
         auth_op = AuthRequest::USE;
     };
@@ -36,6 +36,7 @@ protected:
         auth_op = AuthRequest::USE;
 
         leader_only = false;
+        read_only   = true;
     };
 
     ~RequestManagerInfo(){};
@@ -65,6 +65,7 @@ protected:
         :Request(method_name,signature,help)
     {
         leader_only = false;
+        read_only   = true;
     };
 
     ~RequestManagerPoolInfoFilter(){};
@@ -188,7 +189,7 @@ public:
     VirtualMachinePoolMonitoring():
         RequestManagerPoolInfoFilter("one.vmpool.monitoring",
                                      "Returns the virtual machine monitoring records",
-                                     "A:si")
+                                     "A:si,A:sii,A:siii,A:siiii")
     {
         Nebula& nd  = Nebula::instance();
         pool        = nd.get_vmpool();
@@ -297,7 +298,7 @@ public:
     HostPoolMonitoring():
         RequestManagerPoolInfoFilter("one.hostpool.monitoring",
                                      "Returns the host monitoring records",
-                                     "A:s")
+                                     "A:s,A:si,A:sii,A:siii")
     {
         Nebula& nd  = Nebula::instance();
         pool        = nd.get_hpool();
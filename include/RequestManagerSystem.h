@@ -79,6 +79,24 @@ public:
 /* ------------------------------------------------------------------------- */
 /* ------------------------------------------------------------------------- */
 
+class SystemQueues : public RequestManagerSystem
+{
+public:
+    SystemQueues():
+        RequestManagerSystem("one.system.queues",
+                          "Returns the queue statistics of the managers",
+                          "A:s")
+    {};
+
+    ~SystemQueues(){};
+
+    void request_execute(xmlrpc_c::paramList const& _paramList,
+                         RequestAttributes& att);
+};
+
+/* ------------------------------------------------------------------------- */
+/* ------------------------------------------------------------------------- */
+
 class SystemSql: public RequestManagerSystem
 {
 public:
@@ -192,7 +192,7 @@ public:
     VirtualMachineMonitoring():
         RequestManagerVirtualMachine("one.vm.monitoring",
                 "Returns the virtual machine monitoring records",
-                "A:si"){
+                "A:si,A:sii,A:siii,A:siiii"){
         auth_op = AuthRequest::USE;
     };
 
@@ -89,7 +89,7 @@ class ZoneReplicateLog : public RequestManagerZone
 public:
     ZoneReplicateLog():
         RequestManagerZone("one.zone.replicate", "Replicate a log record",
-                "A:siiiiiiis")
+                "A:siiiiiiii6")
     {
         log_method_call = false;
         leader_only     = false;
@@ -140,12 +140,31 @@ public:
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+class ZoneReadIndex : public RequestManagerZone
+{
+public:
+    ZoneReadIndex(): RequestManagerZone("one.zone.readindex",
+        "Returns the commit index to serve linearizable reads", "A:s")
+    {
+        log_method_call = false;
+        leader_only     = false;
+    };
+
+    ~ZoneReadIndex(){};
+
+    void request_execute(xmlrpc_c::paramList const& _paramList,
+                         RequestAttributes& att);
+};
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 class ZoneReplicateFedLog : public RequestManagerZone
 {
 public:
     ZoneReplicateFedLog():
-        RequestManagerZone("one.zone.fedreplicate", "Replicate a fed log record",
-                "A:sis")
+        RequestManagerZone("one.zone.fedreplicate",
+                "Replicate a batch of fed log records", "A:siA")
     {
         log_method_call = false;
     };
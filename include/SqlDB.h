@@ -18,6 +18,7 @@
 #define SQL_DB_H_
 
 #include <sstream>
+#include <vector>
 #include "Callbackable.h"
 
 using namespace std;
@@ -61,6 +62,14 @@ public:
         return exec(cmd, 0, false);
     }
 
+    /**
+     *  Performs a set of DB modifications locally (without replication) in a
+     *  single transaction. Either all the commands are applied or none.
+     *    @param cmds the SQL commands
+     *    @return 0 on success
+     */
+    virtual int exec_local_trx(const std::vector<std::string>& cmds) = 0;
+
     /**
      *  This function returns a legal SQL string that can be used in an SQL
      *  statement.
@@ -21,6 +21,8 @@
 
 #include "ActionManager.h"
 
+class MadManager;
+
 /**
  *  Base class to implement synchronous operation in the MadManagers. This class
  *  cannot be directly instantiated.
@@ -32,13 +34,18 @@ public:
         result(false),
         message(""),
         timeout(false),
-        id(-1),
-        time_out(0)
+        id(-1)
     {
         am.addListener(this);
     };
 
-    virtual ~SyncRequest(){};
+    virtual ~SyncRequest()
+    {
+        if ( timer.mm != 0 )
+        {
+            TimerWheel::instance().cancel(&timer);
+        }
+    };
 
     /**
      *  The result of the request, true if the operation succeeded
@@ -73,8 +80,6 @@ public:
      */
     void wait()
     {
-        time_out = time(0) + 90;//Requests will expire in 1.5 minutes
-
         am.loop();
     };
 
@@ -91,9 +96,21 @@ protected:
     friend class MadManager;
 
     /**
-     *  Time in seconds when this request will expire
+     *  Expires the request in the MadManager, see MadManager::add_request
      */
-    time_t  time_out;
+    class RequestTimer : public Timer
+    {
+    public:
+        RequestTimer():mm(0), id(-1){};
+
+        MadManager * mm;
+
+        int          id;
+
+        void expired();
+    };
+
+    RequestTimer timer;
 
     /**
      *  The ActionManager that will be notify when the request is ready.
@@ -0,0 +1,177 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <pthread.h>
+
+extern "C" void * timer_wheel_loop(void *arg);
+
+/**
+ *  A one-shot timer. The object is linked in the TimerWheel while it is
+ *  scheduled, so it MUST be canceled before being destroyed.
+ */
+class Timer
+{
+public:
+    Timer():expires(0), prev(0), next(0){};
+
+    virtual ~Timer(){};
+
+    /**
+     *  Executed by the TimerWheel thread when the timer expires. It should not
+     *  block, and it MUST NOT call the TimerWheel methods.
+     */
+    virtual void expired() = 0;
+
+private:
+    friend class TimerWheel;
+
+    /**
+     *  Tick when the timer expires
+     */
+    unsigned long long expires;
+
+    /**
+     *  Links of the wheel slot list, prev is 0 if the timer is not scheduled
+     */
+    Timer * prev;
+
+    Timer * next;
+};
+
+/**
+ *  Hierarchical timer wheel shared by all the components of the process. The
+ *  timers are stored in LEVELS wheels of SLOTS lists each; a wheel slot spans
+ *  SLOTS slots of the lower level. Schedule and cancel are O(1), timers are
+ *  moved to the lower level when its wheel wraps around.
+ *
+ *  The wheel thread only wakes up when a timer expires or the first wheel
+ *  wraps around (every SLOTS * TICK_MS ms).
+ */
+class TimerWheel
+{
+public:
+    /**
+     *  Resolution of the timers in milliseconds
+     */
+    static const unsigned int TICK_MS = 10;
+
+    /**
+     *  Gets the process timer wheel, the wheel thread is started the first
+     *  time it is used.
+     */
+    static TimerWheel& instance();
+
+    /**
+     *  Schedules a timer. If the timer is already scheduled it is moved to
+     *  the new expiration time.
+     *    @param timer to schedule
+     *    @param ms time to expire in milliseconds
+     */
+    void schedule(Timer * timer, unsigned long long ms);
+
+    /**
+     *  Cancels a timer. When this function returns the expired() method of
+     *  the timer is not being executed and it will not be executed.
+     *    @param timer to cancel, it may be not scheduled
+     */
+    void cancel(Timer * timer);
+
+private:
+    friend void * timer_wheel_loop(void *arg);
+
+    static const unsigned int LEVELS    = 4;
+
+    static const unsigned int SLOT_BITS = 8;
+
+    static const unsigned int SLOTS     = 1 << SLOT_BITS;
+
+    TimerWheel();
+
+    ~TimerWheel(){};
+
+    /**
+     *  Head of the slot lists (circular, doubly linked)
+     */
+    struct Slot: public Timer
+    {
+        void expired(){};
+    };
+
+    Slot                slots[LEVELS][SLOTS];
+
+    /**
+     *  Next tick to be processed by the wheel thread
+     */
+    unsigned long long  next_tick;
+
+    /**
+     *  Tick the wheel thread is sleeping until
+     */
+    unsigned long long  wakeup_tick;
+
+    /**
+     *  Monotonic time (ms) of tick 0
+     */
+    long long           start_ms;
+
+    pthread_t           thread;
+
+    pthread_mutex_t     mutex;
+
+    pthread_cond_t      cond;
+
+    /**
+     *  Current tick based on the monotonic clock
+     */
+    unsigned long long  current_tick();
+
+    /**
+     *  Links the timer in its slot, based on next_tick
+     */
+    void add(Timer * timer);
+
+    /**
+     *  Unlinks the timer from its slot
+     */
+    void remove(Timer * timer);
+
+    /**
+     *  Moves the timers of a slot to the lower levels
+     */
+    void cascade(unsigned int level, unsigned int slot);
+
+    /**
+     *  Processes a tick: cascades the higher levels and runs the timers of
+     *  the current slot
+     */
+    void run_tick();
+
+    /**
+     *  Tick of the next expiration event: the next non empty slot of the
+     *  first level or its wrap around
+     */
+    unsigned long long next_event();
+
+    /**
+     *  Main loop of the wheel thread
+     */
+    void loop();
+};
+
+#endif /*TIMER_WHEEL_H_*/
@@ -121,6 +121,15 @@ public:
         am.finalize();
     }
 
+    /**
+     *  Prints the statistics of the action queue, see ActionManager::to_xml
+     *    @param oss the output stream
+     */
+    void queue_to_xml(ostringstream& oss)
+    {
+        am.to_xml(oss);
+    }
+
     /**
      *  This functions starts the associated listener thread, and creates a
      *  new thread for the Information Manager. This thread will wait in
@@ -0,0 +1,124 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+#ifndef UPDATE_BATCH_H_
+#define UPDATE_BATCH_H_
+
+#include <pthread.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "SqlDB.h"
+
+using namespace std;
+
+/**
+ *  Deferred writes of the pool objects. The batch keeps the last row of each
+ *  object (per table) and writes the pending rows with multi-row REPLACE
+ *  statements when:
+ *    - there are MAX_ROWS pending rows
+ *    - the batch is flushed, periodically by the managers timers
+ *    - an object with pending rows is read or written through the pool
+ *
+ *  The last condition keeps the DB consistent for the pool users: pending
+ *  rows are always written before any other access to the object.
+ *
+ *  Batches are only used by solo servers. In HA the object rows are Raft
+ *  log records: a leader stepping down with pending rows could not
+ *  replicate them, so they are written (and replicated) when updated.
+ */
+class UpdateBatch
+{
+public:
+    UpdateBatch(SqlDB * _db);
+
+    ~UpdateBatch();
+
+    /**
+     *  Adds the row of an object to the batch. Any pending row of the object
+     *  in the same table is replaced. The object SHOULD be locked.
+     *    @param table of the row
+     *    @param db_names columns of the table, as in the REPLACE statement
+     *    @param oid of the object
+     *    @param row values of the row, e.g. "(0,'name','<BODY/>')"
+     */
+    void add(const char * table, const char * db_names, int oid,
+            const string& row);
+
+    /**
+     *  Writes the pending rows if the object has any of them. When this
+     *  function returns the rows of the object are in the DB.
+     *    @param oid of the object
+     */
+    void flush(int oid);
+
+    /**
+     *  Writes all the pending rows
+     */
+    void flush();
+
+private:
+    /**
+     *  Number of pending rows that triggers a flush
+     */
+    static const unsigned int MAX_ROWS = 512;
+
+    /**
+     *  Max size (bytes) of each REPLACE statement
+     */
+    static const unsigned int MAX_STATEMENT = 1048576;
+
+    /**
+     *  Pending rows of a table
+     */
+    struct Table
+    {
+        string          db_names;
+
+        map<int, string> rows;
+    };
+
+    SqlDB * db;
+
+    map<string, Table> tables;
+
+    /**
+     *  Objects with pending rows
+     */
+    set<int> oids;
+
+    unsigned int num_rows;
+
+    /**
+     *  Protects the pending rows
+     */
+    pthread_mutex_t mutex;
+
+    /**
+     *  Held while the rows are being written, so readers wait for them
+     */
+    pthread_mutex_t write_mutex;
+
+    /**
+     *  Takes the pending rows and writes them to the DB. The write_mutex MUST
+     *  be locked.
+     */
+    void write();
+};
+
+#endif /*UPDATE_BATCH_H_*/
@@ -304,6 +304,12 @@ public:
      */
     int update_info(const string& monitor_data);
 
+    /**
+     *  Updates VM dynamic information with monitoring information already
+     *  parsed (e.g. decoded from a binary payload), and updates last_poll
+     */
+    int update_info(const VirtualMachineMonitorInfo& monitor_info);
+
     /**
      *  Clears the VM monitor information usage counters (MEMORY, CPU),
      *  last_poll, custom attributes, and copies it to the history record
@@ -1786,6 +1792,16 @@ private:
      */
     int insert_replace(SqlDB *db, bool replace, string& error_str);
 
+    /**
+     *  Renders the values of the VM row in the pool table, as used in the
+     *  INSERT or REPLACE statements: "(oid, name, body, ...)"
+     *    @param db The SQL DB, to escape the strings
+     *    @param values of the row
+     *    @param error_str Returns the error reason, if any
+     *    @return 0 on success
+     */
+    int to_row(SqlDB *db, string& values, string& error_str);
+
     /**
      *  Updates the VM history record
      *    @param db pointer to the db
@@ -1817,12 +1833,11 @@ private:
     };
 
     /**
-     * Inserts the last monitoring, and deletes old monitoring entries.
-     *
-     * @param db pointer to the db
-     * @return 0 on success
+     *  Gets the numeric metrics stored in the monitoring history: the
+     *  MONITORING attributes and the CPU and MEMORY of the VM
+     *    @param metrics of the VM
      */
-    int update_monitoring(SqlDB * db);
+    void monitoring_metrics(MonitoringStore::Metrics& metrics) const;
 
     /**
      *  Function that renders the VM in XML format optinally including
@@ -2098,8 +2113,6 @@ protected:
 
     static const char * monit_table;
 
-    static const char * monit_db_names;
-
     static const char * monit_db_bootstrap;
 
     static const char * showback_table;
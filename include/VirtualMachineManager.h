@@ -121,6 +121,14 @@ public:
         am.finalize();
     }
 
+    /**
+     *  Prints the statistics of the action queue, see ActionManager::to_xml,
+     *  and the VM poll counters:
+     *    <POLL><VMS>polled VMs</VMS><MESSAGES>driver messages</MESSAGES></POLL>
+     *    @param oss the output stream
+     */
+    void queue_to_xml(ostringstream& oss);
+
     /**
      *  This functions starts the associated listener thread, and creates a
      *  new thread for the Virtual Machine Manager. This thread will wait in
@@ -234,6 +242,16 @@ private:
      */
     ActionManager           am;
 
+    /**
+     *  Loaded drivers, used to send their batched actions
+     */
+    vector<const VirtualMachineManagerDriver *> drivers;
+
+    /**
+     *  Number of VMs polled by the timer since the manager started
+     */
+    std::atomic<long long>  polled_vms;
+
     /**
      *  Function to execute the Manager action loop method within a new pthread
      * (requires C linkage)
@@ -288,6 +306,19 @@ private:
 
     void user_action(const ActionRequest& ar);
 
+    /**
+     *  Sends the actions batched by the drivers. Batches are sent once the
+     *  pending actions of the manager are processed, so a burst of actions
+     *  for a host is sent in a single message.
+     */
+    void flush_batches();
+
+    /**
+     *  @return the number of messages sent by the drivers to poll VMs
+     *  (POLLHOST, BATCH with POLL actions and individual POLL messages)
+     */
+    long long poll_messages() const;
+
     /**
      *  Function to format a VMM Driver message in the form:
      *  <VMM_DRIVER_ACTION_DATA>
@@ -304,6 +335,8 @@ private:
      *      </DATASTORE>
      *  </VMM_DRIVER_ACTION_DATA>
      *
+     *  The message is encoded by the driver when it is sent (see Mad::write)
+     *
      *    @param hostname of the host to perform the action
      *    @param m_hostname name of the host to migrate the VM
      *    @param domain domain id as returned by the hypervisor
@@ -20,6 +20,8 @@
 #include <map>
 #include <string>
 #include <sstream>
+#include <vector>
+#include <atomic>
 
 #include "Mad.h"
 #include "ActionSet.h"
@@ -45,7 +47,10 @@ public:
         bool                        sudo,
         VirtualMachinePool *        pool);
 
-    virtual ~VirtualMachineManagerDriver(){};
+    virtual ~VirtualMachineManagerDriver()
+    {
+        pthread_mutex_destroy(&batch_mutex);
+    };
 
     /**
      *  Implements the VM Manager driver protocol.
@@ -88,6 +93,17 @@ public:
     static void process_poll(VirtualMachine* vm, const string &monitor_str,
         bool update_db);
 
+    /**
+     * Updates the VM with the information gathered by the drivers, already
+     * parsed (e.g. decoded from a binary payload)
+     *
+     * @param vm VM to update, must be locked
+     * @param monitor_info of the VM, the STATE attribute is removed
+     * @param update_db write data to DB (or keep it in memory)
+     */
+    static void process_poll(VirtualMachine* vm,
+        VirtualMachineMonitorInfo &monitor_info, bool update_db);
+
     /**
      *  Check if action is supported for imported VMs
      *    @param action
@@ -142,6 +158,14 @@ protected:
 private:
     friend class VirtualMachineManager;
 
+    /**
+     * Triggers the LCM actions for the VM state reported by the drivers
+     *
+     * @param vm VM to update, must be locked
+     * @param state reported by the driver (a, p, e, d or - if unknown)
+     */
+    static void process_state(VirtualMachine* vm, char state);
+
     static const string imported_actions_default;
     static const string imported_actions_default_public;
 
@@ -292,13 +316,17 @@ private:
     /**
      *  Sends a poll request to the MAD: "POLL ID XML_DRV_MSG"
      *    @param oid the virtual machine id.
+     *    @param hid the host id, actions are batched per host
+     *    @param host the host name
      *    @param drv_msg xml data for the mad operation
      */
     void poll (
         const int     oid,
+        const int     hid,
+        const string& host,
         const string& drv_msg) const
     {
-        write_drv("POLL", oid, drv_msg);
+        batch_drv("POLL", oid, hid, host, drv_msg);
     }
 
     /**
@@ -328,25 +356,33 @@ private:
     /**
      *  Sends an attach NIC request to the MAD: "ATTACHNIC ID XML_DRV_MSG"
      *    @param oid the virtual machine id.
+     *    @param hid the host id, actions are batched per host
+     *    @param host the host name
      *    @param drv_msg xml data for the mad operation
      */
     void attach_nic (
         const int     oid,
+        const int     hid,
+        const string& host,
         const string& drv_msg) const
     {
-        write_drv("ATTACHNIC", oid, drv_msg);
+        batch_drv("ATTACHNIC", oid, hid, host, drv_msg);
     }
 
     /**
      *  Sends a detach request to the MAD: "DETACHNIC ID XML_DRV_MSG"
      *    @param oid the virtual machine id.
+     *    @param hid the host id, actions are batched per host
+     *    @param host the host name
      *    @param drv_msg xml data for the mad operation
      */
     void detach_nic (
         const int     oid,
+        const int     hid,
+        const string& host,
         const string& drv_msg) const
     {
-        write_drv("DETACHNIC", oid, drv_msg);
+        batch_drv("DETACHNIC", oid, hid, host, drv_msg);
     }
 
     /**
@@ -428,16 +464,139 @@ private:
     }
 
     /**
-     *
+     *  Sends an action to the driver: "ACTION ID XML_DRV_MSG". The XML message
+     *  is sent raw with the framed protocol, base64 encoded otherwise. Any
+     *  batched action is sent first to preserve the order of the messages.
      */
     void write_drv(const char * aname, const int oid, const string& msg) const
     {
         ostringstream os;
 
-        os << aname << " " << oid << " " << msg << endl;
+        flush();
+
+        os << aname << " " << oid;
+
+        write(os, msg);
+    }
+
+    // -------------------------------------------------------------------------
+    // Host polling
+    // -------------------------------------------------------------------------
+    /**
+     *  VMs of a host monitored with a single POLLHOST request
+     */
+    struct HostPoll
+    {
+        string          host;
+        vector<int>     oids;
+        vector<string>  deploy_ids;
+    };
+
+    /**
+     *  @return true if the driver can monitor all the VMs of a host with a
+     *  single request (it announces POLLHOST)
+     */
+    bool poll_host_supported() const
+    {
+        return capability("POLLHOST");
+    }
+
+    /**
+     *  Sends a request to monitor a set of VMs in a host:
+     *  "POLLHOST HID XML_POLL_MSG", where the XML document is:
+     *    <VMM_DRIVER_POLL_DATA>
+     *      <HOST_ID/><HOST/><VM><ID/><DEPLOY_ID/></VM>...
+     *    </VMM_DRIVER_POLL_DATA>
+     *  The driver answers with a POLL message for each VM, so the results are
+     *  processed as for individual poll requests.
+     *    @param hid the host id
+     *    @param poll the VMs to monitor
+     */
+    void poll_host(int hid, const HostPoll& poll) const;
+
+    /**
+     *  Number of messages sent to monitor VMs: POLLHOST, BATCH with POLL
+     *  actions and individual POLL messages. Each one is a remote invocation
+     */
+    mutable std::atomic<long long> poll_messages;
 
-        write(os);
+    /**
+     *  @return the number of messages sent to monitor VMs
+     */
+    long long get_poll_messages() const
+    {
+        return poll_messages.load(std::memory_order_relaxed);
     }
+
+    // -------------------------------------------------------------------------
+    // Batched actions
+    // -------------------------------------------------------------------------
+    /**
+     *  Maximum number of actions in a BATCH message
+     */
+    static const unsigned int BATCH_MAX_ACTIONS = 100;
+
+    /**
+     *  An action waiting to be sent in a BATCH message
+     */
+    struct BatchAction
+    {
+        string  name;
+        int     oid;
+        string  msg;
+    };
+
+    /**
+     *  Actions queued for a host
+     */
+    struct HostBatch
+    {
+        string              host;
+        vector<BatchAction> actions;
+    };
+
+    /**
+     *  Actions queued per host id, and mutex to access them
+     */
+    mutable map<int, HostBatch> batches;
+
+    mutable pthread_mutex_t     batch_mutex;
+
+    /**
+     *  Queues an action to be sent in a BATCH message with other actions for
+     *  the same host. Actions are sent when flush() is called or the batch
+     *  is full. If the driver does not support BATCH messages the action
+     *  is sent right away. Only short actions are batched (POLL, ATTACHNIC
+     *  and DETACHNIC), the driver runs them one after the other; long or
+     *  cancellable actions (e.g. DEPLOY, SAVE) are sent individually.
+     *    @param aname name of the action
+     *    @param oid the virtual machine id
+     *    @param hid the host id
+     *    @param host the host name
+     *    @param msg xml data for the mad operation
+     */
+    void batch_drv(const char * aname, int oid, int hid, const string& host,
+            const string& msg) const;
+
+    /**
+     *  Sends the queued actions, one message per host:
+     *  "BATCH HID XML_BATCH_MSG", where the XML document is:
+     *    <BATCH>
+     *      <HOST_ID/><HOST/>
+     *      <ACTION><NAME/><ID/><VMM_DRIVER_ACTION_DATA/></ACTION>...
+     *    </BATCH>
+     *  The driver reports the result of each action as if they were sent
+     *  individually. A batch with a single action is sent as a regular
+     *  message.
+     */
+    void flush() const;
+
+    /**
+     *  Sends the actions queued for a host
+     *    @param hid the host id
+     *    @param batch the actions
+     */
+    void write_batch(int hid, const HostBatch& batch) const;
 };
 
 /* -------------------------------------------------------------------------- */
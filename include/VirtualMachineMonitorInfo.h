@@ -18,6 +18,7 @@
 #define VIRTUAL_MACHINE_MONITOR_INFO_H_
 
 #include "Template.h"
+#include "MonitoringStore.h"
 
 #include <string.h>
 
@@ -59,6 +60,27 @@ public:
         return 0;
     };
 
+    /**
+     *  Gets the single attributes as metrics, non numeric values are
+     *  discarded by the MonitoringStore
+     *    @param prefix for the metric names
+     *    @param metrics of the VM
+     */
+    void metrics(const string& prefix, MonitoringStore::Metrics& metrics) const
+    {
+        multimap<string, Attribute *>::const_iterator it;
+
+        for (it = attributes.begin(); it != attributes.end(); ++it)
+        {
+            if ( it->second->type() == Attribute::SIMPLE )
+            {
+                SingleAttribute * sa = static_cast<SingleAttribute *>(it->second);
+
+                metrics[prefix + it->first] = sa->value();
+            }
+        }
+    };
+
     char remove_state()
     {
         string state_str;
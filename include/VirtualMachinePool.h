@@ -37,6 +37,8 @@ public:
                        const string&                remotes_location,
                        vector<const SingleAttribute *>& restricted_attrs,
                        time_t                       expire_time,
+                       time_t                       minute_expire_time,
+                       time_t                       hour_expire_time,
                        bool                         on_hold,
                        float                        default_cpu_cost,
                        float                        default_mem_cost,
@@ -124,9 +126,41 @@ public:
 
         vm->set_prev_state();
 
+        flush_batch(vm->get_oid());
+
         return vm->update(db);
     };
 
+    /**
+     *  Updates a monitored VM. The VM (and its current history record if
+     *  requested) is written to the DB with the next flush of the pool batch,
+     *  or right away in HA servers (no batch). The VM SHOULD be locked.
+     *    @param vm pointer to the VM
+     *    @param history true to update also the current history record
+     *
+     *    @return 0 on success.
+     */
+    int update_batch(VirtualMachine * vm, bool history);
+
+    /**
+     *  Sets the last_poll column of VMs monitored with no relevant changes,
+     *  their body is not written again. The column is not moved backwards
+     *  if the VM has been written after the monitoring.
+     *    @param oids of the VMs
+     *    @param last_poll time of the monitoring
+     *
+     *    @return 0 on success.
+     */
+    int update_last_poll(const vector<int>& oids, time_t last_poll);
+
+    /**
+     *  Writes the VMs and history records of the pool batch to the DB
+     */
+    void flush_updates()
+    {
+        flush_batch();
+    };
+
     /**
      *  Gets a VM ID by its deploy_id, the dedploy_id - VM id mapping is keep
      *  in the import_table.
@@ -180,6 +214,8 @@ public:
     int update_history(
         VirtualMachine * vm)
     {
+        flush_batch(vm->get_oid());
+
         return vm->update_history(db);
     }
 
@@ -191,12 +227,13 @@ public:
     int update_previous_history(
         VirtualMachine * vm)
     {
+        flush_batch(vm->get_oid());
+
         return vm->update_previous_history(db);
     }
 
     /**
-     * Inserts the last monitoring, and deletes old monitoring entries for this
-     * VM
+     * Adds the last monitoring sample of the VM to the monitoring history
      *
      * @param vm pointer to the virtual machine object
      * @return 0 on success
@@ -209,15 +246,18 @@ public:
             return 0;
         }
 
-        return vm->update_monitoring(db);
+        MonitoringStore::Metrics metrics;
+
+        vm->monitoring_metrics(metrics);
+
+        return monitoring.append(vm->get_oid(), vm->get_last_poll(), metrics);
     };
 
     /**
-     * Deletes the expired monitoring entries for all VMs
-     *
-     * @return 0 on success
+     * Writes the monitoring entries of all VMs whose time window has ended.
+     * Expired entries are deleted in the background by the store.
      */
-    int clean_expired_monitoring();
+    void write_ended_monitoring();
 
     /**
      * Deletes all monitoring entries for all VMs
@@ -226,6 +266,14 @@ public:
      */
     int clean_all_monitoring();
 
+    /**
+     * Writes the monitoring samples kept in memory to the DB
+     */
+    void flush_monitoring()
+    {
+        monitoring.flush();
+    };
+
     /**
      *  Bootstraps the database table(s) associated to the VirtualMachine pool
      *    @return 0 on success
@@ -299,28 +347,40 @@ public:
      *
      *  @param oss the output stream to dump the pool contents
      *  @param where filter for the objects, defaults to all
+     *  @param res resolution of the samples (raw, minute or hour rollups)
+     *  @param start_time of the samples, -1 for no limit
+     *  @param end_time of the samples, -1 for no limit
      *
      *  @return 0 on success
      */
-    int dump_monitoring(ostringstream& oss,
-                        const string&  where);
+    int dump_monitoring(ostringstream&              oss,
+                        const string&               where,
+                        MonitoringStore::Resolution res = MonitoringStore::RAW,
+                        time_t                      start_time = -1,
+                        time_t                      end_time = -1);
 
     /**
-     *  Dumps the VM monitoring information  for a single VM
+     *  Dumps the VM monitoring information for a single VM
      *
      *  @param oss the output stream to dump the pool contents
      *  @param vmid id of the target VM
+     *  @param res resolution of the samples (raw, minute or hour rollups)
+     *  @param start_time of the samples, -1 for no limit
+     *  @param end_time of the samples, -1 for no limit
      *
      *  @return 0 on success
      */
-    int dump_monitoring(ostringstream& oss,
-                        int            vmid)
+    int dump_monitoring(ostringstream&              oss,
+                        int                         vmid,
+                        MonitoringStore::Resolution res = MonitoringStore::RAW,
+                        time_t                      start_time = -1,
+                        time_t                      end_time = -1)
     {
         ostringstream filter;
 
         filter << "oid = " << vmid;
 
-        return dump_monitoring(oss, filter.str());
+        return dump_monitoring(oss, filter.str(), res, start_time, end_time);
     }
 
     /**
@@ -394,6 +454,11 @@ private:
      */
     time_t _monitor_expiration;
 
+    /**
+     * Monitoring history of the VMs
+     */
+    MonitoringStore monitoring;
+
     /**
      * True or false whether to submit new VM on HOLD or not
      */
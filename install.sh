@@ -1216,7 +1216,8 @@ ONEDB_LOCAL_MIGRATOR_FILES="src/onedb/local/4.5.80_to_4.7.80.rb \
                             src/onedb/local/4.11.80_to_4.13.80.rb \
                             src/onedb/local/4.13.80_to_4.13.85.rb \
                             src/onedb/local/4.13.85_to_4.90.0.rb \
-                            src/onedb/local/4.90.0_to_5.3.80.rb"
+                            src/onedb/local/4.90.0_to_5.3.80.rb \
+                            src/onedb/local/5.3.80_to_5.3.85.rb"
 
 ONEDB_PATCH_FILES="src/onedb/patches/4.14_monitoring.rb \
                    src/onedb/patches/history_times.rb"
@@ -123,7 +123,7 @@ extern "C" void * authm_action_loop(void *arg)
 
     NebulaLog::log("AuM",Log::INFO,"Authorization Manager started.");
 
-    authm->am.loop(authm->timer_period);
+    authm->am.loop();
 
     NebulaLog::log("AuM",Log::INFO,"Authorization Manager stopped.");
 
@@ -119,6 +119,8 @@ class OneZoneHelper < OpenNebulaHelper::OneHelper
         if zone.has_elements?("/ZONE/SERVER_POOL/SERVER")
             servers = zone_hash["ZONE"]["SERVER_POOL"]["SERVER"]
 
+            fed_zones = []
+
             [servers].flatten.each { |s|
                 endpoint = s["ENDPOINT"]
 
@@ -153,6 +155,20 @@ class OneZoneHelper < OpenNebulaHelper::OneHelper
 
                 s["LOG_INDEX"]    = xml_doc.root.at_xpath("LOG_INDEX").text
                 s["FEDLOG_INDEX"] = xml_doc.root.at_xpath("FEDLOG_INDEX").text
+
+                if s["STATE"] == "leader"
+                    xml_doc.root.xpath("FEDERATION_REPLICATION/ZONE").each { |z|
+                        fed_zones << {
+                            "ID"           => z.at_xpath("ID").text,
+                            "LAST_INDEX"   => z.at_xpath("LAST_INDEX").text,
+                            "LAG"          => z.at_xpath("LAG").text,
+                            "LAST_SUCCESS" => z.at_xpath("LAST_SUCCESS").text.to_i,
+                            "LAST_BATCH"   => z.at_xpath("LAST_BATCH").text,
+                            "LAST_RTT_MS"  => z.at_xpath("LAST_RTT_MS").text,
+                            "ERRORS"       => z.at_xpath("ERRORS").text
+                        }
+                    }
+                end
             }
 
             puts
@@ -211,6 +227,43 @@ class OneZoneHelper < OpenNebulaHelper::OneHelper
                 end
 
             end.show([zone_hash['ZONE']['SERVER_POOL']['SERVER']].flatten, {})
+
+            if !fed_zones.empty?
+                puts
+                CLIHelper.print_header(str_h1 % "FEDERATION REPLICATION",false)
+
+                CLIHelper::ShowTable.new(nil, self) do
+
+                    column :"ZONE", "", :size=>4 do |d|
+                        d["ID"] if !d.nil?
+                    end
+
+                    column :"FED_INDEX", "", :left, :size=>10 do |d|
+                        d["LAST_INDEX"] if !d.nil?
+                    end
+
+                    column :"LAG", "", :left, :size=>8 do |d|
+                        d["LAG"] if !d.nil?
+                    end
+
+                    column :"LAST_SYNC", "", :left, :size=>15 do |d|
+                        OpenNebulaHelper.time_to_str(d["LAST_SUCCESS"]) if !d.nil?
+                    end
+
+                    column :"BATCH", "", :left, :size=>6 do |d|
+                        d["LAST_BATCH"] if !d.nil?
+                    end
+
+                    column :"RTT_MS", "", :left, :size=>8 do |d|
+                        d["LAST_RTT_MS"] if !d.nil?
+                    end
+
+                    column :"ERRORS", "", :left, :size=>6 do |d|
+                        d["ERRORS"] if !d.nil?
+                    end
+
+                end.show(fed_zones, {})
+            end
         end
 
         puts
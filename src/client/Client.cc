@@ -32,6 +32,11 @@
 
 Client * Client::_client = 0;
 
+std::map<Client::ConnectionKey, std::list<Client::Connection *> >
+    Client::connections;
+
+pthread_mutex_t Client::connections_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
@@ -227,21 +232,19 @@ int Client::call(const std::string& endpoint, const std::string& method,
         const xmlrpc_c::paramList& plist, unsigned int _timeout,
         xmlrpc_c::value * const result, std::string& error)
 {
-    xmlrpc_c::clientXmlTransport_curl transport(
-        xmlrpc_c::clientXmlTransport_curl::constrOpt().timeout(_timeout));
+    ConnectionKey key(endpoint, _timeout);
 
-    xmlrpc_c::carriageParm_curl0  carriage(endpoint);
+    Connection * conn = 0;
 
-    xmlrpc_c::client_xml client(&transport);
-    xmlrpc_c::rpcPtr     rpc_client(method, plist);
+    xmlrpc_c::rpcPtr rpc_client(method, plist);
 
     int xml_rc = 0;
 
     try
     {
-        rpc_client->start(&client, &carriage);
+        conn = get_connection(key);
 
-        client.finishAsync(xmlrpc_c::timeout());
+        rpc_client->call(&conn->client, &conn->carriage);
 
         if ( rpc_client->isSuccessful() )
         {
@@ -261,6 +264,98 @@ int Client::call(const std::string& endpoint, const std::string& method,
         xml_rc = -1;
     }
 
+    if ( conn != 0 )
+    {
+        free_connection(key, conn, xml_rc == 0);
+    }
+
     return xml_rc;
 }
 
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+Client::Connection * Client::get_connection(const ConnectionKey& key)
+{
+    Connection * conn = 0;
+
+    std::map<ConnectionKey, std::list<Connection *> >::iterator it;
+
+    pthread_mutex_lock(&connections_mutex);
+
+    it = connections.find(key);
+
+    if ( it != connections.end() && !it->second.empty() )
+    {
+        conn = it->second.front();
+
+        it->second.pop_front();
+    }
+
+    pthread_mutex_unlock(&connections_mutex);
+
+    if ( conn == 0 )
+    {
+        conn = new Connection(key.first, key.second);
+    }
+
+    return conn;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void Client::free_connection(const ConnectionKey& key, Connection * conn,
+        bool reuse)
+{
+    if ( reuse )
+    {
+        pthread_mutex_lock(&connections_mutex);
+
+        std::list<Connection *>& idle = connections[key];
+
+        if ( idle.size() < POOL_SIZE )
+        {
+            idle.push_front(conn);
+            conn = 0;
+        }
+
+        pthread_mutex_unlock(&connections_mutex);
+    }
+
+    delete conn;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void Client::close_connections(const std::string& endpoint)
+{
+    std::list<Connection *> closed;
+
+    std::map<ConnectionKey, std::list<Connection *> >::iterator it;
+    std::list<Connection *>::iterator jt;
+
+    pthread_mutex_lock(&connections_mutex);
+
+    for ( it = connections.begin() ; it != connections.end() ; )
+    {
+        if ( it->first.first == endpoint )
+        {
+            closed.splice(closed.end(), it->second);
+
+            connections.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    pthread_mutex_unlock(&connections_mutex);
+
+    for ( jt = closed.begin() ; jt != closed.end() ; ++jt )
+    {
+        delete *jt;
+    }
+}
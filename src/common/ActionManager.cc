@@ -16,111 +16,660 @@
 
 #include "ActionManager.h"
 #include <ctime>
+#include <new>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
 
 /* ************************************************************************** */
-/* ActionManager constructor & destructor                                   */
+/* ActionRequest pool                                                         */
 /* ************************************************************************** */
 
-ActionManager::ActionManager(): listener(0)
+/*
+ *  Action requests are small objects, allocated by the producer thread and
+ *  freed by the manager thread. Blocks freed by any thread are pushed to a
+ *  shared lock-free stack. A thread allocating a block takes the whole stack
+ *  (so there is no ABA problem) and keeps it as a private cache.
+ */
+
+namespace
 {
-    pthread_mutex_init(&mutex,0);
+    const size_t ACTION_BLOCK_SIZE = 64;
+
+    struct FreeBlock
+    {
+        FreeBlock * next;
+    };
+
+    std::atomic<FreeBlock *> recycled(0);
+
+    void recycle(FreeBlock * first, FreeBlock * last)
+    {
+        FreeBlock * top = recycled.load(std::memory_order_relaxed);
+
+        do
+        {
+            last->next = top;
+        }
+        while (!recycled.compare_exchange_weak(top, first,
+                    std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /**
+     *  Per-thread cache of free blocks, returned to the shared stack when the
+     *  thread exits
+     */
+    struct BlockCache
+    {
+        FreeBlock * head;
+
+        BlockCache():head(0){};
+
+        ~BlockCache()
+        {
+            FreeBlock * last = head;
+
+            if ( last == 0 )
+            {
+                return;
+            }
+
+            while ( last->next != 0 )
+            {
+                last = last->next;
+            }
+
+            recycle(head, last);
+        }
+    };
+
+    thread_local BlockCache cache;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void * ActionRequest::operator new(size_t size)
+{
+    if ( size > ACTION_BLOCK_SIZE )
+    {
+        return ::operator new(size);
+    }
+
+    if ( cache.head == 0 )
+    {
+        cache.head = recycled.exchange(0, std::memory_order_acquire);
+
+        if ( cache.head == 0 )
+        {
+            return ::operator new(ACTION_BLOCK_SIZE);
+        }
+    }
+
+    FreeBlock * block = cache.head;
+
+    cache.head = block->next;
 
-    pthread_cond_init(&cond,0);
+    return block;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ActionRequest::operator delete(void * ptr, size_t size)
+{
+    if ( ptr == 0 )
+    {
+        return;
+    }
+
+    if ( size > ACTION_BLOCK_SIZE )
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    FreeBlock * block = static_cast<FreeBlock *>(ptr);
+
+    recycle(block, block);
+}
+
+/* ************************************************************************** */
+/* ActionQueue                                                                */
+/* ************************************************************************** */
+
+ActionQueue::ActionQueue(): head(&stub), tail(&stub),
+    stub(ActionRequest::TIMER), num_pending(0), waiting(false), efd(-1)
+{
+    for (int i = 0; i < ActionRequest::PRIORITIES; i++)
+    {
+        skipped[i] = 0;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+ActionQueue::~ActionQueue()
+{
+    std::unordered_map<int, std::deque<ActionRequest *> >::iterator it;
+
+    ActionRequest * action;
+
+    while ( (action = unlink()) != 0 )
+    {
+        delete action;
+    }
+
+    for (it = keys.begin(); it != keys.end(); ++it)
+    {
+        for (size_t i = 0; i < it->second.size(); i++)
+        {
+            delete it->second[i];
+        }
+    }
+
+    if ( efd != -1 )
+    {
+        close(efd);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void ActionQueue::link(ActionRequest * ar)
+{
+    ar->_next.store(0, std::memory_order_relaxed);
+
+    ActionRequest * prev = head.exchange(ar);
+
+    prev->_next.store(ar, std::memory_order_release);
+}
+
+/* -------------------------------------------------------------------------- */
+
+ActionRequest * ActionQueue::unlink()
+{
+    ActionRequest * _tail = tail;
+    ActionRequest * next  = _tail->_next.load(std::memory_order_acquire);
+
+    if ( _tail == &stub )
+    {
+        if ( next == 0 )
+        {
+            return 0;
+        }
+
+        tail  = next;
+        _tail = next;
+        next  = next->_next.load(std::memory_order_acquire);
+    }
+
+    if ( next != 0 )
+    {
+        tail = next;
+        return _tail;
+    }
+
+    if ( _tail != head.load() )
+    {
+        return 0; // A producer is linking a new action
+    }
+
+    link(&stub);
+
+    next = _tail->_next.load(std::memory_order_acquire);
+
+    if ( next != 0 )
+    {
+        tail = next;
+        return _tail;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void ActionQueue::push(ActionRequest * ar)
+{
+    link(ar);
+
+    if ( waiting.load() && waiting.exchange(false) )
+    {
+        uint64_t one = 1;
+
+        while ( ::write(efd, &one, sizeof(one)) == -1 && errno == EINTR );
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ActionQueue::drain()
+{
+    ActionRequest * action;
+
+    while ( (action = unlink()) != 0 )
+    {
+        std::deque<ActionRequest *>& actions = keys[action->key()];
+
+        actions.push_back(action);
+
+        if ( actions.size() == 1 )
+        {
+            ready[action->priority()].push_back(action->key());
+        }
+
+        num_pending++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+ActionRequest * ActionQueue::pop()
+{
+    int first   = -1;
+    int starved = -1;
+
+    drain();
+
+    for (int i = 0; i < ActionRequest::PRIORITIES; i++)
+    {
+        if ( ready[i].empty() )
+        {
+            continue;
+        }
+
+        if ( first == -1 )
+        {
+            first = i;
+        }
+        else if ( ++skipped[i] >= STARVATION_LIMIT && starved == -1 )
+        {
+            starved = i;
+        }
+    }
+
+    if ( first == -1 )
+    {
+        return 0;
+    }
+
+    int p = starved != -1 ? starved : first;
+
+    skipped[p] = 0;
+
+    int key = ready[p].front();
+
+    ready[p].pop_front();
+
+    std::unordered_map<int, std::deque<ActionRequest *> >::iterator it;
+
+    it = keys.find(key);
+
+    ActionRequest * action = it->second.front();
+
+    it->second.pop_front();
+
+    // The key is ready again with the priority of its next action
+    if ( it->second.empty() )
+    {
+        keys.erase(it);
+    }
+    else
+    {
+        ready[it->second.front()->priority()].push_back(key);
+    }
+
+    num_pending--;
+
+    return action;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ActionQueue::wait(int ms)
+{
+    struct pollfd pfd;
+    uint64_t      count;
+
+    if ( efd == -1 )
+    {
+        efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+
+    waiting.store(true);
+
+    // Check the queue again, a push may have missed the waiting flag
+    if ( !incoming_empty() || efd == -1 )
+    {
+        waiting.store(false);
+        return;
+    }
+
+    pfd.fd      = efd;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+
+    poll(&pfd, 1, ms);
+
+    waiting.store(false);
+
+    while ( read(efd, &count, sizeof(count)) == -1 && errno == EINTR );
+}
+
+/* ************************************************************************** */
+/* ActionManager constructor & destructor                                   */
+/* ************************************************************************** */
+
+ActionManager::ActionManager(): triggers(0), listener(0), num_workers(0)
+{
 }
 
 /* -------------------------------------------------------------------------- */
 
 ActionManager::~ActionManager()
 {
-    pthread_mutex_destroy(&mutex);
+    // Wait for triggers still accessing the manager
+    while ( triggers.load() != 0 )
+    {
+        sched_yield();
+    }
 
-    pthread_cond_destroy(&cond);
+    stop_workers();
 }
 
 /* ************************************************************************** */
 /* NeActionManager public interface                                           */
 /* ************************************************************************** */
 
+static long long now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* -------------------------------------------------------------------------- */
+
 void ActionManager::trigger(const ActionRequest& ar )
 {
-    lock();
+    triggers.fetch_add(1);
+
+    ActionRequest * action = ar.clone();
+
+    action->_time = now_ns();
+
+    stats[action->priority()].depth.fetch_add(1, std::memory_order_relaxed);
+
+    actions.push(action);
+
+    triggers.fetch_sub(1);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ActionManager::to_xml(std::ostringstream& oss)
+{
+    for (int i = 0; i < ActionRequest::PRIORITIES; i++)
+    {
+        PriorityStats& ps = stats[i];
+
+        long long num  = ps.actions.load(std::memory_order_relaxed);
+        long long wait = ps.wait_total.load(std::memory_order_relaxed);
+        long long max  = ps.wait_max.exchange(0, std::memory_order_relaxed);
+
+        oss << "<PRIORITY>"
+            << "<NAME>" << ActionRequest::priority_to_str(
+                    static_cast<ActionRequest::Priority>(i)) << "</NAME>"
+            << "<DEPTH>" << ps.depth.load(std::memory_order_relaxed)
+            << "</DEPTH>"
+            << "<ACTIONS>" << num << "</ACTIONS>"
+            << "<WAIT_AVG>" << (num > 0 ? wait / num / 1000 : 0)
+            << "</WAIT_AVG>"
+            << "<WAIT_MAX>" << max / 1000 << "</WAIT_MAX>"
+            << "</PRIORITY>";
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ActionManager::execute(const ActionRequest& ar)
+{
+    PriorityStats& ps = stats[ar.priority()];
+
+    long long wait = now_ns() - ar._time;
+    long long max  = ps.wait_max.load(std::memory_order_relaxed);
+
+    ps.depth.fetch_sub(1, std::memory_order_relaxed);
+
+    ps.actions.fetch_add(1, std::memory_order_relaxed);
+
+    ps.wait_total.fetch_add(wait, std::memory_order_relaxed);
+
+    while ( wait > max && !ps.wait_max.compare_exchange_weak(max, wait,
+                std::memory_order_relaxed) );
+
+    listener->_do_action(ar);
+}
+
+/* ************************************************************************** */
+/* Worker pool                                                                */
+/* ************************************************************************** */
+
+struct ActionWorker
+{
+    ActionManager * am;
+
+    ActionQueue     actions;
+
+    pthread_t       thread;
+};
+
+/* -------------------------------------------------------------------------- */
+
+extern "C" void * action_worker_loop(void *arg)
+{
+    ActionWorker * worker = static_cast<ActionWorker *>(arg);
+
+    worker->am->worker_loop(worker);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ActionManager::worker_loop(ActionWorker * worker)
+{
+    ActionRequest * action;
+
+    bool finalize = false;
+
+    while (true)
+    {
+        action = worker->actions.pop();
+
+        if ( action == 0 )
+        {
+            // The manager thread does not push actions after the finalize one
+            if ( finalize )
+            {
+                break;
+            }
 
-    actions.push(ar.clone());
+            worker->actions.wait(-1);
+            continue;
+        }
 
-    pthread_cond_signal(&cond);
+        if ( action->type() == ActionRequest::FINALIZE )
+        {
+            finalize = true;
+        }
+        else
+        {
+            execute(*action);
+        }
 
-    unlock();
+        delete action;
+    }
 }
 
 /* -------------------------------------------------------------------------- */
+
+void ActionManager::start_workers()
+{
+    pthread_attr_t pattr;
+
+    pthread_attr_init(&pattr);
+    pthread_attr_setdetachstate(&pattr, PTHREAD_CREATE_JOINABLE);
+
+    for (unsigned int i = 0; i < num_workers; i++)
+    {
+        ActionWorker * worker = new ActionWorker;
+
+        worker->am = this;
+
+        if ( pthread_create(&worker->thread, &pattr, action_worker_loop,
+                (void *) worker) != 0 )
+        {
+            delete worker;
+            break;
+        }
+
+        workers.push_back(worker);
+    }
+
+    pthread_attr_destroy(&pattr);
+}
+
 /* -------------------------------------------------------------------------- */
 
-static void set_timeout(struct timespec& timeout, struct timespec& _tout)
+void ActionManager::stop_workers()
 {
-    clock_gettime(CLOCK_REALTIME, &timeout);
+    std::vector<ActionWorker *>::iterator it;
+
+    for (it = workers.begin(); it != workers.end(); ++it)
+    {
+        (*it)->actions.push(new ActionRequest(ActionRequest::FINALIZE));
+    }
+
+    for (it = workers.begin(); it != workers.end(); ++it)
+    {
+        pthread_join((*it)->thread, 0);
+
+        delete *it;
+    }
+
+    workers.clear();
+}
+
+/* -------------------------------------------------------------------------- */
 
-    timeout.tv_sec  += _tout.tv_sec;
-    timeout.tv_nsec += _tout.tv_nsec;
+bool ActionManager::dispatch(ActionRequest * ar)
+{
+    int key = ar->key();
 
-    while ( timeout.tv_nsec >= 1000000000 )
+    if ( workers.empty() || key < 0 || ar->type() != ActionRequest::USER )
     {
-        timeout.tv_sec  += 1;
-        timeout.tv_nsec -= 1000000000;
+        return false;
     }
+
+    workers[key % workers.size()]->actions.push(ar);
+
+    return true;
 }
 
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 void ActionManager::loop(struct timespec& _tout, const ActionRequest& trequest)
 {
-    struct timespec timeout;
+    bool timer    = _tout.tv_sec != 0 || _tout.tv_nsec != 0;
+    int  finalize = 0;
 
-    int finalize = 0;
-    int rc;
+    unsigned long long period = _tout.tv_sec * 1000ULL + _tout.tv_nsec/1000000;
 
     ActionRequest * action;
+    ActionRequest * frequest = 0;
+
+    tick.am      = this;
+    tick.request = &trequest;
+
+    if ( timer )
+    {
+        TimerWheel::instance().schedule(&tick, period);
+    }
 
-    set_timeout(timeout, _tout);
+    start_workers();
 
     //Action Loop, end when a finalize action is triggered to this manager
     while (finalize == 0)
     {
-        lock();
+        action = actions.pop();
 
-        while ( actions.empty() == true )
+        if ( action == 0 && frequest != 0 )
         {
-            if ( _tout.tv_sec != 0 || _tout.tv_nsec != 0 )
-            {
-                rc = pthread_cond_timedwait(&cond, &mutex, &timeout);
+            // Pending actions of the workers are executed before finalizing
+            stop_workers();
 
-                if ( rc == ETIMEDOUT )
-                    actions.push(trequest.clone());
-            }
-            else
-                pthread_cond_wait(&cond,&mutex);
-        }
+            execute(*frequest);
+
+            delete frequest;
 
-        action = actions.front();
-        actions.pop();
+            finalize = 1;
+            continue;
+        }
 
-        unlock();
+        if ( action == 0 )
+        {
+            actions.wait(-1);
+            continue;
+        }
 
-        listener->_do_action(*action);
+        if ( dispatch(action) )
+        {
+            continue;
+        }
 
-        switch(action->type())
+        if ( action->type() == ActionRequest::FINALIZE )
         {
-            case ActionRequest::TIMER:
-                set_timeout(timeout, _tout);
-            break;
+            // Executed once all the pending actions are done
+            if ( frequest != 0 )
+            {
+                stats[action->priority()].depth.fetch_sub(1,
+                        std::memory_order_relaxed);
 
-            case ActionRequest::FINALIZE:
-                finalize = 1;
-            break;
+                delete action;
+            }
+            else
+            {
+                frequest = action;
+            }
 
-            default:
-            break;
+            continue;
+        }
+
+        execute(*action);
+
+        // The timer is armed again after each timer action, so they do not
+        // pile up in the queue if the manager is busy
+        if ( timer && action->type() == ActionRequest::TIMER )
+        {
+            TimerWheel::instance().schedule(&tick, period);
         }
 
         delete action;
     }
+
+    if ( timer )
+    {
+        TimerWheel::instance().cancel(&tick);
+    }
 }
 
 /* -------------------------------------------------------------------------- */
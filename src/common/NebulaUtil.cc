@@ -387,7 +387,8 @@ void split_unique(const std::string& st, char delim, std::set<std::string>& res)
  */
 #define ZBUFFER 16384
 
-std::string * one_util::zlib_compress(const std::string& in, bool base64)
+std::string * one_util::zlib_compress(const std::string& in, bool base64,
+        int level)
 {
     z_stream zs;
 
@@ -405,7 +406,7 @@ std::string * one_util::zlib_compress(const std::string& in, bool base64)
     zs.zfree  = Z_NULL;
     zs.opaque = Z_NULL;
 
-    if ( deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK )
+    if ( deflateInit(&zs, level) != Z_OK )
     {
         return 0;
     }
@@ -0,0 +1,274 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+#include "TimerWheel.h"
+
+#include <ctime>
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+static long long now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/* -------------------------------------------------------------------------- */
+
+extern "C" void * timer_wheel_loop(void *arg)
+{
+    TimerWheel * wheel = static_cast<TimerWheel *>(arg);
+
+    wheel->loop();
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+TimerWheel& TimerWheel::instance()
+{
+    // Never destroyed, the wheel thread runs until the process exits
+    static TimerWheel * wheel = new TimerWheel();
+
+    return *wheel;
+}
+
+/* -------------------------------------------------------------------------- */
+
+TimerWheel::TimerWheel():next_tick(0), wakeup_tick(0), start_ms(now_ms())
+{
+    pthread_condattr_t cattr;
+    pthread_attr_t     pattr;
+
+    for (unsigned int i = 0; i < LEVELS; i++)
+    {
+        for (unsigned int j = 0; j < SLOTS; j++)
+        {
+            slots[i][j].prev = &slots[i][j];
+            slots[i][j].next = &slots[i][j];
+        }
+    }
+
+    pthread_mutex_init(&mutex, 0);
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+
+    pthread_cond_init(&cond, &cattr);
+
+    pthread_condattr_destroy(&cattr);
+
+    pthread_attr_init(&pattr);
+    pthread_attr_setdetachstate(&pattr, PTHREAD_CREATE_DETACHED);
+
+    pthread_create(&thread, &pattr, timer_wheel_loop, (void *) this);
+
+    pthread_attr_destroy(&pattr);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+unsigned long long TimerWheel::current_tick()
+{
+    return (now_ms() - start_ms) / TICK_MS;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::add(Timer * timer)
+{
+    unsigned long long max = (1ULL << (SLOT_BITS * LEVELS)) - 1;
+
+    if ( timer->expires < next_tick )
+    {
+        timer->expires = next_tick;
+    }
+    else if ( timer->expires - next_tick > max )
+    {
+        timer->expires = next_tick + max;
+    }
+
+    unsigned long long delta = timer->expires - next_tick;
+    unsigned int       level = 0;
+
+    while ( level < LEVELS - 1 && delta >= (1ULL << (SLOT_BITS * (level+1))) )
+    {
+        level++;
+    }
+
+    unsigned int slot = (timer->expires >> (SLOT_BITS * level)) & (SLOTS - 1);
+
+    Timer * head = &slots[level][slot];
+
+    timer->prev = head->prev;
+    timer->next = head;
+
+    head->prev->next = timer;
+    head->prev       = timer;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::remove(Timer * timer)
+{
+    timer->prev->next = timer->next;
+    timer->next->prev = timer->prev;
+
+    timer->prev = 0;
+    timer->next = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::cascade(unsigned int level, unsigned int slot)
+{
+    Timer * head = &slots[level][slot];
+
+    while ( head->next != head )
+    {
+        Timer * timer = head->next;
+
+        remove(timer);
+
+        add(timer);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::run_tick()
+{
+    unsigned int index = next_tick & (SLOTS - 1);
+
+    if ( index == 0 )
+    {
+        for (unsigned int level = 1; level < LEVELS; level++)
+        {
+            unsigned int slot = (next_tick >> (SLOT_BITS * level)) & (SLOTS-1);
+
+            cascade(level, slot);
+
+            if ( slot != 0 )
+            {
+                break;
+            }
+        }
+    }
+
+    next_tick++;
+
+    Timer * head = &slots[0][index];
+
+    while ( head->next != head )
+    {
+        Timer * timer = head->next;
+
+        remove(timer);
+
+        timer->expired();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+unsigned long long TimerWheel::next_event()
+{
+    unsigned int index = next_tick & (SLOTS - 1);
+
+    for (unsigned int i = index; i < SLOTS; i++)
+    {
+        if ( slots[0][i].next != &slots[0][i] )
+        {
+            return next_tick + (i - index);
+        }
+    }
+
+    return next_tick + (SLOTS - index);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::loop()
+{
+    struct timespec timeout;
+
+    pthread_mutex_lock(&mutex);
+
+    while (true)
+    {
+        unsigned long long now = current_tick();
+
+        while ( next_tick <= now )
+        {
+            run_tick();
+        }
+
+        wakeup_tick = next_event();
+
+        long long wakeup_ms = start_ms + wakeup_tick * TICK_MS;
+
+        timeout.tv_sec  = wakeup_ms / 1000;
+        timeout.tv_nsec = (wakeup_ms % 1000) * 1000000;
+
+        pthread_cond_timedwait(&cond, &mutex, &timeout);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::schedule(Timer * timer, unsigned long long ms)
+{
+    pthread_mutex_lock(&mutex);
+
+    if ( timer->prev != 0 )
+    {
+        remove(timer);
+    }
+
+    // Rounded up to the next tick, so the timer never expires early
+    timer->expires = current_tick() + (ms + TICK_MS - 1) / TICK_MS + 1;
+
+    add(timer);
+
+    if ( timer->expires < wakeup_tick )
+    {
+        pthread_cond_signal(&cond);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void TimerWheel::cancel(Timer * timer)
+{
+    pthread_mutex_lock(&mutex);
+
+    if ( timer->prev != 0 )
+    {
+        remove(timer);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
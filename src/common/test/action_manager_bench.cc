@@ -0,0 +1,230 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ *  Benchmark for the ActionManager. A set of producer threads trigger actions
+ *  to a manager that records the trigger-to-dispatch latency of each one.
+ *
+ *  Usage: action_manager_bench [-p producers] [-n actions] [-i interval]
+ *    -p number of producer threads (default 4)
+ *    -n number of actions triggered by each producer (default 250000)
+ *    -i microseconds between actions of a producer (default 0). Use it to
+ *       measure the latency when the manager is idle and needs a wake up
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "ActionManager.h"
+
+/* -------------------------------------------------------------------------- */
+
+static long long now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Action with the trigger timestamp                                          */
+/* -------------------------------------------------------------------------- */
+
+class BenchAction : public ActionRequest
+{
+public:
+    BenchAction(long long t):ActionRequest(ActionRequest::USER), _time(t){};
+
+    BenchAction(const BenchAction& o):ActionRequest(o._type), _time(o._time){};
+
+    long long time() const
+    {
+        return _time;
+    }
+
+    ActionRequest * clone() const
+    {
+        return new BenchAction(*this);
+    }
+
+private:
+    long long _time;
+};
+
+/* -------------------------------------------------------------------------- */
+/* Manager, stores the latency of each action                                 */
+/* -------------------------------------------------------------------------- */
+
+class BenchManager : public ActionListener
+{
+public:
+    BenchManager(unsigned int total)
+    {
+        latencies.reserve(total);
+
+        am.addListener(this);
+    };
+
+    ActionManager am;
+
+    std::vector<long long> latencies;
+
+    long long last;
+
+private:
+    void user_action(const ActionRequest& ar)
+    {
+        const BenchAction& ba = static_cast<const BenchAction&>(ar);
+
+        last = now_ns();
+
+        latencies.push_back(last - ba.time());
+    };
+};
+
+extern "C" void * bench_loop(void *arg)
+{
+    BenchManager * bm = static_cast<BenchManager *>(arg);
+
+    bm->am.loop();
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Producers                                                                  */
+/* -------------------------------------------------------------------------- */
+
+struct Producer
+{
+    BenchManager * bm;
+    unsigned int   num;
+    unsigned int   interval;
+};
+
+extern "C" void * bench_producer(void *arg)
+{
+    Producer * p = static_cast<Producer *>(arg);
+
+    for (unsigned int i = 0; i < p->num; i++)
+    {
+        BenchAction ba(now_ns());
+
+        p->bm->am.trigger(ba);
+
+        if ( p->interval > 0 )
+        {
+            usleep(p->interval);
+        }
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    unsigned int producers = 4;
+    unsigned int num       = 250000;
+    unsigned int interval  = 0;
+
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:n:i:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'p':
+                producers = strtoul(optarg, 0, 10);
+                break;
+            case 'n':
+                num = strtoul(optarg, 0, 10);
+                break;
+            case 'i':
+                interval = strtoul(optarg, 0, 10);
+                break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-p producers] "
+                    << "[-n actions] [-i interval]" << std::endl;
+                return -1;
+        }
+    }
+
+    BenchManager bm(producers * num);
+
+    pthread_t              consumer;
+    std::vector<pthread_t> threads(producers);
+    std::vector<Producer>  args(producers);
+
+    pthread_create(&consumer, 0, bench_loop, (void *) &bm);
+
+    long long start = now_ns();
+
+    for (unsigned int i = 0; i < producers; i++)
+    {
+        args[i].bm       = &bm;
+        args[i].num      = num;
+        args[i].interval = interval;
+
+        pthread_create(&threads[i], 0, bench_producer, (void *) &args[i]);
+    }
+
+    for (unsigned int i = 0; i < producers; i++)
+    {
+        pthread_join(threads[i], 0);
+    }
+
+    bm.am.finalize();
+
+    pthread_join(consumer, 0);
+
+    std::vector<long long>& lat = bm.latencies;
+
+    if ( lat.empty() )
+    {
+        return -1;
+    }
+
+    double secs = (bm.last - start) / 1e9;
+
+    std::sort(lat.begin(), lat.end());
+
+    long long sum = 0;
+
+    for (unsigned int i = 0; i < lat.size(); i++)
+    {
+        sum += lat[i];
+    }
+
+    std::cout << producers << " producers, " << lat.size() << " actions in "
+        << secs << "s, " << lat.size() / secs << " actions/s" << std::endl
+        << "latency (us): avg " << sum / lat.size() / 1000.0
+        << ", p50 " << lat[lat.size() / 2] / 1000.0
+        << ", p99 " << lat[lat.size() * 99 / 100] / 1000.0
+        << ", max " << lat.back() / 1000.0 << std::endl;
+
+    return lat.size() == producers * num ? 0 : -1;
+}
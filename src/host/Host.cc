@@ -16,6 +16,8 @@
 
 #include <limits.h>
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
 
 #include <iostream>
 #include <sstream>
@@ -73,19 +75,44 @@ const char * Host::db_bootstrap = "CREATE TABLE IF NOT EXISTS host_pool ("
 
 const char * Host::monit_table = "host_monitoring";
 
-const char * Host::monit_db_names = "hid, last_mon_time, body";
-
 const char * Host::monit_db_bootstrap = "CREATE TABLE IF NOT EXISTS "
-    "host_monitoring (hid INTEGER, last_mon_time INTEGER, body MEDIUMTEXT, "
-    "PRIMARY KEY(hid, last_mon_time))";
+    "host_monitoring (hid INTEGER, resolution INTEGER, start_time INTEGER, "
+    "end_time INTEGER, body MEDIUMTEXT, PRIMARY KEY(hid, resolution, start_time))";
 /* ------------------------------------------------------------------------ */
 /* ------------------------------------------------------------------------ */
 
 int Host::insert_replace(SqlDB *db, bool replace, string& error_str)
+{
+    ostringstream   oss;
+    string          values;
+
+    if ( to_row(db, values, error_str) != 0 )
+    {
+        return -1;
+    }
+
+    if(replace)
+    {
+        oss << "REPLACE";
+    }
+    else
+    {
+        oss << "INSERT";
+    }
+
+    // Construct the SQL statement to Insert or Replace
+
+    oss <<" INTO "<<table <<" ("<< db_names <<") VALUES " << values;
+
+    return db->exec_wr(oss);
+}
+
+/* ------------------------------------------------------------------------ */
+
+int Host::to_row(SqlDB *db, string& values, string& error_str)
 {
     ostringstream   oss;
 
-    int    rc;
     string xml_body;
 
     char * sql_hostname;
@@ -95,8 +122,6 @@ int Host::insert_replace(SqlDB *db, bool replace, string& error_str)
     set_user(0, "");
     set_group(GroupPool::ONEADMIN_ID, GroupPool::ONEADMIN_NAME);
 
-   // Update the Host
-
     sql_hostname = db->escape_str(name.c_str());
 
     if ( sql_hostname == 0 )
@@ -116,18 +141,7 @@ int Host::insert_replace(SqlDB *db, bool replace, string& error_str)
         goto error_xml;
     }
 
-    if(replace)
-    {
-        oss << "REPLACE";
-    }
-    else
-    {
-        oss << "INSERT";
-    }
-
-    // Construct the SQL statement to Insert or Replace
-
-    oss <<" INTO "<<table <<" ("<< db_names <<") VALUES ("
+    oss << "("
         <<          oid                 << ","
         << "'" <<   sql_hostname        << "',"
         << "'" <<   sql_xml             << "',"
@@ -140,12 +154,12 @@ int Host::insert_replace(SqlDB *db, bool replace, string& error_str)
         <<          other_u             << ","
         <<          cluster_id          << ")";
 
-    rc = db->exec_wr(oss);
-
     db->free_str(sql_hostname);
     db->free_str(sql_xml);
 
-    return rc;
+    values = oss.str();
+
+    return 0;
 
 error_xml:
     db->free_str(sql_hostname);
@@ -174,25 +188,46 @@ error_common:
 int Host::extract_ds_info(
             string          &parse_str,
             Template        &tmpl,
-            map<int, const VectorAttribute*> &ds)
+            map<int, const VectorAttribute*> &ds,
+            MonitorPayload  &payload)
 {
     char * error_msg;
     int    rc;
 
+    string error;
+
     vector<const VectorAttribute*> ds_att;
     vector<const VectorAttribute*>::const_iterator it;
 
     // -------------------------------------------------------------------------
-    // Parse Template
+    // Parse Template or decode the binary information
     // -------------------------------------------------------------------------
-    rc = tmpl.parse(parse_str, &error_msg);
+    if ( MonitorPayload::is_binary(parse_str) )
+    {
+        rc = payload.decode(parse_str, tmpl, error);
+    }
+    else
+    {
+        rc = tmpl.parse(parse_str, &error_msg);
+
+        if ( rc != 0 )
+        {
+            error = error_msg;
+
+            free(error_msg);
+        }
+    }
 
     if ( rc != 0 )
     {
         ostringstream ess;
 
-        ess << "Error parsing host information: " << error_msg
-            << ". Monitoring information: " << endl << parse_str;
+        ess << "Error parsing host information: " << error;
+
+        if ( !MonitorPayload::is_binary(parse_str) )
+        {
+            ess << ". Monitoring information: " << endl << parse_str;
+        }
 
         NebulaLog::log("ONE", Log::ERROR, ess);
 
@@ -201,8 +236,6 @@ int Host::extract_ds_info(
         set_template_error_message("Error parsing monitor information."
             " Check oned.log for more details.");
 
-        free(error_msg);
-
         return -1;
     }
 
@@ -520,60 +553,190 @@ void Host::error_info(const string& message, set<int> &vm_ids)
     touch(false);
 
     set_template_error_message(oss.str());
+
+    // VMs are moved to UNKNOWN, they need to be updated when found again
+    vm_polls->clear();
 }
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int Host::update_monitoring(SqlDB * db)
+/**
+ *  Splits a POLL string in NAME=VALUE pairs. Values may be quoted strings or
+ *  vectors, e.g. DISK_SIZE=[ID=0,SIZE=10]
+ */
+static void parse_poll(const string& poll,
+        vector<pair<string, string> >& values)
 {
-    ostringstream   oss;
-    int             rc;
+    size_t pos = 0;
+    size_t len = poll.size();
 
-    string xml_body;
-    string error_str;
-    char * sql_xml;
+    values.clear();
 
-    sql_xml = db->escape_str(to_xml(xml_body).c_str());
+    while ( pos < len )
+    {
+        pos = poll.find_first_not_of(" \t\n", pos);
 
-    if ( sql_xml == 0 )
+        if ( pos == string::npos )
+        {
+            break;
+        }
+
+        size_t start  = pos;
+        bool   quoted = false;
+        int    depth  = 0;
+
+        for (; pos < len; pos++)
+        {
+            char c = poll[pos];
+
+            if ( c == '"' )
+            {
+                quoted = !quoted;
+            }
+            else if ( !quoted && c == '[' )
+            {
+                depth++;
+            }
+            else if ( !quoted && c == ']' )
+            {
+                depth--;
+            }
+            else if ( !quoted && depth <= 0 &&
+                      (c == ' ' || c == '\t' || c == '\n') )
+            {
+                break;
+            }
+        }
+
+        string token = poll.substr(start, pos - start);
+        size_t eq    = token.find('=');
+
+        if ( eq == string::npos )
+        {
+            values.push_back(make_pair(token, ""));
+        }
+        else
+        {
+            values.push_back(make_pair(token.substr(0, eq),
+                        token.substr(eq + 1)));
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ *  Checks if two values are equal, numeric values are compared with a
+ *  relative threshold (%)
+ */
+static bool same_value(const string& prev, const string& value,
+        float threshold)
+{
+    if ( prev == value )
     {
-        goto error_body;
+        return true;
     }
 
-    if ( validate_xml(sql_xml) != 0 )
+    if ( threshold <= 0 || prev.empty() || value.empty() )
     {
-        goto error_xml;
+        return false;
     }
 
-    oss << "REPLACE INTO " << monit_table << " ("<< monit_db_names <<") VALUES ("
-        <<          oid             << ","
-        <<          last_monitored       << ","
-        << "'" <<   sql_xml         << "')";
+    char * end;
 
-    db->free_str(sql_xml);
+    double p = strtod(prev.c_str(), &end);
 
-    rc = db->exec_local_wr(oss);
+    if ( *end != '\0' )
+    {
+        return false;
+    }
 
-    return rc;
+    double v = strtod(value.c_str(), &end);
 
-error_xml:
-    db->free_str(sql_xml);
+    if ( *end != '\0' )
+    {
+        return false;
+    }
 
-    error_str = "could not transform the Host to XML.";
+    return fabs(v - p) <= fabs(p) * threshold / 100;
+}
 
-    goto error_common;
+/* -------------------------------------------------------------------------- */
 
-error_body:
-    error_str = "could not insert the Host in the DB.";
+void Host::unchanged_vms(const map<int,string>& found, float threshold,
+        time_t refresh_time, set<int>& unchanged)
+{
+    map<int, PollDigest>::iterator     it;
+    map<int, string>::const_iterator   jt;
 
-error_common:
-    oss.str("");
-    oss << "Error updating Host monitoring information, " << error_str;
+    time_t now = time(0);
+
+    if ( refresh_time <= 0 )
+    {
+        vm_polls->clear();
+        return;
+    }
+
+    // Remove the VMs not found in this cycle, they are updated when found
+    for (it = vm_polls->begin(); it != vm_polls->end(); )
+    {
+        if ( found.count(it->first) == 0 )
+        {
+            vm_polls->erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
 
-    NebulaLog::log("ONE",Log::ERROR, oss);
+    vector<pair<string, string> > values;
 
-    return -1;
+    for (jt = found.begin(); jt != found.end(); ++jt)
+    {
+        parse_poll(jt->second, values);
+
+        it = vm_polls->find(jt->first);
+
+        if ( it != vm_polls->end() &&
+             now - it->second.last_update < refresh_time &&
+             it->second.values.size() == values.size() )
+        {
+            vector<pair<string, string> >& prev = it->second.values;
+
+            size_t i = 0;
+
+            for (; i < values.size(); i++)
+            {
+                if ( prev[i].first != values[i].first ||
+                     !same_value(prev[i].second, values[i].second, threshold) )
+                {
+                    break;
+                }
+            }
+
+            if ( i == values.size() )
+            {
+                unchanged.insert(jt->first);
+                continue;
+            }
+        }
+
+        PollDigest& digest = (*vm_polls)[jt->first];
+
+        digest.last_update = now;
+
+        digest.values.swap(values);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void Host::monitoring_metrics(MonitoringStore::Metrics& metrics) const
+{
+    host_share.monitoring_metrics(metrics);
 }
 
 /* ------------------------------------------------------------------------ */
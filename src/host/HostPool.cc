@@ -40,9 +40,21 @@ HostPool::HostPool(SqlDB*                    db,
                    vector<const VectorAttribute *> hook_mads,
                    const string&             hook_location,
                    const string&             remotes_location,
-                   time_t                    expire_time)
-                        : PoolSQL(db, Host::table)
+                   time_t                    expire_time,
+                   time_t                    minute_expire_time,
+                   time_t                    hour_expire_time)
+                        : PoolSQL(db, Host::table), monitoring(db,
+                          Host::monit_table, "hid", Host::table, "HOST",
+                          "LAST_MON_TIME", expire_time, minute_expire_time,
+                          hour_expire_time)
 {
+    // Deferred writes are not used in HA, rows are replicated when updated
+    if ( Nebula::instance().get_server_id() == -1 )
+    {
+        batch = new UpdateBatch(db);
+    }
+
+    pthread_mutex_init(&schedule_mutex, 0);
 
     _monitor_expiration = expire_time;
 
@@ -153,6 +165,8 @@ HostPool::~HostPool()
     {
         delete it->second;
     } 
+
+    pthread_mutex_destroy(&schedule_mutex);
 };
 
 /* -------------------------------------------------------------------------- */
@@ -206,6 +220,12 @@ int HostPool::allocate (
 
     *oid = PoolSQL::allocate(host, error_str);
 
+    // New hosts are monitored in the next timer action
+    if ( *oid >= 0 )
+    {
+        schedule_monitor(*oid, time(0));
+    }
+
     return *oid;
 
 error_im:
@@ -230,95 +250,180 @@ error_common:
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int HostPool::discover_cb(void * _set, int num, char **values, char **names)
+void HostPool::discover(
+        set<int> *  discovered_hosts,
+        int         host_limit,
+        time_t      now)
 {
-    set<int> *  discovered_hosts;
-    string      im_mad;
-    int         hid;
+    map<int, time_t>::iterator it;
 
-    discovered_hosts = static_cast<set<int> *>(_set);
+    pthread_mutex_lock(&schedule_mutex);
 
-    if ( (num<1) || (values[0] == 0) )
+    while ( !monitor_queue.empty() &&
+            discovered_hosts->size() < static_cast<size_t>(host_limit) )
     {
-        return -1;
+        const Deadline& next = monitor_queue.top();
+
+        if ( next.first > now )
+        {
+            break;
+        }
+
+        it = monitor_deadlines.find(next.second);
+
+        if ( it != monitor_deadlines.end() && it->second == next.first )
+        {
+            discovered_hosts->insert(next.second);
+
+            monitor_deadlines.erase(it);
+        }
+
+        monitor_queue.pop();
     }
 
-    hid = atoi(values[0]);
+    pthread_mutex_unlock(&schedule_mutex);
+}
 
-    discovered_hosts->insert(hid);
+/* -------------------------------------------------------------------------- */
+
+void HostPool::schedule_monitor(int oid, time_t deadline)
+{
+    pthread_mutex_lock(&schedule_mutex);
+
+    monitor_deadlines[oid] = deadline;
+
+    monitor_queue.push(Deadline(deadline, oid));
+
+    pthread_mutex_unlock(&schedule_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void HostPool::unschedule_monitor(int oid)
+{
+    pthread_mutex_lock(&schedule_mutex);
+
+    monitor_deadlines.erase(oid);
+
+    pthread_mutex_unlock(&schedule_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int HostPool::init_schedule_cb(void * _hosts, int num, char **values,
+        char **names)
+{
+    vector<Deadline> * hosts = static_cast<vector<Deadline> *>(_hosts);
+
+    if ( (num<2) || (values[0] == 0) || (values[1] == 0) )
+    {
+        return -1;
+    }
+
+    hosts->push_back(Deadline(atol(values[1]), atoi(values[0])));
 
     return 0;
 }
 
 /* -------------------------------------------------------------------------- */
 
-int HostPool::discover(
-        set<int> *  discovered_hosts,
-        int         host_limit,
-        time_t      target_time)
+int HostPool::init_schedule(time_t monitor_period)
 {
-    ostringstream   sql;
-    int             rc;
+    ostringstream    sql;
+    vector<Deadline> hosts;
+    vector<Deadline> overdue;
+    int              rc;
+
+    flush_batch();
 
-    set_callback(static_cast<Callbackable::Callback>(&HostPool::discover_cb),
-                 static_cast<void *>(discovered_hosts));
+    set_callback(
+        static_cast<Callbackable::Callback>(&HostPool::init_schedule_cb),
+        static_cast<void *>(&hosts));
 
-    sql << "SELECT oid FROM " << Host::table
-        << " WHERE last_mon_time <= " << target_time
-        << " ORDER BY last_mon_time ASC LIMIT " << host_limit;
+    sql << "SELECT oid, last_mon_time FROM " << Host::table
+        << " ORDER BY last_mon_time ASC";
 
     rc = db->exec_rd(sql,this);
 
     unset_callback();
 
-    return rc;
+    if ( rc != 0 )
+    {
+        return rc;
+    }
+
+    time_t now = time(0);
+
+    pthread_mutex_lock(&schedule_mutex);
+
+    for (vector<Deadline>::iterator it = hosts.begin(); it != hosts.end(); ++it)
+    {
+        if ( monitor_deadlines.count(it->second) > 0 )
+        {
+            continue;
+        }
+
+        time_t deadline = it->first + monitor_period;
+
+        if ( deadline > now )
+        {
+            monitor_deadlines[it->second] = deadline;
+
+            monitor_queue.push(Deadline(deadline, it->second));
+        }
+        else
+        {
+            overdue.push_back(*it);
+        }
+    }
+
+    // Spread the overdue hosts evenly over the next monitoring period, least
+    // monitored first
+    for (size_t i = 0; i < overdue.size(); i++)
+    {
+        time_t deadline = now + (i * monitor_period) / overdue.size();
+
+        monitor_deadlines[overdue[i].second] = deadline;
+
+        monitor_queue.push(Deadline(deadline, overdue[i].second));
+    }
+
+    pthread_mutex_unlock(&schedule_mutex);
+
+    return 0;
 }
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
 int HostPool::dump_monitoring(
-        ostringstream& oss,
-        const string&  where)
+        ostringstream&              oss,
+        const string&               where,
+        MonitoringStore::Resolution res,
+        time_t                      start_time,
+        time_t                      end_time)
 {
-    ostringstream cmd;
+    vector<int> oids;
 
-    cmd << "SELECT " << Host::monit_table << ".body FROM " << Host::monit_table
-        << " INNER JOIN " << Host::table
-        << " WHERE hid = oid";
-
-    if ( !where.empty() )
+    if ( search(oids, where) != 0 )
     {
-        cmd << " AND " << where;
+        return -1;
     }
 
-    cmd << " ORDER BY hid, " << Host::monit_table << ".last_mon_time;";
-
-    return PoolSQL::dump(oss, "MONITORING_DATA", cmd);
+    return monitoring.dump(oss, where, oids, res, start_time, end_time);
 }
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int HostPool::clean_expired_monitoring()
+void HostPool::write_ended_monitoring()
 {
     if ( _monitor_expiration == 0 )
     {
-        return 0;
+        return;
     }
 
-    int             rc;
-    time_t          max_mon_time;
-    ostringstream   oss;
-
-    max_mon_time = time(0) - _monitor_expiration;
-
-    oss << "DELETE FROM " << Host::monit_table
-        << " WHERE last_mon_time < " << max_mon_time;
-
-    rc = db->exec_local_wr(oss);
-
-    return rc;
+    monitoring.write_ended();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -326,14 +431,7 @@ int HostPool::clean_expired_monitoring()
 
 int HostPool::clean_all_monitoring()
 {
-    ostringstream   oss;
-    int             rc;
-
-    oss << "DELETE FROM " << Host::monit_table;
-
-    rc = db->exec_local_wr(oss);
-
-    return rc;
+    return monitoring.clean_all();
 }
 
 /* -------------------------------------------------------------------------- */
@@ -349,7 +447,7 @@ HostPool::HostVM * HostPool::get_host_vm(int oid)
     {
         hvm = new HostVM;
 
-        host_vms.insert(make_pair(oid, new HostVM));
+        host_vms.insert(make_pair(oid, hvm));
     }
     else
     {
@@ -444,6 +444,29 @@ string& HostShare::to_xml(string& xml) const
 /* ------------------------------------------------------------------------ */
 /* ------------------------------------------------------------------------ */
 
+void HostShare::monitoring_metrics(MonitoringStore::Metrics& metrics) const
+{
+    const long long values[] = {disk_usage, mem_usage, cpu_usage, total_mem,
+        total_cpu, max_disk, max_mem, max_cpu, free_disk, free_mem, free_cpu,
+        used_disk, used_mem, used_cpu, running_vms};
+
+    const char * names[] = {"DISK_USAGE", "MEM_USAGE", "CPU_USAGE", "TOTAL_MEM",
+        "TOTAL_CPU", "MAX_DISK", "MAX_MEM", "MAX_CPU", "FREE_DISK", "FREE_MEM",
+        "FREE_CPU", "USED_DISK", "USED_MEM", "USED_CPU", "RUNNING_VMS"};
+
+    for (unsigned int i = 0; i < sizeof(values)/sizeof(long long); i++)
+    {
+        ostringstream oss;
+
+        oss << values[i];
+
+        metrics[string("HOST_SHARE/") + names[i]] = oss.str();
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* ------------------------------------------------------------------------ */
+
 int HostShare::from_xml_node(const xmlNodePtr node)
 {
     vector<xmlNodePtr> content;
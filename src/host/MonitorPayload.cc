@@ -0,0 +1,413 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+#include "MonitorPayload.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+const char * MonitorPayload::MAGIC = "ONEM";
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+MonitorPayload::~MonitorPayload()
+{
+    map<string, VirtualMachineMonitorInfo *>::iterator it;
+
+    for (it = polls.begin(); it != polls.end(); ++it)
+    {
+        delete it->second;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MonitorPayload::is_binary(const string& data)
+{
+    return data.size() > 4 && data.compare(0, 4, MAGIC) == 0 &&
+        data[4] == VERSION;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+static long long zigzag_decode(unsigned long long zz)
+{
+    return static_cast<long long>(zz >> 1) ^ -static_cast<long long>(zz & 1);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitorPayload::read_varint(unsigned long long& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 64 && pos < data->size(); shift += 7)
+    {
+        unsigned char byte = (*data)[pos++];
+
+        value |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+
+        if ( (byte & 0x80) == 0 )
+        {
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitorPayload::read_string(string& str)
+{
+    unsigned long long length;
+
+    if ( read_varint(length) != 0 || length > data->size() - pos )
+    {
+        return -1;
+    }
+
+    str.assign(*data, pos, length);
+
+    pos += length;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitorPayload::read_name(string& name)
+{
+    unsigned long long index;
+
+    if ( read_varint(index) != 0 )
+    {
+        return -1;
+    }
+
+    if ( index == 0 )
+    {
+        if ( read_string(name) != 0 || name.empty() )
+        {
+            return -1;
+        }
+
+        names.push_back(name);
+    }
+    else if ( index <= names.size() )
+    {
+        name = names[index - 1];
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitorPayload::read_single(int type, string& value)
+{
+    unsigned long long zz;
+    char               buffer[32];
+
+    switch (type)
+    {
+        case INT:
+            if ( read_varint(zz) != 0 )
+            {
+                return -1;
+            }
+
+            snprintf(buffer, sizeof(buffer), "%lld", zigzag_decode(zz));
+
+            value = buffer;
+            break;
+
+        case FLOAT:
+        {
+            unsigned long long bits = 0;
+            double             number;
+
+            if ( data->size() - pos < 8 )
+            {
+                return -1;
+            }
+
+            for (int i = 0; i < 8; i++)
+            {
+                bits |= static_cast<unsigned long long>(
+                        static_cast<unsigned char>((*data)[pos++])) << (8 * i);
+            }
+
+            memcpy(&number, &bits, sizeof(number));
+
+            snprintf(buffer, sizeof(buffer), "%.15g", number);
+
+            value = buffer;
+            break;
+        }
+
+        case STRING:
+            return read_string(value);
+
+        default:
+            return -1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ *  Renders a value as in the POLL string, quoted if needed. Quoted strings are
+ *  not unescaped by the template parser, so the value is written as is.
+ */
+static void poll_value(ostringstream& oss, const string& value)
+{
+    if ( !value.empty() && value[0] != '"' &&
+         value.find_first_of(" \t\n[],=#") == string::npos )
+    {
+        oss << value;
+    }
+    else
+    {
+        oss << '"' << value << '"';
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+Attribute * MonitorPayload::read_attribute(const string& name,
+        ostringstream * poll)
+{
+    string value;
+
+    if ( pos >= data->size() )
+    {
+        return 0;
+    }
+
+    int type = (*data)[pos++];
+
+    if ( type != VECTOR )
+    {
+        if ( read_single(type, value) != 0 )
+        {
+            return 0;
+        }
+
+        if ( poll != 0 )
+        {
+            *poll << name << "=";
+
+            poll_value(*poll, value);
+
+            *poll << " ";
+        }
+
+        return new SingleAttribute(name, value);
+    }
+
+    unsigned long long num;
+
+    if ( read_varint(num) != 0 )
+    {
+        return 0;
+    }
+
+    VectorAttribute * vattr = new VectorAttribute(name);
+
+    if ( poll != 0 )
+    {
+        *poll << name << "=[";
+    }
+
+    for (unsigned long long i = 0; i < num; i++)
+    {
+        string vname;
+
+        if ( read_name(vname) != 0 || pos >= data->size() )
+        {
+            delete vattr;
+            return 0;
+        }
+
+        type = (*data)[pos++];
+
+        if ( type == VECTOR || read_single(type, value) != 0 )
+        {
+            delete vattr;
+            return 0;
+        }
+
+        vattr->replace(vname, value);
+
+        if ( poll != 0 )
+        {
+            if ( i > 0 )
+            {
+                *poll << ",";
+            }
+
+            *poll << vname << "=";
+
+            poll_value(*poll, value);
+        }
+    }
+
+    if ( poll != 0 )
+    {
+        *poll << "] ";
+    }
+
+    return vattr;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int MonitorPayload::decode_vm(Template& tmpl)
+{
+    unsigned long long zz, num;
+    long long          id;
+
+    string         name;
+    ostringstream  oss;
+    ostringstream  poll;
+    Attribute *    attr;
+
+    if ( read_varint(zz) != 0 || read_varint(num) != 0 )
+    {
+        return -1;
+    }
+
+    id = zigzag_decode(zz);
+
+    VectorAttribute * vm = new VectorAttribute("VM");
+
+    oss << id;
+
+    vm->replace("ID", oss.str());
+
+    for (unsigned long long i = 0; i < num; i++)
+    {
+        if ( read_name(name) != 0 ||
+             (attr = read_attribute(name, 0)) == 0 )
+        {
+            delete vm;
+            return -1;
+        }
+
+        if ( attr->type() == Attribute::SIMPLE )
+        {
+            vm->replace(name, static_cast<SingleAttribute *>(attr)->value());
+        }
+
+        delete attr;
+    }
+
+    if ( read_varint(num) != 0 )
+    {
+        delete vm;
+        return -1;
+    }
+
+    VirtualMachineMonitorInfo * info = new VirtualMachineMonitorInfo();
+
+    for (unsigned long long i = 0; i < num; i++)
+    {
+        if ( read_name(name) != 0 ||
+             (attr = read_attribute(name, &poll)) == 0 )
+        {
+            delete info;
+            delete vm;
+            return -1;
+        }
+
+        info->set(attr);
+    }
+
+    vm->replace("POLL", poll.str());
+
+    // Keep the last information reported for a VM
+    VirtualMachineMonitorInfo *& previous =
+        polls[vm->vector_value("DEPLOY_ID")];
+
+    delete previous;
+
+    previous = info;
+
+    tmpl.set(vm);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitorPayload::decode(const string& _data, Template& tmpl, string& error)
+{
+    string name;
+
+    data = &_data;
+    pos  = 5;
+
+    names.clear();
+
+    while ( pos < data->size() )
+    {
+        int rc   = -1;
+        int type = (*data)[pos++];
+
+        if ( type == ATTR )
+        {
+            Attribute * attr;
+
+            if ( read_name(name) == 0 &&
+                 (attr = read_attribute(name, 0)) != 0 )
+            {
+                tmpl.set(attr);
+
+                rc = 0;
+            }
+        }
+        else if ( type == VM )
+        {
+            rc = decode_vm(tmpl);
+        }
+
+        if ( rc != 0 )
+        {
+            ostringstream oss;
+
+            oss << "Wrong binary monitoring information at byte " << pos;
+
+            error = oss.str();
+
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -157,19 +157,21 @@ int InformationManager::start_monitor(Host * host, bool update_remotes)
 
 void InformationManager::timer_action(const ActionRequest& ar)
 {
-    static int mark = 0;
+    static int  mark   = 0;
+    static bool leader = false;
 
-    int    rc;
     time_t now;
 
     set<int>           discovered_hosts;
     set<int>::iterator it;
 
-
     Host * host;
 
+    Host::HostState state;
+
+    time_t last_monitored;
     time_t monitor_length;
-    time_t target_time;
+    time_t next_monitor;
 
     mark = mark + timer_period;
 
@@ -179,21 +181,33 @@ void InformationManager::timer_action(const ActionRequest& ar)
         mark = 0;
     }
 
-    hpool->clean_expired_monitoring();
+    hpool->flush_updates();
 
-    now = time(0);
+    hpool->write_ended_monitoring();
 
-    target_time = now - monitor_period;
+    RaftManager * raftm = Nebula::instance().get_raftm();
 
-    rc = hpool->discover(&discovered_hosts, host_limit, target_time);
-
-    if ((rc != 0) || (discovered_hosts.empty() == true))
+    if ( !raftm->is_leader() && !raftm->is_solo() )
     {
+        leader = false;
         return;
     }
 
+    // Load the schedule on start, and the hosts created by the previous leader
+    if ( !leader )
+    {
+        hpool->init_schedule(monitor_period);
+
+        leader = true;
+    }
+
+    now = time(0);
+
+    hpool->discover(&discovered_hosts, host_limit, now);
+
     for( it=discovered_hosts.begin() ; it!=discovered_hosts.end() ; ++it )
     {
+        // Dropped hosts are not scheduled again
         host = hpool->get(*it,true);
 
         if (host == 0)
@@ -201,23 +215,33 @@ void InformationManager::timer_action(const ActionRequest& ar)
             continue;
         }
 
-        monitor_length = now - host->get_last_monitored();
+        state          = host->get_state();
+        last_monitored = host->get_last_monitored();
+        monitor_length = now - last_monitored;
+        next_monitor   = now + monitor_period;
 
-        switch (host->get_state())
+        switch (state)
         {
             // Not received an update in the monitor period.
             case Host::INIT:
             case Host::MONITORED:
             case Host::ERROR:
             case Host::DISABLED:
-                start_monitor(host, (host->get_last_monitored() == 0));
+                if ( monitor_length < monitor_period )
+                {
+                    // Monitored since it was scheduled (e.g. pushed by the
+                    // probes or re-enabled), check it a period after that
+                    next_monitor = last_monitored + monitor_period;
+                }
+                else
+                {
+                    start_monitor(host, (last_monitored == 0));
+                }
                 break;
 
-            // Update last_mon_time to rotate HostPool::discover output. Update
-            // monitoring values with 0s.
+            // Update monitoring values with 0s.
             case Host::OFFLINE:
-                host->touch(true);
-                hpool->update_monitoring(host);
+                hpool->update_monitoring(host, now);
                 break;
 
             // Host is being monitored for more than monitor_expire secs.
@@ -227,12 +251,24 @@ void InformationManager::timer_action(const ActionRequest& ar)
             case Host::MONITORING_MONITORED:
                 if (monitor_length >= monitor_expire )
                 {
-                    start_monitor(host, (host->get_last_monitored() == 0));
+                    start_monitor(host, (last_monitored == 0));
+                }
+                else
+                {
+                    // Check it again when the monitor action expires
+                    next_monitor = last_monitored + monitor_expire;
                 }
                 break;
         }
 
-        hpool->update(host);
+        // Only write the host if the monitor action was started
+        if ( state != host->get_state() ||
+             last_monitored != host->get_last_monitored() )
+        {
+            hpool->update(host);
+        }
+
+        hpool->schedule_monitor(*it, next_monitor);
 
         host->unlock();
     }
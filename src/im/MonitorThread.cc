@@ -36,26 +36,24 @@ LifeCycleManager * MonitorThread::lcm;
 
 VirtualMachineManager * MonitorThread::vmm;
 
-MonitorThreadPool * MonitorThread::mthpool;
-
 ClusterPool * MonitorThread::cpool;
 
 VirtualMachinePool * MonitorThread::vmpool;
 
 time_t MonitorThread::monitor_interval;
 
+float MonitorThread::poll_threshold;
+
+time_t MonitorThread::poll_refresh;
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-extern "C" void * do_message_thread(void *arg)
+extern "C" void * monitor_thread_loop(void *arg)
 {
-    MonitorThread * mt = static_cast<MonitorThread *>(arg);
-
-    mt->do_message();
+    MonitorThreadPool * mthpool = static_cast<MonitorThreadPool *>(arg);
 
-    MonitorThread::mthpool->exit_monitor_thread();
-
-    delete mt;
+    mthpool->thread_loop();
 
     return 0;
 };
@@ -124,12 +122,13 @@ void MonitorThread::do_message()
     map<int,const VectorAttribute*>            datastores;
     map<int, const VectorAttribute*>::iterator itm;
 
-    Template    tmpl;
-    Datastore * ds;
+    Template       tmpl;
+    MonitorPayload payload;
+    Datastore *    ds;
 
     set<int>    non_shared_ds;
 
-    int rc  = host->extract_ds_info(*hinfo, tmpl, datastores);
+    int rc  = host->extract_ds_info(*hinfo, tmpl, datastores, payload);
 
     int cid = host->get_cluster_id();
 
@@ -183,6 +182,7 @@ void MonitorThread::do_message()
     set<int>        lost;
     map<int,string> found;
     set<int>        rediscovered_vms;
+    set<int>        unchanged;
 
     ostringstream   oss;
 
@@ -205,7 +205,12 @@ void MonitorThread::do_message()
         return;
     }
 
-    hpool->update(host);
+    if (vm_poll)
+    {
+        host->unchanged_vms(found, poll_threshold, poll_refresh, unchanged);
+    }
+
+    hpool->update_batch(host);
 
     hpool->update_monitoring(host);
 
@@ -261,6 +266,9 @@ void MonitorThread::do_message()
             vm->unlock();
         }
 
+        vector<int> unchanged_oids;
+        time_t      unchanged_poll = 0;
+
         for (itm = found.begin(); itm != found.end(); itm++)
         {
             VirtualMachine * vm = vmpool->get(itm->first, true);
@@ -282,20 +290,73 @@ void MonitorThread::do_message()
                 continue;
             }
 
-            VirtualMachineManagerDriver::process_poll(vm, itm->second, true);
+            // Use the VM information decoded from a binary payload, if any
+            VirtualMachineMonitorInfo * poll =
+                payload.get_poll(vm->get_deploy_id());
+
+            // Running VMs with no relevant changes since their last update
+            // are not written again. The sample is added to the monitoring
+            // history and only their last_poll is updated in the DB.
+            if (unchanged.count(itm->first) == 1 &&
+                vm->get_state() == VirtualMachine::ACTIVE &&
+                vm->get_lcm_state() == VirtualMachine::RUNNING &&
+                vm->get_last_poll() != 0)
+            {
+                int rc = 0;
+
+                if ( poll != 0 )
+                {
+                    vm->update_info(*poll);
+                }
+                else
+                {
+                    rc = vm->update_info(itm->second);
+                }
+
+                if ( rc == 0 )
+                {
+                    vmpool->update_monitoring(vm);
+
+                    unchanged_oids.push_back(itm->first);
+
+                    if ( vm->get_last_poll() > unchanged_poll )
+                    {
+                        unchanged_poll = vm->get_last_poll();
+                    }
+
+                    vm->unlock();
+                    continue;
+                }
+            }
+
+            if ( poll != 0 )
+            {
+                VirtualMachineManagerDriver::process_poll(vm, *poll, true);
+            }
+            else
+            {
+                VirtualMachineManagerDriver::process_poll(vm, itm->second,
+                        true);
+            }
 
             vm->unlock();
         }
 
-        // The rediscovered set is not stored in the DB, the update method
-        // is not needed
-        host = hpool->get(host_id,true);
+        vmpool->update_last_poll(unchanged_oids, unchanged_poll);
 
-        if ( host != 0 )
+        // The rediscovered set is not stored in the DB, the update method
+        // is not needed. The host is only loaded if the set changes, as it
+        // would flush the pending update of the host.
+        if ( rediscovered_vms != prev_rediscovered )
         {
-            host->set_prev_rediscovered_vms(rediscovered_vms);
+            host = hpool->get(host_id,true);
 
-            host->unlock();
+            if ( host != 0 )
+            {
+                host->set_prev_rediscovered_vms(rediscovered_vms);
+
+                host->unlock();
+            }
         }
     }
 };
@@ -303,9 +364,11 @@ void MonitorThread::do_message()
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-MonitorThreadPool::MonitorThreadPool(int max_thr):concurrent_threads(max_thr),
-    running_threads(0)
+MonitorThreadPool::MonitorThreadPool(int max_thr):processed(0), dropped(0),
+    stop(false)
 {
+    pthread_attr_t attr;
+
     //Initialize the MonitorThread constants
     MonitorThread::dspool = Nebula::instance().get_dspool();
 
@@ -322,40 +385,106 @@ MonitorThreadPool::MonitorThreadPool(int max_thr):concurrent_threads(max_thr),
     Nebula::instance().get_configuration_attribute("MONITORING_INTERVAL",
         MonitorThread::monitor_interval);
 
-    MonitorThread::mthpool= this;
+    MonitorThread::poll_threshold = 0;
+    MonitorThread::poll_refresh   = 0;
+
+    vector<const VectorAttribute *> delta;
+
+    Nebula::instance().get_configuration_attribute("VM_MONITORING_DELTA",
+        delta);
+
+    if ( !delta.empty() )
+    {
+        delta[0]->vector_value("THRESHOLD", MonitorThread::poll_threshold);
+        delta[0]->vector_value("REFRESH_TIME", MonitorThread::poll_refresh);
+    }
 
     //Initialize concurrency variables
     pthread_mutex_init(&mutex,0);
 
     pthread_cond_init(&cond,0);
+
+    //Start the pool threads
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    for (int i = 0; i < max_thr; i++)
+    {
+        pthread_t id;
+
+        if ( pthread_create(&id, &attr, monitor_thread_loop, (void *)this) != 0 )
+        {
+            break;
+        }
+
+        threads.push_back(id);
+    }
+
+    pthread_attr_destroy(&attr);
 };
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-void MonitorThreadPool::do_message(int hid, const string& result,
-    const string& hinfo)
+MonitorThreadPool::~MonitorThreadPool()
 {
-    pthread_attr_t attr;
-    pthread_t id;
+    map<int, MonitorThread *>::iterator it;
 
     pthread_mutex_lock(&mutex);
 
-    while (running_threads >= concurrent_threads)
+    stop = true;
+
+    pthread_cond_broadcast(&cond);
+
+    pthread_mutex_unlock(&mutex);
+
+    for (size_t i = 0; i < threads.size(); i++)
     {
-        pthread_cond_wait(&cond, &mutex);
+        pthread_join(threads[i], 0);
     }
 
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (it = pending.begin(); it != pending.end(); ++it)
+    {
+        delete it->second;
+    }
+
+    pthread_mutex_destroy(&mutex);
 
+    pthread_cond_destroy(&cond);
+};
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void MonitorThreadPool::do_message(int hid, const string& result,
+    const string& hinfo)
+{
     MonitorThread * mt = new MonitorThread(hid, result, hinfo);
 
-    running_threads++;
+    pthread_mutex_lock(&mutex);
 
-    pthread_create(&id, &attr, do_message_thread, (void *)mt);
+    map<int, MonitorThread *>::iterator it = pending.find(hid);
 
-    pthread_attr_destroy(&attr);
+    if ( it != pending.end() )
+    {
+        delete it->second;
+
+        it->second = mt;
+
+        dropped++;
+    }
+    else
+    {
+        pending.insert(make_pair(hid, mt));
+
+        // Messages received while the host is being processed wait for it
+        if ( running.count(hid) == 0 )
+        {
+            ready.push_back(hid);
+
+            pthread_cond_signal(&cond);
+        }
+    }
 
     pthread_mutex_unlock(&mutex);
 };
@@ -363,13 +492,67 @@ void MonitorThreadPool::do_message(int hid, const string& result,
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-void MonitorThreadPool::exit_monitor_thread()
+void MonitorThreadPool::thread_loop()
 {
     pthread_mutex_lock(&mutex);
 
-    running_threads--;
+    while (true)
+    {
+        while ( ready.empty() && !stop )
+        {
+            pthread_cond_wait(&cond, &mutex);
+        }
+
+        if ( stop )
+        {
+            break;
+        }
+
+        int hid = ready.front();
+
+        ready.pop_front();
+
+        map<int, MonitorThread *>::iterator it = pending.find(hid);
+
+        MonitorThread * mt = it->second;
+
+        pending.erase(it);
+
+        running.insert(hid);
+
+        pthread_mutex_unlock(&mutex);
+
+        mt->do_message();
+
+        delete mt;
+
+        pthread_mutex_lock(&mutex);
+
+        running.erase(hid);
+
+        processed++;
+
+        if ( pending.count(hid) != 0 )
+        {
+            ready.push_back(hid);
+
+            pthread_cond_signal(&cond);
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+};
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void MonitorThreadPool::to_xml(ostringstream& oss)
+{
+    pthread_mutex_lock(&mutex);
 
-    pthread_cond_signal(&cond);
+    oss << "<DEPTH>"    << pending.size() << "</DEPTH>"
+        << "<MESSAGES>" << processed      << "</MESSAGES>"
+        << "<DROPPED>"  << dropped        << "</DROPPED>";
 
     pthread_mutex_unlock(&mutex);
 };
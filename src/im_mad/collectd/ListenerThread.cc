@@ -17,61 +17,229 @@
 #include "ListenerThread.h"
 
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
+#include <sstream>
+#include <iostream>
+
+/* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
+
+const size_t ListenerThread::MESSAGE_SIZE = 65536;
+const size_t ListenerThread::BATCH_SIZE   = 16;
+
 /* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+/**
+ *  Gets the host id of a monitor message: "MONITOR <result> <host id> <info>"
+ *    @return the host id, -1 if the message does not include it
+ */
+static int host_id(const char * message, size_t size)
+{
+    size_t i = 0;
+    int    hid;
+
+    for (int tokens = 0; tokens < 2; tokens++)
+    {
+        while ( i < size && message[i] != ' ' )
+        {
+            i++;
+        }
+
+        while ( i < size && message[i] == ' ' )
+        {
+            i++;
+        }
+    }
+
+    if ( i == size || message[i] < '0' || message[i] > '9' )
+    {
+        return -1;
+    }
+
+    for (hid = 0; i < size && message[i] >= '0' && message[i] <= '9'; i++)
+    {
+        hid = hid * 10 + (message[i] - '0');
+    }
+
+    return hid;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static std::string base64_encode(const std::string& in)
+{
+    static const char * b64 =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-const size_t ListenerThread::MESSAGE_SIZE = 100000;
-const size_t ListenerThread::BUFFER_SIZE  = 100;
+    std::string out;
+
+    size_t i = 0;
+
+    for (; i + 2 < in.size(); i += 3)
+    {
+        unsigned int v = ((unsigned char) in[i] << 16) |
+            ((unsigned char) in[i+1] << 8) | (unsigned char) in[i+2];
+
+        out += b64[(v >> 18) & 0x3F];
+        out += b64[(v >> 12) & 0x3F];
+        out += b64[(v >> 6) & 0x3F];
+        out += b64[v & 0x3F];
+    }
+
+    if ( i < in.size() )
+    {
+        unsigned int v = (unsigned char) in[i] << 16;
+
+        if ( i + 1 < in.size() )
+        {
+            v |= (unsigned char) in[i+1] << 8;
+        }
+
+        out += b64[(v >> 18) & 0x3F];
+        out += b64[(v >> 12) & 0x3F];
+        out += i + 1 < in.size() ? b64[(v >> 6) & 0x3F] : '=';
+        out += '=';
+    }
+
+    return out;
+}
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-void ListenerThread::flush_buffer(int fd)
+void ListenerThread::flush_buffer(std::vector<std::string>& messages)
 {
+    // Messages are swapped to the list, the strings are not copied
     lock();
 
-    std::vector<std::string>::iterator it;
+    std::map<int, std::string>::iterator it;
 
     for(it = monitor_data.begin() ; it != monitor_data.end(); ++it)
     {
-        size_t size = (*it).size();
-        const char * message = (*it).c_str();
+        messages.push_back(std::string());
 
-        write(fd, message, size);
+        messages.back().swap(it->second);
+    }
+
+    std::vector<std::string>::iterator jt;
+
+    for(jt = other_data.begin() ; jt != other_data.end(); ++jt)
+    {
+        messages.push_back(std::string());
+
+        messages.back().swap(*jt);
     }
 
     monitor_data.clear();
 
+    other_data.clear();
+
     unlock();
 }
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+void ListenerThread::store(const char * message, size_t size)
+{
+    int hid = host_id(message, size);
+
+    if ( hid == -1 )
+    {
+        other_data.push_back(std::string(message, size));
+    }
+    else
+    {
+        monitor_data[hid].assign(message, size);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void ListenerThread::store_oversized(const char * message, size_t size)
+{
+    std::ostringstream error;
+    std::ostringstream oss;
+
+    int hid = host_id(message, MESSAGE_SIZE);
+
+    error << "Monitor message too large (" << size << " bytes, max. "
+          << MESSAGE_SIZE << " bytes)";
+
+    std::cerr << error.str() << " from host " << hid << std::endl;
+
+    if ( hid == -1 )
+    {
+        return;
+    }
+
+    oss << "MONITOR FAILURE " << hid << " " << base64_encode(error.str())
+        << "\n";
+
+    monitor_data[hid] = oss.str();
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 void ListenerThread::monitor_loop()
 {
-    char   buffer[MESSAGE_SIZE];
-    size_t rc;
+    std::vector<char> buffer(BATCH_SIZE * MESSAGE_SIZE);
+
+    std::vector<struct mmsghdr> msgs(BATCH_SIZE);
+    std::vector<struct iovec>   iovs(BATCH_SIZE);
 
-    struct sockaddr addr;
-    socklen_t addr_size = sizeof(struct sockaddr);
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        iovs[i].iov_base = &buffer[i * MESSAGE_SIZE];
+        iovs[i].iov_len  = MESSAGE_SIZE;
+
+        msgs[i].msg_hdr.msg_iov    = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
     while(true)
     {
-        rc = recvfrom(socket, buffer, MESSAGE_SIZE, 0, &addr, &addr_size);
+        // Wait for a message and get the ones already queued in the socket.
+        // MSG_TRUNC returns the real size of truncated messages.
+        int rc = recvmmsg(socket, &msgs[0], BATCH_SIZE,
+                MSG_WAITFORONE | MSG_TRUNC, 0);
 
-        if (rc > 0 && rc < MESSAGE_SIZE)
+        if (rc <= 0)
         {
-            std::string message(buffer, rc);
-
-            lock();
+            continue;
+        }
 
-            monitor_data.push_back(message);
+        lock();
 
-            unlock();
+        for (int i = 0; i < rc; i++)
+        {
+            const char * message = &buffer[i * MESSAGE_SIZE];
+            size_t       size    = msgs[i].msg_len;
+
+            if ( size == 0 )
+            {
+                continue;
+            }
+
+            if ( size > MESSAGE_SIZE || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) )
+            {
+                store_oversized(message, size);
+            }
+            else
+            {
+                store(message, size);
+            }
         }
+
+        unlock();
     }
 }
 
@@ -90,13 +258,35 @@ extern "C" void * listener_main(void *arg)
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+ListenerPool::ListenerPool(int fd, const std::vector<int>& socks, size_t num)
+    :out_fd(fd), sockets(socks)
+{
+    for (size_t i = 0; i < num; i++)
+    {
+        listeners.push_back(new ListenerThread(socks[i % socks.size()]));
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+
 ListenerPool::~ListenerPool()
 {
-    std::vector<ListenerThread>::iterator it;
+    std::vector<ListenerThread *>::iterator it;
 
     for(it = listeners.begin() ; it != listeners.end(); ++it)
     {
-        pthread_cancel((*it).thread_id());
+        pthread_cancel((*it)->thread_id());
+
+        pthread_join((*it)->thread_id(), 0);
+
+        delete *it;
+    }
+
+    std::vector<int>::iterator jt;
+
+    for(jt = sockets.begin() ; jt != sockets.end(); ++jt)
+    {
+        close(*jt);
     }
 };
 
@@ -108,16 +298,16 @@ void ListenerPool::start_pool()
     pthread_attr_t attr;
     pthread_t id;
 
-    std::vector<ListenerThread>::iterator it;
+    std::vector<ListenerThread *>::iterator it;
 
     pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 
     for(it = listeners.begin() ; it != listeners.end(); ++it)
     {
-        pthread_create(&id, &attr, listener_main, (void *)&(*it));
+        pthread_create(&id, &attr, listener_main, (void *)(*it));
 
-        (*it).thread_id(id);
+        (*it)->thread_id(id);
     }
 
     pthread_attr_destroy(&attr);
@@ -128,10 +318,67 @@ void ListenerPool::start_pool()
 
 void ListenerPool::flush_pool()
 {
-    std::vector<ListenerThread>::iterator it;
+    std::vector<ListenerThread *>::iterator it;
 
     for(it = listeners.begin() ; it != listeners.end(); ++it)
     {
-        (*it).flush_buffer(out_fd);
+        (*it)->flush_buffer(messages);
     }
+
+    std::vector<struct iovec> iov;
+
+    iov.reserve(IOV_MAX);
+
+    size_t next = 0;
+
+    while ( next < messages.size() )
+    {
+        iov.clear();
+
+        for (; next < messages.size() && iov.size() < IOV_MAX; next++)
+        {
+            struct iovec msg;
+
+            msg.iov_base = const_cast<char *>(messages[next].data());
+            msg.iov_len  = messages[next].size();
+
+            iov.push_back(msg);
+        }
+
+        // Write the batch, a pipe may take just part of it
+        size_t i = 0;
+
+        while ( i < iov.size() )
+        {
+            ssize_t rc = writev(out_fd, &iov[i], iov.size() - i);
+
+            if ( rc < 0 )
+            {
+                if ( errno == EINTR )
+                {
+                    continue;
+                }
+
+                std::cerr << "Error writing monitor data: " << strerror(errno)
+                          << std::endl;
+
+                messages.clear();
+                return;
+            }
+
+            for (; i < iov.size() && static_cast<size_t>(rc) >= iov[i].iov_len;
+                    i++)
+            {
+                rc -= iov[i].iov_len;
+            }
+
+            if ( i < iov.size() )
+            {
+                iov[i].iov_base = static_cast<char *>(iov[i].iov_base) + rc;
+                iov[i].iov_len -= rc;
+            }
+        }
+    }
+
+    messages.clear();
 }
@@ -16,17 +16,18 @@
 
 #include <string>
 #include <vector>
+#include <map>
 
 #include <pthread.h>
 
 /**
  *  This class implements a listener thread for the IM collector. It receives
- *  messages from a UDP port and stores it in a BUFFER. The class is controlled
- *  by two parameters
- *    - BUFFER_SIZE the number of pre-allocated capacity to store monitor
- *      messages. It should be roughly equal to the number of hosts per thread
- *    - MESSAGE_SIZE the size of each monitor message (100K by default). Each VM
- *      needs ~100bytes so ~1000VMs per host
+ *  messages from a UDP port and keeps the last message of each host until the
+ *  buffer is flushed. The class is controlled by two parameters
+ *    - MESSAGE_SIZE the max. size of each monitor message, the largest UDP
+ *      datagram. Each VM needs ~100bytes so ~600VMs per host. Larger messages
+ *      are reported to OpenNebula as a monitor failure of the host
+ *    - BATCH_SIZE the number of messages received with a single call
  */
 class ListenerThread
 {
@@ -37,8 +38,6 @@ public:
     ListenerThread(int _socket):socket(_socket)
     {
         pthread_mutex_init(&mutex,0);
-
-        monitor_data.reserve(BUFFER_SIZE);
     };
 
     ~ListenerThread()
@@ -47,11 +46,11 @@ public:
     };
 
     /**
-     *  Write the contents of the message buffer to a descriptor. Buffer is
-     *  cleared
-     *    @param fd file descriptor to send monitor data.
+     *  Moves the contents of the message buffer to a list of messages. Buffer
+     *  is cleared
+     *    @param messages to append the monitor data.
      */
-    void flush_buffer(int fd);
+    void flush_buffer(std::vector<std::string>& messages);
 
     /**
      *  Waits for UDP messages in a loop and store them in a buffer
@@ -75,16 +74,40 @@ public:
     }
 
 private:
-    static const size_t MESSAGE_SIZE; /**< Monitor message size */
-    static const size_t BUFFER_SIZE;  /**< Pre-allocated capacoty */
+    static const size_t MESSAGE_SIZE; /**< Max. monitor message size */
+    static const size_t BATCH_SIZE;   /**< Messages per receive call */
 
     pthread_mutex_t mutex;
     pthread_t       _thread_id;
 
-    std::vector<std::string> monitor_data;
+    /**
+     *  Last message of each host since the last flush, by host id
+     */
+    std::map<int, std::string> monitor_data;
+
+    /**
+     *  Messages without a host id, they are sent as received
+     */
+    std::vector<std::string> other_data;
 
     int socket;
 
+    /**
+     *  Stores a message in the buffer, replacing any previous message of the
+     *  same host. The listener MUST be locked.
+     *    @param message received
+     *    @param size of the message
+     */
+    void store(const char * message, size_t size);
+
+    /**
+     *  Stores a monitor failure for the host that sent a message larger than
+     *  MESSAGE_SIZE. The listener MUST be locked.
+     *    @param message first MESSAGE_SIZE bytes of the message
+     *    @param size of the whole message
+     */
+    void store_oversized(const char * message, size_t size);
+
     void lock()
     {
         pthread_mutex_lock(&mutex);
@@ -113,21 +136,31 @@ class ListenerPool
 public:
     /**
      *  @param fd descriptor to flush the data
-     *  @param sock socket for the UDP connections
+     *  @param socks sockets for the UDP connections, bound to the same port
+     *  (SO_REUSEPORT) or a single socket shared by all the threads
      *  @param num number of threads in the pool
      */
-    ListenerPool(int fd, int sock, size_t num)
-        :listeners(num, ListenerThread(sock)), out_fd(fd), socket(sock){};
+    ListenerPool(int fd, const std::vector<int>& socks, size_t num);
 
     ~ListenerPool();
 
     void start_pool();
 
+    /**
+     *  Writes the messages of all the listeners to the descriptor, they are
+     *  coalesced in writev calls
+     */
     void flush_pool();
 
 private:
-    std::vector<ListenerThread> listeners;
+    std::vector<ListenerThread *> listeners;
+
+    /**
+     *  Messages being flushed, the capacity is kept between flushes
+     */
+    std::vector<std::string> messages;
 
     int out_fd;
-    int socket;
+
+    std::vector<int> sockets;
 };
@@ -18,13 +18,14 @@
 #include <iostream>
 
 #include <unistd.h>
-#include <sys/select.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <errno.h>
 #include <string.h>
 
+#include <vector>
+
 #include "OpenNebulaDriver.h"
 #include "ListenerThread.h"
 
@@ -33,35 +34,29 @@
 
 int OpenNebulaDriver::read_one(std::string& message)
 {
-    fd_set             in_pipes;
-    std::ostringstream oss;
-
-    char c;
-    int  rc;
+    char   buffer[READ_SIZE];
+    size_t eol;
 
-    FD_ZERO(&in_pipes);
-    FD_SET (0,&in_pipes);
+    while ((eol = input.find('\n')) == std::string::npos)
+    {
+        ssize_t rc = read(0, buffer, READ_SIZE);
 
-    rc = select(1, &in_pipes, NULL, NULL, NULL);
+        if ( rc < 0 && errno == EINTR )
+        {
+            continue;
+        }
 
-    if (rc == -1)
-    {
-        return -1;
-    }
+        if ( rc <= 0 )
+        {
+            return -1;
+        }
 
-    do
-    {
-        rc = read(0, (void *) &c, sizeof(char));
-        oss << c;
+        input.append(buffer, rc);
     }
-    while ( rc > 0 && c != '\n' );
 
-    if (rc <= 0)
-    {
-        return -1;
-    }
+    message = input.substr(0, eol + 1);
 
-    message = oss.str();
+    input.erase(0, eol + 1);
 
     return 0;
 }
@@ -117,15 +112,7 @@ void OpenNebulaDriver::driver_loop()
 int IMCollectorDriver::init_collector()
 {
     struct sockaddr_in im_server;
-    int rc;
-
-    int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
-
-    if ( sock < 0 )
-    {
-        std::cerr << strerror(errno);
-        return -1;
-    }
+    std::vector<int>   socks;
 
     im_server.sin_family = AF_INET;
     im_server.sin_port   = htons(_port);
@@ -140,17 +127,73 @@ int IMCollectorDriver::init_collector()
         return -1;
     }
 
-    rc = bind(sock, (struct sockaddr *) &im_server, sizeof(struct sockaddr_in));
+    // Each listener thread gets its own socket bound to the port, the kernel
+    // spreads the hosts among them. Use a single socket if not supported.
+    for (int i = 0; i < _threads && _threads > 1; i++)
+    {
+        int sock = create_socket(im_server, true);
+
+        if ( sock < 0 )
+        {
+            break;
+        }
+
+        socks.push_back(sock);
+    }
+
+    if ( socks.empty() )
+    {
+        int sock = create_socket(im_server, false);
+
+        if ( sock < 0 )
+        {
+            std::cerr << strerror(errno);
+            return -1;
+        }
+
+        socks.push_back(sock);
+    }
+
+    pool = new ListenerPool(1, socks, _threads);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int IMCollectorDriver::create_socket(const struct sockaddr_in& addr,
+        bool reuse_port)
+{
+    int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
 
-    if ( rc < 0 )
+    if ( sock < 0 )
     {
-        std::cerr << strerror(errno);
         return -1;
     }
 
-    pool = new ListenerPool(1, sock, _threads);
+    if ( reuse_port )
+    {
+#ifdef SO_REUSEPORT
+        int on = 1;
 
-    return 0;
+        if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)
+        {
+            close(sock);
+            return -1;
+        }
+#else
+        close(sock);
+        return -1;
+#endif
+    }
+
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(struct sockaddr_in)) < 0)
+    {
+        close(sock);
+        return -1;
+    }
+
+    return sock;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -18,6 +18,7 @@
 #define _OPENNEBULA_DRIVER_H
 
 #include <unistd.h>
+#include <netinet/in.h>
 #include <string>
 
 class OpenNebulaDriver
@@ -53,6 +54,16 @@ private:
      */
     void driver_loop();
 
+    /**
+     *  Size of the reads from OpenNebula
+     */
+    static const size_t READ_SIZE = 65536;
+
+    /**
+     *  Data read from OpenNebula not yet returned by read_one
+     */
+    std::string input;
+
     /**
      *  Read OpenNebula message
      *  @param message from OpenNebula
@@ -94,6 +105,14 @@ public:
 private:
     void driver_action(const std::string& action, std::istringstream &is){};
 
+    /**
+     *  Creates an UDP socket bound to the collector address
+     *    @param addr to bind the socket
+     *    @param reuse_port to share the port with other sockets (SO_REUSEPORT)
+     *    @return the socket, -1 on failure
+     */
+    int create_socket(const struct sockaddr_in& addr, bool reuse_port);
+
     std::string _address;
 
     int _port;
@@ -0,0 +1,311 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ *  Load generator for the collectd IM driver. Each simulated host sends
+ *  monitor messages from its own UDP socket, as the collectd-client probes
+ *  do. The messages dropped by the kernel because the listener sockets were
+ *  full (UDP RcvbufErrors) are read from /proc/net/snmp, so the collector
+ *  should run in the same machine. Increase the rate (or use -r 0) until
+ *  drops appear to get the max. packets/sec of the collector:
+ *
+ *    collectd -p 4124 -t 50 -f 5 | wc -l &
+ *    collectd_load -p 4124 -n 500 -r 0 -d 10
+ *
+ *  Usage: collectd_load [-a address] [-p port] [-n hosts] [-s size]
+ *                       [-t threads] [-r rate] [-d duration]
+ *    -a collector address (default 127.0.0.1)
+ *    -p collector port (default 4124)
+ *    -n number of hosts, one socket each (default 500)
+ *    -s size of the monitor information of each message (default 2048)
+ *    -t number of sender threads (default 4)
+ *    -r total messages per second, 0 sends as fast as possible (default 0)
+ *    -d duration of the test in seconds (default 10)
+ */
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* -------------------------------------------------------------------------- */
+
+struct Sender
+{
+    vector<int>    socks;
+    vector<string> messages;
+
+    struct sockaddr_in addr;
+
+    double rate;
+    double duration;
+
+    unsigned long long sent;
+    unsigned long long errors;
+};
+
+static double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* -------------------------------------------------------------------------- */
+
+extern "C" void * sender_main(void *arg)
+{
+    Sender * s = static_cast<Sender *>(arg);
+
+    size_t num   = s->socks.size();
+    size_t next  = 0;
+    double start = now();
+    double t     = start;
+
+    while ( t - start < s->duration )
+    {
+        unsigned long long target = 64;
+
+        if ( s->rate > 0 )
+        {
+            target = (unsigned long long) ((t - start) * s->rate) - s->sent;
+
+            if ( target == 0 )
+            {
+                usleep(1000);
+            }
+        }
+
+        for (unsigned long long i = 0; i < target; i++, next = (next+1) % num)
+        {
+            const string& msg = s->messages[next];
+
+            if (sendto(s->socks[next], msg.c_str(), msg.size(), 0,
+                    (struct sockaddr *) &s->addr, sizeof(s->addr)) < 0)
+            {
+                s->errors++;
+            }
+            else
+            {
+                s->sent++;
+            }
+        }
+
+        t = now();
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static long long udp_rcvbuf_errors()
+{
+    ifstream snmp("/proc/net/snmp");
+    string   names, values, line;
+
+    while ( getline(snmp, line) )
+    {
+        if ( line.compare(0, 4, "Udp:") != 0 )
+        {
+            continue;
+        }
+
+        if ( names.empty() )
+        {
+            names = line;
+        }
+        else
+        {
+            values = line;
+            break;
+        }
+    }
+
+    istringstream ins(names), ivs(values);
+    string name, value;
+
+    while ( ins >> name && ivs >> value )
+    {
+        if ( name == "RcvbufErrors" )
+        {
+            return atoll(value.c_str());
+        }
+    }
+
+    return -1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char ** argv)
+{
+    string address  = "127.0.0.1";
+    int    port     = 4124;
+    int    hosts    = 500;
+    int    size     = 2048;
+    int    threads  = 4;
+    double rate     = 0;
+    double duration = 10;
+    int    opt;
+
+    while ((opt = getopt(argc, argv, "a:p:n:s:t:r:d:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a': address  = optarg; break;
+            case 'p': port     = atoi(optarg); break;
+            case 'n': hosts    = atoi(optarg); break;
+            case 's': size     = atoi(optarg); break;
+            case 't': threads  = atoi(optarg); break;
+            case 'r': rate     = atof(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            default:
+                cerr << "Usage: " << argv[0] << " [-a address] [-p port] "
+                     << "[-n hosts] [-s size] [-t threads] [-r rate] "
+                     << "[-d duration]" << endl;
+                return -1;
+        }
+    }
+
+    if ( hosts <= 0 || size < 0 || threads <= 0 || threads > hosts ||
+         rate < 0 || duration <= 0 )
+    {
+        cerr << "Wrong arguments" << endl;
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+
+    memset(&addr, 0, sizeof(addr));
+
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(port);
+
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1)
+    {
+        cerr << "Wrong address: " << address << endl;
+        return -1;
+    }
+
+    vector<Sender> senders(threads);
+
+    string info(size, 'A');
+
+    for (int h = 0; h < hosts; h++)
+    {
+        Sender& s = senders[h % threads];
+
+        int sock = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+        if ( sock < 0 )
+        {
+            cerr << "Cannot create socket for host " << h << ": "
+                 << strerror(errno) << endl;
+            return -1;
+        }
+
+        ostringstream oss;
+
+        oss << "MONITOR SUCCESS " << h << " " << info << "\n";
+
+        s.socks.push_back(sock);
+        s.messages.push_back(oss.str());
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        senders[i].addr     = addr;
+        senders[i].rate     = rate / threads;
+        senders[i].duration = duration;
+        senders[i].sent     = 0;
+        senders[i].errors   = 0;
+    }
+
+    cout << hosts << " hosts, " << size << " bytes per message, " << threads
+         << " threads, rate " << (rate > 0 ? rate : 0) << " msg/s, "
+         << duration << "s" << endl;
+
+    long long drops = udp_rcvbuf_errors();
+    double    start = now();
+
+    vector<pthread_t> ids(threads);
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_create(&ids[i], 0, sender_main, (void *) &senders[i]);
+    }
+
+    unsigned long long sent   = 0;
+    unsigned long long errors = 0;
+
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(ids[i], 0);
+
+        sent   += senders[i].sent;
+        errors += senders[i].errors;
+    }
+
+    double elapsed = now() - start;
+
+    // Let the collector drain the socket buffers
+    sleep(1);
+
+    if ( drops != -1 )
+    {
+        drops = udp_rcvbuf_errors() - drops;
+    }
+
+    cout << "sent:      " << sent << " (" << (long long) (sent / elapsed)
+         << " msg/s), " << errors << " send errors" << endl;
+
+    if ( drops == -1 )
+    {
+        cout << "dropped:   unknown" << endl;
+    }
+    else
+    {
+        cout << "dropped:   " << drops << endl
+             << "received:  " << sent - drops << " ("
+             << (long long) ((sent - drops) / elapsed) << " msg/s)" << endl;
+    }
+
+    for (int i = 0; i < threads; i++)
+    {
+        for (size_t j = 0; j < senders[i].socks.size(); j++)
+        {
+            close(senders[i].socks[j]);
+        }
+    }
+
+    return 0;
+}
@@ -21,11 +21,219 @@ require 'base64'
 require 'resolv'
 require 'ipaddr'
 require 'zlib'
+require 'strscan'
 
 
 DIRNAME = File.dirname(__FILE__)
 REMOTE_DIR_UPDATE = File.join(DIRNAME, '../../.update')
 
+# Send the monitoring information in the compact binary format. oned decodes
+# it without parsing the probes output (see MonitorPayload.h)
+BINARY_MONITOR = false
+
+# Encodes the probes output (KEY=VALUE template) in the binary format: typed
+# numeric values, a table of attribute names and the VM list with the POLL
+# fields already split.
+class MonitorEncoder
+    MAGIC   = "ONEM"
+    VERSION = 1
+
+    # Records
+    ATTR = 1
+    VM   = 2
+
+    # Values
+    INT    = 0
+    FLOAT  = 1
+    STRING = 2
+    VECTOR = 3
+
+    NAME  = /[[:alnum:]_]+/
+    BLANK = /([[:blank:]\n]|#.*\n)*/
+
+    class ParseError < StandardError; end
+
+    # Returns the binary payload, nil if the data can not be encoded
+    def self.encode(text)
+        new.encode(text)
+    rescue ParseError, ArgumentError, RangeError
+        nil
+    end
+
+    def initialize
+        @names = {}
+        @out   = ''.force_encoding(Encoding::BINARY)
+    end
+
+    def encode(text)
+        @out << MAGIC << VERSION.chr
+
+        parse(text).each do |name, value|
+            if name == 'VM' && value.instance_of?(Array)
+                vm(value)
+            else
+                @out << ATTR.chr
+                name(name)
+                value(value)
+            end
+        end
+
+        @out
+    end
+
+    private
+
+    # Parses a template as the OpenNebula template parser does. Returns an
+    # array of [name, value], the value of vector attributes is an array of
+    # [name, value]
+    def parse(text)
+        s     = StringScanner.new(text)
+        attrs = []
+
+        loop do
+            s.skip(BLANK)
+
+            break if s.eos?
+
+            name = s.scan(NAME) or raise ParseError
+
+            s.skip(/[[:blank:]]*=[[:blank:]]*/) or raise ParseError
+
+            if s.skip(/\[/)
+                vector = []
+
+                loop do
+                    s.skip(/[[:blank:]\n,]*/)
+
+                    break if s.skip(/\]/)
+
+                    vname = s.scan(NAME) or raise ParseError
+
+                    s.skip(/[[:blank:]]*=[[:blank:]]*/) or raise ParseError
+
+                    vector << [vname.upcase, single(s)]
+                end
+
+                attrs << [name.upcase, vector]
+            else
+                attrs << [name.upcase, single(s)]
+            end
+        end
+
+        attrs
+    end
+
+    def single(s)
+        if s.skip(/"/)
+            value = s.scan(/(\\"|[^"])*/)
+
+            s.skip(/"/) or raise ParseError
+
+            value
+        else
+            s.scan(/[^=#[:blank:]\n,\[\]]*/)
+        end
+    end
+
+    def vm(attrs)
+        id     = -1
+        poll   = nil
+        others = []
+
+        attrs.each do |name, value|
+            case name
+            when 'ID'
+                raise ParseError unless value =~ /\A-?\d+\z/ &&
+                                        value.to_i.to_s == value
+                id = value.to_i
+            when 'POLL'
+                poll = value
+            else
+                others << [name, value]
+            end
+        end
+
+        raise ParseError if poll.nil?
+
+        fields = parse(poll)
+
+        @out << VM.chr << varint(zigzag(id))
+
+        @out << varint(others.size)
+
+        others.each do |name, value|
+            name(name)
+            value(value)
+        end
+
+        @out << varint(fields.size)
+
+        fields.each do |name, value|
+            name(name)
+            value(value)
+        end
+    end
+
+    def value(value)
+        if value.instance_of?(Array)
+            @out << VECTOR.chr << varint(value.size)
+
+            value.each do |name, v|
+                name(name)
+                value(v)
+            end
+        elsif value =~ /\A-?(0|[1-9]\d{0,17})\z/
+            @out << INT.chr << varint(zigzag(value.to_i))
+        elsif value =~ /\A-?\d+\.\d+\z/ && format('%.15g', value.to_f) == value
+            @out << FLOAT.chr << [value.to_f].pack('E')
+        else
+            @out << STRING.chr
+            string(value)
+        end
+    end
+
+    def name(name)
+        index = @names[name]
+
+        if index
+            @out << varint(index)
+        else
+            @names[name] = @names.size + 1
+
+            @out << varint(0)
+            string(name)
+        end
+    end
+
+    def string(str)
+        str = str.dup.force_encoding(Encoding::BINARY)
+
+        @out << varint(str.bytesize) << str
+    end
+
+    def zigzag(n)
+        n >= 0 ? n << 1 : ((-n) << 1) - 1
+    end
+
+    def varint(n)
+        bytes = ''.force_encoding(Encoding::BINARY)
+
+        loop do
+            byte = n & 0x7F
+            n  >>= 7
+
+            if n == 0
+                bytes << byte.chr
+                break
+            end
+
+            bytes << (byte | 0x80).chr
+        end
+
+        bytes
+    end
+end
+
 class CollectdClient
     def initialize(hypervisor, number, host, port, probes_args,
                    monitor_push_period)
@@ -69,6 +277,11 @@ class CollectdClient
         data   = `#{@run_probes_cmd} 2>&1`
         code   = $?.exitstatus == 0
 
+        if code && BINARY_MONITOR
+            binary = MonitorEncoder.encode(data)
+            data   = binary if binary
+        end
+
         zdata  = Zlib::Deflate.deflate(data, Zlib::BEST_COMPRESSION)
         data64 = Base64::encode64(zdata).strip.delete("\n")
 
@@ -78,7 +291,17 @@ class CollectdClient
     def send(data)
         message, code = data
         result = code ? "SUCCESS" : "FAILURE"
-        @s.send("MONITOR #{result} #{@number} #{message}\n", 0, @host, @port)
+
+        begin
+            @s.send("MONITOR #{result} #{@number} #{message}\n", 0, @host,
+                    @port)
+        rescue Errno::EMSGSIZE
+            # Monitor data does not fit in an UDP datagram, report the error
+            error = "Monitor message too large (#{message.size} bytes)"
+            error64 = Base64::encode64(error).strip.delete("\n")
+
+            @s.send("MONITOR FAILURE #{@number} #{error64}\n", 0, @host, @port)
+        end
     end
 
     def monitor
@@ -38,7 +38,7 @@ extern "C" void * ipamm_action_loop(void *arg)
 
     NebulaLog::log("IPM",Log::INFO,"IPAM Manager started.");
 
-    ipamm->am.loop(ipamm->timer_period);
+    ipamm->am.loop();
 
     NebulaLog::log("IPM",Log::INFO,"IPAM Manager stopped.");
 
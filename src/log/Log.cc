@@ -21,9 +21,16 @@
 #include <stdexcept>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
@@ -104,6 +111,673 @@ void FileLog::log(
     }
 }
 
+/* -------------------------------------------------------------------------- */
+/* FileLogAsync                                                               */
+/* -------------------------------------------------------------------------- */
+
+/**
+ *  Single producer (the logging thread), single consumer (the writer thread)
+ *  ring of messages. Positions grow monotonically, records are 16-byte
+ *  aligned and never wrap around the end of the buffer (a pad record is used
+ *  instead).
+ */
+struct FileLogAsync::LogBuffer
+{
+    static const size_t SIZE = 64 * 1024;
+
+    /**
+     *  Largest message stored in the buffer, larger ones are queued in the
+     *  large message list
+     */
+    static const size_t MAX_RECORD = SIZE / 4;
+
+    static const uint32_t PAD = 0xFFFFFFFF;
+
+    struct Header
+    {
+        uint32_t           length;
+        uint32_t           reserved;
+        unsigned long long sequence;
+    };
+
+    /**
+     *  No message is being published
+     */
+    static const unsigned long long NONE = ~0ULL;
+
+    LogBuffer():head(0), tail(0), publishing(NONE), closed(false), time(0){};
+
+    char                data[SIZE];
+
+    std::atomic<size_t> head;
+
+    std::atomic<size_t> tail;
+
+    /**
+     *  Lower bound of the sequence of the message being published by the
+     *  thread, NONE otherwise. Messages from this sequence on are held back
+     *  by the writer until it is published.
+     */
+    std::atomic<unsigned long long> publishing;
+
+    /**
+     *  The thread exited, the buffer is freed once it is written
+     */
+    std::atomic<bool>   closed;
+
+    /**
+     *  Cached timestamp of the thread messages
+     */
+    time_t              time;
+
+    char                time_str[26];
+
+    static size_t record_size(size_t length)
+    {
+        return (sizeof(Header) + length + 15) & ~static_cast<size_t>(15);
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+
+namespace
+{
+    /**
+     *  Reference of the thread to its buffer, it is marked as closed when the
+     *  thread exits
+     */
+    struct ThreadBuffer
+    {
+        const FileLogAsync * owner;
+
+        std::shared_ptr<void> buffer;
+
+        std::atomic<bool> *   closed;
+
+        ThreadBuffer():owner(0), closed(0){};
+
+        ~ThreadBuffer()
+        {
+            if ( closed != 0 )
+            {
+                closed->store(true);
+            }
+        }
+    };
+
+    thread_local ThreadBuffer tl_buffer;
+}
+
+/* -------------------------------------------------------------------------- */
+
+extern "C" void * file_log_writer(void *arg)
+{
+    FileLogAsync * flog = static_cast<FileLogAsync *>(arg);
+
+    flog->writer_loop();
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+FileLogAsync::FileLogAsync(const string&   file_name,
+                 const MessageType   level,
+                 ios_base::openmode  mode,
+                 unsigned int        _flush_interval)
+        :Log(level), log_file_name(file_name), flush_interval(_flush_interval),
+        fd(-1), sequence(0), reopen_file(false), wakeup(false), stop(false),
+        flush_requests(0), flushed(0)
+{
+    pthread_condattr_t cattr;
+    sigset_t           mask;
+    sigset_t           old_mask;
+
+    int flags = O_WRONLY | O_CREAT | O_APPEND;
+
+    if ( mode & ios_base::trunc )
+    {
+        flags |= O_TRUNC;
+    }
+
+    if ( open_file(flags) != 0 )
+    {
+        throw runtime_error("Could not open log file");
+    }
+
+    pthread_mutex_init(&buffers_mutex, 0);
+    pthread_mutex_init(&mutex, 0);
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+
+    pthread_cond_init(&cond, &cattr);
+
+    pthread_condattr_destroy(&cattr);
+
+    pthread_cond_init(&flush_cond, 0);
+
+    // Signals (e.g. SIGHUP) are handled by the daemon threads
+    sigfillset(&mask);
+
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+    pthread_create(&writer, 0, file_log_writer, (void *) this);
+
+    pthread_sigmask(SIG_SETMASK, &old_mask, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+FileLogAsync::~FileLogAsync()
+{
+    pthread_mutex_lock(&mutex);
+
+    stop = true;
+
+    pthread_cond_signal(&cond);
+
+    pthread_mutex_unlock(&mutex);
+
+    pthread_join(writer, 0);
+
+    close(fd);
+
+    pthread_cond_destroy(&flush_cond);
+    pthread_cond_destroy(&cond);
+
+    pthread_mutex_destroy(&mutex);
+    pthread_mutex_destroy(&buffers_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int FileLogAsync::open_file(int flags)
+{
+    int new_fd = open(log_file_name.c_str(), flags | O_CLOEXEC, 0640);
+
+    if ( new_fd == -1 )
+    {
+        return -1;
+    }
+
+    if ( fd != -1 )
+    {
+        close(fd);
+    }
+
+    fd = new_fd;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+FileLogAsync::LogBuffer * FileLogAsync::thread_buffer()
+{
+    if ( tl_buffer.owner == this )
+    {
+        return static_cast<LogBuffer *>(tl_buffer.buffer.get());
+    }
+
+    std::shared_ptr<LogBuffer> buffer = std::make_shared<LogBuffer>();
+
+    pthread_mutex_lock(&buffers_mutex);
+
+    buffers.push_back(buffer);
+
+    pthread_mutex_unlock(&buffers_mutex);
+
+    if ( tl_buffer.closed != 0 )
+    {
+        tl_buffer.closed->store(true);
+    }
+
+    tl_buffer.owner  = this;
+    tl_buffer.buffer = buffer;
+    tl_buffer.closed = &buffer->closed;
+
+    return buffer.get();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void FileLogAsync::wake_writer()
+{
+    pthread_mutex_lock(&mutex);
+
+    wakeup = true;
+
+    pthread_cond_signal(&cond);
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void FileLogAsync::log(
+    const char *            module,
+    const MessageType       type,
+    const char *            message)
+{
+    if ( type > log_level )
+    {
+        return;
+    }
+
+    LogBuffer * lb = thread_buffer();
+
+    time_t the_time = time(0);
+
+    if ( the_time != lb->time )
+    {
+#ifdef SOLARIS
+        ctime_r(&(the_time), lb->time_str, sizeof(char)*26);
+#else
+        ctime_r(&(the_time), lb->time_str);
+#endif
+        // Get rid of final enter character
+        lb->time_str[24] = '\0';
+
+        lb->time = the_time;
+    }
+
+    // "<time> [Z<zone>][<module>][<type>]: <message>\n"
+    char zone[32];
+
+    int zone_len = snprintf(zone, sizeof(zone), " [Z%u][", zone_id);
+
+    size_t module_len  = strlen(module);
+    size_t message_len = strlen(message);
+
+    size_t length = 24 + zone_len + module_len + 6 + message_len + 1;
+
+    unsigned long long seq;
+
+    if ( LogBuffer::record_size(length) > LogBuffer::MAX_RECORD )
+    {
+        ostringstream oss;
+
+        oss << lb->time_str << zone << module << "][" << error_names[type]
+            << "]: " << message << "\n";
+
+        lb->publishing.store(sequence.load());
+
+        seq = sequence.fetch_add(1);
+
+        pthread_mutex_lock(&buffers_mutex);
+
+        large.push_back(make_pair(seq, oss.str()));
+
+        pthread_mutex_unlock(&buffers_mutex);
+
+        lb->publishing.store(LogBuffer::NONE);
+
+        wake_writer();
+
+        return;
+    }
+
+    size_t record = LogBuffer::record_size(length);
+    size_t head   = lb->head.load(std::memory_order_relaxed);
+    size_t offset = head % LogBuffer::SIZE;
+    size_t pad    = 0;
+
+    if ( LogBuffer::SIZE - offset < record )
+    {
+        pad = LogBuffer::SIZE - offset;
+    }
+
+    // Wait for the writer if the buffer is full
+    while ( head + pad + record - lb->tail.load(std::memory_order_acquire) >
+            LogBuffer::SIZE )
+    {
+        wake_writer();
+
+        usleep(1000);
+    }
+
+    // The sequence is taken once there is room for the message, so the
+    // writer only holds back the other messages while it is copied
+    lb->publishing.store(sequence.load());
+
+    seq = sequence.fetch_add(1);
+
+    if ( pad != 0 )
+    {
+        LogBuffer::Header * ph =
+            reinterpret_cast<LogBuffer::Header *>(lb->data + offset);
+
+        ph->length = LogBuffer::PAD;
+
+        offset = 0;
+    }
+
+    LogBuffer::Header * hdr =
+        reinterpret_cast<LogBuffer::Header *>(lb->data + offset);
+
+    hdr->length   = length;
+    hdr->sequence = seq;
+
+    char * str = lb->data + offset + sizeof(LogBuffer::Header);
+
+    memcpy(str, lb->time_str, 24);
+    str += 24;
+
+    memcpy(str, zone, zone_len);
+    str += zone_len;
+
+    memcpy(str, module, module_len);
+    str += module_len;
+
+    *str++ = ']';
+    *str++ = '[';
+    *str++ = error_names[type];
+    *str++ = ']';
+    *str++ = ':';
+    *str++ = ' ';
+
+    memcpy(str, message, message_len);
+    str += message_len;
+
+    *str = '\n';
+
+    lb->head.store(head + pad + record, std::memory_order_release);
+
+    lb->publishing.store(LogBuffer::NONE);
+
+    if ( type == ERROR )
+    {
+        wake_writer();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void FileLogAsync::reopen()
+{
+    reopen_file = true;
+
+    wake_writer();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void FileLogAsync::flush()
+{
+    pthread_mutex_lock(&mutex);
+
+    unsigned long long request = ++flush_requests;
+
+    wakeup = true;
+
+    pthread_cond_signal(&cond);
+
+    while ( flushed < request && !stop )
+    {
+        pthread_cond_wait(&flush_cond, &mutex);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool FileLogAsync::write_pending()
+{
+    struct Message
+    {
+        unsigned long long sequence;
+        const char *       str;
+        size_t             length;
+
+        bool operator<(const Message& other) const
+        {
+            return sequence < other.sequence;
+        }
+    };
+
+    std::vector<Message> messages;
+
+    std::vector<std::pair<unsigned long long, string> > _large;
+
+    std::vector<std::shared_ptr<LogBuffer> > _buffers;
+    std::vector<size_t> tails;
+
+    bool held = false;
+
+    // -------------------------------------------------------------------------
+    // Only the messages below the lowest sequence still being published are
+    // written, so a message is never written before an older one. The bound
+    // is taken with the buffer list, a buffer added later gets higher
+    // sequences.
+    // -------------------------------------------------------------------------
+    pthread_mutex_lock(&buffers_mutex);
+
+    _buffers = buffers;
+
+    _large.swap(large);
+
+    unsigned long long watermark = sequence.load();
+
+    for (size_t i = 0; i < _buffers.size(); i++)
+    {
+        unsigned long long pub = _buffers[i]->publishing.load();
+
+        if ( pub < watermark )
+        {
+            watermark = pub;
+        }
+    }
+
+    pthread_mutex_unlock(&buffers_mutex);
+
+    // Collect the messages of each buffer up to its current head
+    for (size_t i = 0; i < _buffers.size(); i++)
+    {
+        LogBuffer * lb = _buffers[i].get();
+
+        size_t tail = lb->tail.load(std::memory_order_relaxed);
+        size_t head = lb->head.load(std::memory_order_acquire);
+
+        while ( tail != head )
+        {
+            size_t offset = tail % LogBuffer::SIZE;
+
+            const LogBuffer::Header * hdr =
+                reinterpret_cast<const LogBuffer::Header *>(lb->data + offset);
+
+            if ( hdr->length == LogBuffer::PAD )
+            {
+                tail += LogBuffer::SIZE - offset;
+                continue;
+            }
+
+            if ( hdr->sequence >= watermark )
+            {
+                held = true;
+                break;
+            }
+
+            Message msg;
+
+            msg.sequence = hdr->sequence;
+            msg.str      = lb->data + offset + sizeof(LogBuffer::Header);
+            msg.length   = hdr->length;
+
+            messages.push_back(msg);
+
+            tail += LogBuffer::record_size(hdr->length);
+        }
+
+        tails.push_back(tail);
+    }
+
+    std::vector<std::pair<unsigned long long, string> > next_large;
+
+    for (size_t i = 0; i < _large.size(); i++)
+    {
+        if ( _large[i].first >= watermark )
+        {
+            next_large.push_back(_large[i]);
+            continue;
+        }
+
+        Message msg;
+
+        msg.sequence = _large[i].first;
+        msg.str      = _large[i].second.c_str();
+        msg.length   = _large[i].second.length();
+
+        messages.push_back(msg);
+    }
+
+    std::sort(messages.begin(), messages.end());
+
+    if ( reopen_file.exchange(false) )
+    {
+        open_file(O_WRONLY | O_CREAT | O_APPEND);
+    }
+
+    // Write the messages, IOV_BATCH at a time
+    const size_t IOV_BATCH = 512;
+
+    struct iovec iov[IOV_BATCH];
+
+    for (size_t i = 0; i < messages.size(); i += IOV_BATCH)
+    {
+        size_t num = std::min(IOV_BATCH, messages.size() - i);
+        size_t len = 0;
+
+        for (size_t j = 0; j < num; j++)
+        {
+            iov[j].iov_base = const_cast<char *>(messages[i + j].str);
+            iov[j].iov_len  = messages[i + j].length;
+
+            len += messages[i + j].length;
+        }
+
+        struct iovec * piov = iov;
+
+        while ( len > 0 )
+        {
+            ssize_t rc = writev(fd, piov, num);
+
+            if ( rc == -1 )
+            {
+                if ( errno == EINTR )
+                {
+                    continue;
+                }
+
+                break;
+            }
+
+            len -= rc;
+
+            // Skip the written data, after a partial write
+            while ( num > 0 && static_cast<size_t>(rc) >= piov->iov_len )
+            {
+                rc -= piov->iov_len;
+
+                piov++;
+                num--;
+            }
+
+            if ( num > 0 )
+            {
+                piov->iov_base = static_cast<char *>(piov->iov_base) + rc;
+                piov->iov_len -= rc;
+            }
+        }
+    }
+
+    // Release the buffer space, and free the buffers of finished threads
+    pthread_mutex_lock(&buffers_mutex);
+
+    for (size_t i = 0; i < _buffers.size(); i++)
+    {
+        LogBuffer * lb = _buffers[i].get();
+
+        lb->tail.store(tails[i], std::memory_order_release);
+
+        if ( lb->closed.load() && lb->head.load() == tails[i] )
+        {
+            buffers.erase(std::find(buffers.begin(), buffers.end(),
+                    _buffers[i]));
+        }
+    }
+
+    // Large messages held back are written with the next batch
+    if ( !next_large.empty() )
+    {
+        held = true;
+
+        large.insert(large.end(), next_large.begin(), next_large.end());
+    }
+
+    pthread_mutex_unlock(&buffers_mutex);
+
+    return held;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void FileLogAsync::writer_loop()
+{
+    struct timespec timeout;
+
+    pthread_mutex_lock(&mutex);
+
+    while (true)
+    {
+        bool done = stop;
+
+        if ( !wakeup && !done )
+        {
+            clock_gettime(CLOCK_MONOTONIC, &timeout);
+
+            timeout.tv_sec  += flush_interval / 1000;
+            timeout.tv_nsec += (flush_interval % 1000) * 1000000;
+
+            if ( timeout.tv_nsec >= 1000000000 )
+            {
+                timeout.tv_sec  += 1;
+                timeout.tv_nsec -= 1000000000;
+            }
+
+            pthread_cond_timedwait(&cond, &mutex, &timeout);
+
+            done = stop;
+        }
+
+        wakeup = false;
+
+        unsigned long long request = flush_requests;
+
+        pthread_mutex_unlock(&mutex);
+
+        // A flush (or the last write) waits for the messages being published
+        while ( write_pending() && (done || request > flushed) )
+        {
+            usleep(100);
+        }
+
+        pthread_mutex_lock(&mutex);
+
+        flushed = request;
+
+        pthread_cond_broadcast(&flush_cond);
+
+        if ( done )
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
@@ -24,7 +24,9 @@
 #include <string.h>
 
 #include "Mad.h"
+#include "MadReader.h"
 #include "NebulaLog.h"
+#include "NebulaUtil.h"
 
 #include "Nebula.h"
 
@@ -36,17 +38,19 @@
 
 Mad::~Mad()
 {
-    char    buf[]="FINALIZE\n";
     int     status;
     pid_t   rp;
 
     if ( pid==-1)
     {
+        pthread_mutex_destroy(&write_mutex);
         return;
     }
 
     // Finish the driver
-    ::write(nebula_mad_pipe, buf, strlen(buf));
+    write_message("FINALIZE\n");
+
+    pthread_mutex_destroy(&write_mutex);
 
     close(mad_nebula_pipe);
     close(nebula_mad_pipe);
@@ -88,6 +92,10 @@ int Mad::start()
 
     ostringstream                  oss;
 
+    framed = false;
+
+    capabilities.clear();
+
     // Open communication pipes
 
     if (pipe(ne_mad_pipe) == -1 ||
@@ -226,6 +234,16 @@ int Mad::start()
             {
                 goto error_mad_result;
             }
+
+            istringstream cis(info);
+            string        cap;
+
+            while ( cis >> cap )
+            {
+                capabilities.insert(cap);
+            }
+
+            negotiate_protocol();
         }
         else
         {
@@ -283,15 +301,172 @@ error_pipes:
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+static int read_reply(int fd, string& line)
+{
+    fd_set          rfds;
+    struct timeval  tv;
+
+    char c;
+    int  rc;
+
+    line.clear();
+
+    do
+    {
+        FD_ZERO(&rfds);
+        FD_SET(fd, &rfds);
+
+        // Wait up to 30 seconds
+        tv.tv_sec  = 30;
+        tv.tv_usec = 0;
+
+        rc = select(fd+1, &rfds, 0, 0, &tv);
+
+        if ( rc <= 0 )
+        {
+            return -1;
+        }
+
+        rc = read(fd, (void *) &c, sizeof(char));
+
+        if ( rc > 0 )
+        {
+            line.push_back(c);
+        }
+    }
+    while ( rc > 0 && c != '\n');
+
+    return rc > 0 ? 0 : -1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void Mad::negotiate_protocol()
+{
+    if ( !capability("FRAMED") )
+    {
+        return;
+    }
+
+    string line, action, result;
+
+    write_message("PROTOCOL FRAMED\n");
+
+    if ( read_reply(mad_nebula_pipe, line) != 0 )
+    {
+        NebulaLog::log("MAD", Log::ERROR, "MAD did not answer PROTOCOL "
+                "command, using text protocol");
+        return;
+    }
+
+    istringstream ris(line);
+
+    ris >> action >> result;
+
+    if ( action == "PROTOCOL" && result == "SUCCESS" )
+    {
+        framed = true;
+
+        NebulaLog::log("MAD", Log::DEBUG, "Using framed protocol for driver");
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void Mad::write_pipe(const string& buf) const
+{
+    const char * data = buf.data();
+    size_t       len  = buf.size();
+
+    pthread_mutex_lock(&write_mutex);
+
+    while ( len > 0 )
+    {
+        ssize_t rc = ::write(nebula_mad_pipe, data, len);
+
+        if ( rc == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        else if ( rc <= 0 )
+        {
+            break;
+        }
+
+        data += rc;
+        len  -= rc;
+    }
+
+    pthread_mutex_unlock(&write_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void Mad::write_message(const string& msg) const
+{
+    if ( !framed )
+    {
+        write_pipe(msg);
+        return;
+    }
+
+    string frame;
+
+    if ( !msg.empty() && msg[msg.size() - 1] == '\n' )
+    {
+        MadReader::encode_frame(msg.substr(0, msg.size() - 1), frame);
+    }
+    else
+    {
+        MadReader::encode_frame(msg, frame);
+    }
+
+    write_pipe(frame);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void Mad::write(ostringstream& os, const string& data) const
+{
+    if ( framed )
+    {
+        string frame;
+
+        os << "\n" << data;
+
+        MadReader::encode_frame(os.str(), frame);
+
+        write_pipe(frame);
+    }
+    else
+    {
+        string * data64 = one_util::base64_encode(data);
+
+        if ( data64 != 0 )
+        {
+            os << " " << *data64;
+
+            delete data64;
+        }
+
+        os << endl;
+
+        write_pipe(os.str());
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 int Mad::reload()
 {
-    char    buf[]="FINALIZE\n";
     int     status;
     int     rc;
     pid_t   rp;
 
     // Finish the driver
-    ::write(nebula_mad_pipe, buf, strlen(buf));
+    write_message("FINALIZE\n");
 
     close(nebula_mad_pipe);
     close(mad_nebula_pipe);
@@ -314,3 +489,20 @@ int Mad::reload()
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+int Mad::message_key(const string& message) const
+{
+    istringstream is(message);
+
+    string action;
+    string result;
+    int    id;
+
+    is >> action >> result >> id;
+
+    if ( is.fail() || id < 0 )
+    {
+        return -1;
+    }
+
+    return id;
+}
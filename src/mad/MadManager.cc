@@ -16,10 +16,12 @@
 
 #include <signal.h>
 #include <fcntl.h>
+#include <sys/epoll.h>
 
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #include "MadManager.h"
 #include "SyncRequest.h"
@@ -27,9 +29,14 @@
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-MadManager::MadManager(vector<const VectorAttribute*>& _mads):mad_conf(_mads)
+MadManager::MadManager(vector<const VectorAttribute*>& _mads):mad_conf(_mads),
+    dispatch_end(false)
 {
     pthread_mutex_init(&mutex,0);
+
+    pthread_mutex_init(&dispatch_mutex,0);
+
+    pthread_cond_init(&idle_cond,0);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -38,6 +45,10 @@ MadManager::MadManager(vector<const VectorAttribute*>& _mads):mad_conf(_mads)
 MadManager::~MadManager()
 {
     pthread_mutex_destroy(&mutex);
+
+    pthread_mutex_destroy(&dispatch_mutex);
+
+    pthread_cond_destroy(&idle_cond);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -55,6 +66,19 @@ extern "C" void * mad_manager_listener(
     return 0;
 }
 
+/* -------------------------------------------------------------------------- */
+
+extern "C" void * mad_manager_dispatcher(void * _dw)
+{
+    MadManager::DispatchWorker * dw;
+
+    dw = static_cast<MadManager::DispatchWorker *>(_dw);
+
+    dw->mm->dispatch_loop(dw);
+
+    return 0;
+}
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
@@ -92,7 +116,32 @@ int MadManager::start()
     fcntl(pipe_r, F_SETFD, FD_CLOEXEC);
     fcntl(pipe_w, F_SETFD, FD_CLOEXEC);
 
-    fds.push_back(pipe_r);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    if ( epoll_fd == -1 )
+    {
+        goto error_epoll;
+    }
+
+    struct epoll_event ev;
+
+    ev.events  = EPOLLIN;
+    ev.data.fd = pipe_r;
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pipe_r, &ev);
+
+    for (unsigned int i = 0; i < DISPATCH_WORKERS; i++)
+    {
+        DispatchWorker * dw = new DispatchWorker;
+
+        dw->mm = this;
+
+        pthread_cond_init(&dw->cond, 0);
+
+        pthread_create(&dw->thread, 0, mad_manager_dispatcher, (void *) dw);
+
+        workers.push_back(dw);
+    }
 
     rc = pthread_create(&listener_thread,
                         0,
@@ -108,6 +157,9 @@ int MadManager::start()
     return 0;
 
 error_create:
+    close(epoll_fd);
+
+error_epoll:
     close(pipe_r);
     close(pipe_w);
 
@@ -127,12 +179,44 @@ void MadManager::stop()
 
     pthread_join(listener_thread,0);
 
+    pthread_mutex_lock(&dispatch_mutex);
+
+    dispatch_end = true;
+
+    for (unsigned int i=0; i<workers.size(); i++)
+    {
+        pthread_cond_signal(&workers[i]->cond);
+    }
+
+    pthread_mutex_unlock(&dispatch_mutex);
+
+    for (unsigned int i=0; i<workers.size(); i++)
+    {
+        pthread_join(workers[i]->thread, 0);
+
+        pthread_cond_destroy(&workers[i]->cond);
+
+        delete workers[i];
+    }
+
+    workers.clear();
+
     lock();
 
     close(pipe_r);
 
     close(pipe_w);
 
+    close(epoll_fd);
+
+    for (map<int, MadReader *>::iterator it = readers.begin();
+            it != readers.end(); ++it)
+    {
+        delete it->second;
+    }
+
+    readers.clear();
+
     for (unsigned int i=0;i<mads.size();i++)
     {
         delete mads[i];
@@ -211,142 +295,168 @@ const Mad * MadManager::get(
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-void MadManager::listener()
+void MadManager::update_readers()
 {
-    int             greater;
-    unsigned int    i,j;
-    int             rc,mrc;
+    struct epoll_event ev;
 
-    char            c;
+    for (unsigned int i=0; i<mads.size(); i++)
+    {
+        int fd = mads[i]->mad_nebula_pipe;
 
-    Mad *           mad;
-    int             fd;
-    fd_set          in_pipes;
-    fd_set          rfds;
-    struct timeval  tv;
+        if ( readers.find(fd) != readers.end() )
+        {
+            continue;
+        }
 
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, 0);
+        readers.insert(make_pair(fd, new MadReader(fd, mads[i]->framed)));
 
-    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED,0);
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd;
 
-    while (1)
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MadManager::delete_reader(int fd)
+{
+    map<int, MadReader *>::iterator it = readers.find(fd);
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, 0);
+
+    if ( it != readers.end() )
     {
-        lock();
+        delete it->second;
 
-        FD_ZERO(&in_pipes);
+        readers.erase(it);
+    }
+}
 
-        for (i=0,greater=0; i < fds.size() ; i++)
-        {
-            FD_SET(fds[i], &in_pipes);
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
 
-            if ( fds[i] > greater )
-            {
-                greater = fds[i];
-            }
-        }
+void MadManager::listener()
+{
+    static const int MAX_EVENTS = 16;
 
-        unlock();
+    struct epoll_event events[MAX_EVENTS];
 
-        // Wait for a message
-        rc = select(greater+1, &in_pipes, NULL, NULL, NULL);
+    vector<string> lines;
+    vector<string>::iterator it;
 
-        if ( rc <= 0 )
-        {
-            continue;
-        }
+    unsigned int    i;
+    int             n, rc, mrc;
 
-        for (i=0; i< fds.size(); i++)
+    char            buf[64];
+
+    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED,0);
+
+    while (1)
+    {
+        // Wait for a message. The listener is only cancelled (by stop) here,
+        // never while it holds a lock or reloads a driver.
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, 0);
+
+        n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, 0);
+
+        for (int e = 0; e < n; e++)
         {
-            fd  = fds[i];
+            int fd = events[e].data.fd;
 
-            if ( FD_ISSET(fd, &in_pipes) )
+            if ( fd == pipe_r ) // Driver added, update the reader set
             {
-                if ( fd == pipe_r ) // Driver added, update the fd vector
-                {
-                    read(fd, (void *) &c, sizeof(char));
+                read(fd, (void *) buf, sizeof(buf));
 
-                    lock();
+                lock();
 
-                    fds.clear();
+                update_readers();
 
-                    fds.push_back(pipe_r);
+                unlock();
 
-                    for (j=0;j<mads.size();j++)
-                    {
-                        fds.push_back(mads[j]->mad_nebula_pipe);
-                    }
+                continue;
+            }
 
-                    unlock();
+            Mad *       mad    = 0;
+            MadReader * reader = 0;
+
+            lock();
 
-                    continue;
+            for (i=0; i<mads.size(); i++)
+            {
+                if ( mads[i]->mad_nebula_pipe == fd )
+                {
+                    mad = mads[i];
+                    break;
                 }
+            }
 
-                mad = mads[i-1];
+            map<int, MadReader *>::iterator rit = readers.find(fd);
 
-                buffer.str("");
+            if ( rit != readers.end() )
+            {
+                reader = rit->second;
+            }
 
-                do
-                {
-                    FD_ZERO(&rfds);
-                    FD_SET(mad->mad_nebula_pipe, &rfds);
+            unlock();
 
-                    tv.tv_sec  = 0;
-                    tv.tv_usec = 25000;
+            if ( mad == 0 || reader == 0 ) // Driver already reloaded
+            {
+                continue;
+            }
 
-                    rc = select(mad->mad_nebula_pipe+1,&rfds,0,0,&tv);
+            lines.clear();
 
-                    if ( rc <= 0 )
-                    {
-                        break;
-                    }
+            rc = reader->read_lines(lines);
 
-                    rc = read(mad->mad_nebula_pipe,(void *) &c,sizeof(char));
-                    buffer.put(c);
-                }
-                while ( rc > 0 && c != '\n');
+            for (it = lines.begin(); it != lines.end(); ++it) //MAD protocol
+            {
+                dispatch(mad, *it);
+            }
 
-                if ( rc <= 0 ) // Error reload the driver and recover
-                {
-                    mrc = mad->reload();
+            if ( rc != 0 ) // Error reload the driver and recover
+            {
+                lock();
 
-                    if ( mrc == 0 )
-                    {
-                        mad->recover();
-                    }
-                    else
-                    {
-                        lock();
+                delete_reader(fd);
 
-                        mads.erase(mads.begin() + i - 1);
+                unlock();
 
-                        delete mad;
+                // Messages from the old driver must not use its pipes
+                wait_dispatch(mad);
 
-                        unlock();
+                mrc = mad->reload();
 
-                    }
+                lock();
 
-                    // Update the fd vector with the new pipe's
+                if ( mrc == 0 )
+                {
+                    update_readers();
 
-                    lock();
+                    unlock();
 
-                    fds.clear();
+                    mad->recover();
+                }
+                else
+                {
+                    // The lock was released, look up the driver again
+                    vector<Mad *>::iterator mit;
 
-                    fds.push_back(pipe_r);
+                    mit = find(mads.begin(), mads.end(), mad);
 
-                    for (j=0;j<mads.size();j++)
+                    if ( mit == mads.end() )
                     {
-                        fds.push_back(mads[j]->mad_nebula_pipe);
+                        unlock();
+                        continue;
                     }
 
-                    unlock();
+                    mads.erase(mit);
 
-                    continue;
-                }
-                else //MAD specific protocol
-                {
-                    string msg = buffer.str();
+                    unlock();
 
-                    mad->protocol(msg);
+                    delete mad;
                 }
             }
         }
@@ -356,37 +466,107 @@ void MadManager::listener()
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-void MadManager::check_time_outs_action()
+void MadManager::dispatch(Mad * mad, const string& message)
 {
-    map<int, SyncRequest *>::iterator it;
+    int key = mad->message_key(message);
 
-    time_t the_time = time(0);
+    if ( key < 0 )
+    {
+        key = 0;
+    }
 
-    lock();
+    DispatchWorker * dw = workers[key % workers.size()];
+
+    pthread_mutex_lock(&dispatch_mutex);
+
+    dw->messages.push(make_pair(mad, message));
+
+    in_flight[mad]++;
+
+    pthread_cond_signal(&dw->cond);
 
-    it = sync_requests.begin();
+    pthread_mutex_unlock(&dispatch_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MadManager::dispatch_loop(DispatchWorker * dw)
+{
+    pthread_mutex_lock(&dispatch_mutex);
 
-    while ( it != sync_requests.end())
+    while (1)
     {
-        if ((it->second->time_out != 0) && (the_time > it->second->time_out))
+        while ( dw->messages.empty() && !dispatch_end )
         {
-            SyncRequest * ar = it->second;
-            sync_requests.erase(it++);
-
-            ar->result  = false;
-            ar->timeout = true;
-            ar->message = "Request timeout";
+            pthread_cond_wait(&dw->cond, &dispatch_mutex);
+        }
 
-            ar->notify();
+        if ( dispatch_end )
+        {
+            break;
         }
-        else
+
+        std::pair<Mad *, std::string> msg = dw->messages.front();
+
+        dw->messages.pop();
+
+        pthread_mutex_unlock(&dispatch_mutex);
+
+        msg.first->protocol(msg.second);
+
+        pthread_mutex_lock(&dispatch_mutex);
+
+        map<Mad *, unsigned int>::iterator it = in_flight.find(msg.first);
+
+        if ( it != in_flight.end() && --(it->second) == 0 )
         {
-            ++it;
+            in_flight.erase(it);
+
+            pthread_cond_broadcast(&idle_cond);
         }
     }
 
-    unlock();
+    pthread_mutex_unlock(&dispatch_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MadManager::wait_dispatch(Mad * mad)
+{
+    pthread_mutex_lock(&dispatch_mutex);
+
+    while ( in_flight.find(mad) != in_flight.end() )
+    {
+        pthread_cond_wait(&idle_cond, &dispatch_mutex);
+    }
 
+    pthread_mutex_unlock(&dispatch_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void MadManager::timeout_request(int id)
+{
+    SyncRequest * ar = get_request(id);
+
+    if ( ar == 0 )
+    {
+        return;
+    }
+
+    ar->result  = false;
+    ar->timeout = true;
+    ar->message = "Request timeout";
+
+    ar->notify();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void SyncRequest::RequestTimer::expired()
+{
+    mm->timeout_request(id);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -403,6 +583,14 @@ void MadManager::add_request(SyncRequest *ar)
     sync_requests.insert(sync_requests.end(),make_pair(ar->id,ar));
 
     unlock();
+
+    // The timer thread locks the manager to expire the request, so it is
+    // scheduled without the lock. Requests are removed from the wheel by the
+    // SyncRequest destructor.
+    ar->timer.mm = this;
+    ar->timer.id = ar->id;
+
+    TimerWheel::instance().schedule(&ar->timer, REQUEST_TIMEOUT * 1000);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -0,0 +1,220 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <arpa/inet.h>
+#include <string.h>
+
+#include "MadReader.h"
+#include "NebulaUtil.h"
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+MadReader::MadReader(int _fd, bool _framed):fd(_fd), framed(_framed)
+{
+    int flags = fcntl(fd, F_GETFL);
+
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int MadReader::read_lines(std::vector<std::string>& lines)
+{
+    char buffer[READ_SIZE];
+
+    ssize_t rc;
+    int     status = 0;
+
+    size_t max_size = LINE_MAX_SIZE;
+
+    if ( framed )
+    {
+        max_size = FRAME_HEADER_SIZE + FRAME_MAX_SIZE;
+    }
+
+    while (1)
+    {
+        rc = read(fd, (void *) buffer, READ_SIZE);
+
+        if ( rc > 0 )
+        {
+            partial.append(buffer, rc);
+
+            if ( static_cast<size_t>(rc) < READ_SIZE ) //Pipe drained
+            {
+                break;
+            }
+
+            if ( partial.size() > max_size ) //Split messages before reading
+            {
+                break;
+            }
+        }
+        else if ( rc == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        else if ( rc == -1 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+        {
+            break;
+        }
+        else //EOF or read error
+        {
+            status = -1;
+            break;
+        }
+    }
+
+    if ( framed )
+    {
+        if ( split_frames(lines) != 0 )
+        {
+            status = -1;
+        }
+    }
+    else
+    {
+        split_lines(lines);
+    }
+
+    if ( partial.size() > max_size ) //Incomplete message too large
+    {
+        partial.clear();
+
+        status = -1;
+    }
+
+    return status;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void MadReader::split_lines(std::vector<std::string>& lines)
+{
+    std::string::size_type start = 0;
+    std::string::size_type end;
+
+    while ((end = partial.find('\n', start)) != std::string::npos)
+    {
+        lines.push_back(partial.substr(start, end - start + 1));
+
+        start = end + 1;
+    }
+
+    partial.erase(0, start);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MadReader::split_frames(std::vector<std::string>& lines)
+{
+    std::string::size_type start = 0;
+
+    int rc = 0;
+
+    while ( partial.size() - start >= FRAME_HEADER_SIZE )
+    {
+        uint32_t      nlen;
+        unsigned char flags;
+
+        memcpy(&nlen, partial.data() + start, sizeof(uint32_t));
+
+        size_t len = ntohl(nlen);
+
+        flags = partial[start + sizeof(uint32_t)];
+
+        if ( len > FRAME_MAX_SIZE )
+        {
+            rc = -1;
+            break;
+        }
+
+        if ( partial.size() - start - FRAME_HEADER_SIZE < len ) //Incomplete
+        {
+            break;
+        }
+
+        std::string payload = partial.substr(start + FRAME_HEADER_SIZE, len);
+
+        start += FRAME_HEADER_SIZE + len;
+
+        if ( flags & FRAME_ZLIB )
+        {
+            std::string * msg = one_util::zlib_decompress(payload, false);
+
+            if ( msg == 0 )
+            {
+                rc = -1;
+                break;
+            }
+
+            lines.push_back(*msg);
+
+            delete msg;
+        }
+        else
+        {
+            lines.push_back(payload);
+        }
+    }
+
+    partial.erase(0, start);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void MadReader::encode_frame(const std::string& msg, std::string& frame)
+{
+    unsigned char flags = 0;
+
+    std::string * zmsg = 0;
+
+    const std::string * payload = &msg;
+
+    if ( msg.size() > FRAME_COMPRESS_SIZE )
+    {
+        zmsg = one_util::zlib_compress(msg, false);
+
+        if ( zmsg != 0 && zmsg->size() < msg.size() )
+        {
+            payload = zmsg;
+            flags   = FRAME_ZLIB;
+        }
+    }
+
+    uint32_t nlen = htonl(payload->size());
+
+    frame.clear();
+
+    frame.reserve(FRAME_HEADER_SIZE + payload->size());
+
+    frame.append(reinterpret_cast<const char *>(&nlen), sizeof(uint32_t));
+    frame.append(1, static_cast<char>(flags));
+    frame.append(*payload);
+
+    delete zmsg;
+}
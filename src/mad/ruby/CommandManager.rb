@@ -47,6 +47,7 @@ class GenericCommand
     ERROR_CLOSE = "ERROR MESSAGE ------>8--"
 
     attr_reader :code, :stdout, :stderr, :command
+    attr_writer :logger
 
     # Creates a command and runs it
     def self.run(command, logger=nil, stdin=nil, timeout=nil)
@@ -14,6 +14,8 @@
 # limitations under the License.                                             #
 #--------------------------------------------------------------------------- #
 
+require 'zlib'
+
 # This module provides an abstraction to generate an execution context for
 # OpenNebula Drivers. The module has been designed to be included as part
 # of a driver and not to be used standalone.
@@ -24,6 +26,14 @@ module DriverExecHelper
         :failure => "FAILURE"
     }
 
+    # Framed protocol. Each message is sent as:
+    #   - payload length, 4 bytes (network byte order)
+    #   - flags, 1 byte. FRAME_ZLIB if the payload is zlib compressed
+    #   - payload
+    FRAME_ZLIB          = 0x01
+    FRAME_HEADER_SIZE   = 5
+    FRAME_COMPRESS_SIZE = 4096
+
     def self.failed?(rc_str)
         return rc_str == RESULT[:failure]
     end
@@ -47,6 +57,9 @@ module DriverExecHelper
 
         # mutex for logging
         @send_mutex = Mutex.new
+
+        # framed protocol, negotiated with oned at INIT time
+        @framed = false
     end
 
     #
@@ -101,11 +114,33 @@ module DriverExecHelper
     # Sends a message to the OpenNebula core through stdout
     def send_message(action="-", result=RESULT[:failure], id="-", info="-")
         @send_mutex.synchronize {
-            STDOUT.puts "#{action} #{result} #{id} #{info}"
+            if @framed
+                STDOUT.write(encode_frame("#{action} #{result} #{id} #{info}"))
+            else
+                STDOUT.puts "#{action} #{result} #{id} #{info}"
+            end
+
             STDOUT.flush
         }
     end
 
+    # Builds a frame for the message, large payloads are compressed
+    def encode_frame(msg)
+        flags   = 0
+        payload = msg.dup.force_encoding('BINARY')
+
+        if payload.size > FRAME_COMPRESS_SIZE
+            zpayload = Zlib::Deflate.deflate(payload)
+
+            if zpayload.size < payload.size
+                payload = zpayload
+                flags   = FRAME_ZLIB
+            end
+        end
+
+        [payload.size, flags].pack('NC') + payload
+    end
+
     # Sends a log message to ONE. The +message+ can be multiline, it will
     # be automatically splitted by lines.
     def log(number, message, all=true)
@@ -36,6 +36,11 @@ class OpenNebulaDriver < ActionManager
     # @return [String] Path for scripts
     attr_reader :local_scripts_path, :remote_scripts_path
 
+    # Data argument of a message sent raw (not base64 encoded) by oned with
+    # the framed protocol
+    class RawData < String
+    end
+
     # Initialize OpenNebulaDriver object
     #
     # @param [String] directory path inside the remotes directory where the
@@ -48,13 +53,16 @@ class OpenNebulaDriver < ActionManager
     # @option options [Hash] :local_actions ({}) hash with the actions
     #   executed locally and the name of the script if it differs from the
     #   default one. This hash can be constructed using {parse_actions_list}
+    # @option options [Boolean] :framed (true) offers the framed protocol
+    #   (length-prefixed messages) to oned
     def initialize(directory, options={})
         @options={
             :concurrency => 10,
             :threaded    => true,
             :retries     => 0,
             :local_actions => {},
-            :timeout     => nil
+            :timeout     => nil,
+            :framed      => true
         }.merge!(options)
 
         super(@options[:concurrency], @options[:threaded])
@@ -136,6 +144,19 @@ class OpenNebulaDriver < ActionManager
     end
 
 
+    # Decodes a data argument of a message. It is base64 encoded unless it
+    # was sent raw using the framed protocol
+    #
+    # @param [String] data the argument
+    # @return [String] the decoded data
+    def decode_data(data)
+        if data.is_a?(RawData)
+            data.to_s
+        else
+            Base64.decode64(data)
+        end
+    end
+
     # Start the driver. Reads from STDIN and executes methods associated with
     # the messages
     def start_driver
@@ -181,19 +202,86 @@ class OpenNebulaDriver < ActionManager
 private
 
     def init
-        send_message("INIT",RESULT[:success])
+        caps = capabilities
+
+        if caps.empty?
+            send_message("INIT",RESULT[:success])
+        else
+            send_message("INIT",RESULT[:success],"-",caps.join(' '))
+        end
+    end
+
+    # Protocol extensions announced to oned in the INIT response
+    #
+    # @return [Array<String>] list of capabilities
+    def capabilities
+        caps = []
+        caps << "FRAMED" if @options[:framed]
+
+        caps
+    end
+
+    # Switches to the framed protocol as requested by oned. The confirmation
+    # is the last text message sent to oned
+    def protocol(name)
+        @send_mutex.synchronize {
+            if name == "FRAMED" && @options[:framed]
+                STDOUT.puts "PROTOCOL #{RESULT[:success]} - -"
+                STDOUT.flush
+
+                STDOUT.binmode
+                STDIN.binmode
+
+                @framed = true
+            else
+                STDOUT.puts "PROTOCOL #{RESULT[:failure]} - -"
+                STDOUT.flush
+            end
+        }
+    end
+
+    # Reads a frame from STDIN, returns the (uncompressed) payload or nil if
+    # the stream was closed
+    def read_frame
+        header = STDIN.read(FRAME_HEADER_SIZE)
+
+        return nil if header.nil? || header.size < FRAME_HEADER_SIZE
+
+        size, flags = header.unpack('NC')
+
+        payload = STDIN.read(size)
+
+        return nil if payload.nil? || payload.size < size
+
+        payload = Zlib::Inflate.inflate(payload) if flags & FRAME_ZLIB != 0
+
+        payload
     end
 
     def loop
         while true
-            exit(-1) if STDIN.eof?
+            data = nil
+
+            if @framed
+                str = read_frame
+
+                exit(-1) if str.nil?
 
-            str=STDIN.gets
-            next if !str
+                # Data argument, if any, follows the command line
+                str, data = str.split("\n", 2)
+                next if !str
+            else
+                exit(-1) if STDIN.eof?
+
+                str=STDIN.gets
+                next if !str
+            end
 
             args   = str.split(/\s+/)
             next if args.length == 0
 
+            args << RawData.new(data) if data
+
             if args.first.empty?
                 STDERR.puts "Malformed message: #{str.inspect}"
                 next
@@ -207,7 +295,9 @@ private
                 action_id = args[0].to_i
             end
 
-            if action == :DRIVER_CANCEL
+            if action == :PROTOCOL
+                protocol(args[0])
+            elsif action == :DRIVER_CANCEL
                 cancel_action(action_id)
                 log(action_id,"Driver command for #{action_id} cancelled")
             else
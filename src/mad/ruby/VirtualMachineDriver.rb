@@ -51,7 +51,9 @@ class VirtualMachineDriver < OpenNebulaDriver
         :detach_nic  => "DETACHNIC",
         :disk_snapshot_create => "DISKSNAPSHOTCREATE",
         :resize_disk => "RESIZEDISK",
-        :update_sg   => "UPDATESG"
+        :update_sg   => "UPDATESG",
+        :batch       => "BATCH",
+        :poll_host   => "POLLHOST"
     }
 
     POLL_ATTRIBUTE = OpenNebula::VirtualMachine::Driver::POLL_ATTRIBUTE
@@ -59,6 +61,11 @@ class VirtualMachineDriver < OpenNebulaDriver
 
     HOST_ARG = 1
 
+    # Actions for a host, their id is a host id. They are registered with
+    # their own ids so they do not collide with the actions of a VM with
+    # the same id
+    HOST_ACTIONS = [ACTION[:batch].to_sym, ACTION[:poll_host].to_sym]
+
     # Register default actions for the protocol.
     #
     # @param [String] directory path inside remotes path where the scripts
@@ -66,16 +73,21 @@ class VirtualMachineDriver < OpenNebulaDriver
     # @param [Hash] options options for OpenNebula driver (check the available
     #   options in {OpenNebulaDriver#initialize})
     # @option options [Boolean] :threaded (true) enables or disables threads
+    # @option options [Boolean] :batch (true) accepts BATCH messages
     def initialize(directory, options={})
         @options={
             :threaded    => true,
-            :single_host => true
+            :single_host => true,
+            :batch       => true
         }.merge!(options)
 
         super(directory, @options)
 
         @hosts   = Array.new
 
+        # VMs with actions in a running batch, {vid => {:thread, :cancelled}}
+        @batch_vms = Hash.new
+
         register_action(ACTION[:deploy].to_sym,      method("deploy"))
         register_action(ACTION[:shutdown].to_sym,    method("shutdown"))
         register_action(ACTION[:reboot].to_sym,      method("reboot"))
@@ -96,6 +108,7 @@ class VirtualMachineDriver < OpenNebulaDriver
         register_action(ACTION[:disk_snapshot_create].to_sym, method("disk_snapshot_create"))
         register_action(ACTION[:resize_disk].to_sym, method("resize_disk"))
         register_action(ACTION[:update_sg].to_sym, method("update_sg"))
+        register_action(ACTION[:batch].to_sym, method("batch"))
     end
 
     # Decodes the encoded XML driver message received from the core
@@ -103,7 +116,7 @@ class VirtualMachineDriver < OpenNebulaDriver
     # @param [String] drv_message the driver message
     # @return [REXML::Element] the root element of the decoded XML message
     def decode(drv_message)
-        message = Base64.decode64(drv_message)
+        message = decode_data(drv_message)
         xml_doc = REXML::Document.new(message)
 
         xml_doc.root
@@ -220,8 +233,132 @@ class VirtualMachineDriver < OpenNebulaDriver
         send_message(ACTION[:cleanup],RESULT[:failure],id,error)
     end
 
+    # Executes the actions of a BATCH message, all of them for the same host.
+    # Each action reports its own result to oned as if it were received in
+    # a separate message. Drivers can redefine this method to share resources
+    # (e.g. the host connection) among the actions.
+    #
+    # @param [String] id of the host
+    # @param [String] drv_message the batch message
+    def batch(id, drv_message)
+        each_batch_action(drv_message) do |aname, vid, data|
+            send(aname, vid, data)
+        end
+    end
+
+    # Iterates over the actions of a BATCH message. Unknown actions are
+    # reported as failed. Each action runs in its own thread (with the thread
+    # variables of the batch), so it can be cancelled with DRIVER_CANCEL
+    # without cancelling the rest of the batch.
+    #
+    # @param [String] drv_message the batch message
+    # @yield [Symbol, Integer, RawData] method name, VM id and driver
+    #   message of each action
+    def each_batch_action(drv_message)
+        xml     = decode(drv_message)
+        actions = []
+
+        xml.each_element('ACTION') do |action|
+            name  = action.elements['NAME'].text
+            vid   = action.elements['ID'].text.to_i
+            data  = action.elements['VMM_DRIVER_ACTION_DATA']
+            aname = ACTION.key(name)
+
+            if aname.nil? || aname == :batch || data.nil?
+                send_message(name, RESULT[:failure], vid,
+                    "Wrong action in batch message")
+                next
+            end
+
+            actions << [name, aname, vid, RawData.new(data.to_s)]
+        end
+
+        @threads_mutex.synchronize {
+            actions.each do |action|
+                @batch_vms[action[2]] = { :thread => nil, :cancelled => false }
+            end
+        }
+
+        locals = Thread.current.keys.map {|k| [k, Thread.current[k]] }
+
+        actions.each do |name, aname, vid, data|
+            thread = nil
+            vm     = nil
+
+            @threads_mutex.synchronize {
+                vm = @batch_vms[vid]
+
+                if !vm[:cancelled]
+                    thread = Thread.new {
+                        locals.each {|k, v| Thread.current[k] = v }
+
+                        begin
+                            yield aname, vid, data
+                        rescue Exception => e
+                            send_message(name, RESULT[:failure], vid,
+                                e.message.gsub("\n", " "))
+                        end
+                    }
+
+                    vm[:thread] = thread
+                end
+            }
+
+            next if thread.nil?
+
+            thread.join
+
+            @threads_mutex.synchronize { vm[:thread] = nil }
+
+            batch_action_cancelled(vid) if vm[:cancelled]
+        end
+    ensure
+        @threads_mutex.synchronize {
+            actions.each {|action| @batch_vms.delete(action[2]) } if actions
+        }
+    end
+
+    # Called when an action of a batch is cancelled. Drivers can redefine it
+    # to recover the resources shared by the actions (e.g. the connection)
+    #
+    # @param [Integer] vid id of the VM
+    def batch_action_cancelled(vid)
+    end
+
+    # Cancels the actions of a VM, including those in a running batch
+    #
+    # @param [Integer] action_id id of the VM
+    def cancel_action(action_id)
+        @threads_mutex.synchronize {
+            vm = @batch_vms[action_id]
+
+            if vm
+                vm[:cancelled] = true
+                vm[:thread].kill if vm[:thread]
+
+                return
+            end
+        }
+
+        super(action_id)
+    end
+
+    # Host actions use their own ids, [:host, host_id]
+    def trigger_action(aname, action_id, *aargs)
+        action_id = [:host, action_id] if HOST_ACTIONS.include?(aname)
+
+        super(aname, action_id, *aargs)
+    end
+
 private
 
+    def capabilities
+        caps = super
+        caps << "BATCH" if @options[:batch]
+
+        caps
+    end
+
     # Interface to handle the pending events from the ActionManager Interface
     def delete_running_action(action_id)
         if @options[:single_host]
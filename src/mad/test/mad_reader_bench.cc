@@ -0,0 +1,329 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+
+/**
+ *  Throughput benchmark for the driver message reader (MadReader). A dummy
+ *  driver floods the pipe with messages that are read as done by the
+ *  MadManager listener (epoll + MadReader). The legacy reader (one select and
+ *  read system call per byte) can be selected for comparison.
+ *
+ *  Usage: mad_reader_bench [-n messages] [-s message_size] [-l] [-f]
+ *                          [-d driver]
+ *    -n number of messages sent by the dummy driver (default 100000)
+ *    -s size of each message in bytes (default 256)
+ *    -l use the legacy byte-by-byte reader
+ *    -f use the framed protocol
+ *    -d external driver to execute, it is initialized (INIT) and then it
+ *       should flood its stdout (e.g. dummy_flood), -n is used to stop the
+ *       benchmark
+ */
+
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+
+#include "MadReader.h"
+
+/* -------------------------------------------------------------------------- */
+/* Dummy driver, writes num messages of size bytes to fd                      */
+/* -------------------------------------------------------------------------- */
+
+static void dummy_driver(int fd, unsigned int num, unsigned int size,
+        bool framed)
+{
+    std::string msg("POLL SUCCESS 0 ");
+
+    if ( size > msg.size() + 1 )
+    {
+        msg.append(size - msg.size() - 1, 'x');
+    }
+
+    msg.append("\n");
+
+    if ( framed )
+    {
+        std::string frame;
+
+        MadReader::encode_frame(msg.substr(0, msg.size() - 1), frame);
+
+        msg = frame;
+    }
+
+    for (unsigned int i = 0; i < num; i++)
+    {
+        const char * buf = msg.c_str();
+        size_t       len = msg.size();
+
+        while ( len > 0 )
+        {
+            ssize_t rc = write(fd, buf, len);
+
+            if ( rc <= 0 )
+            {
+                _exit(-1);
+            }
+
+            buf += rc;
+            len -= rc;
+        }
+    }
+
+    close(fd);
+
+    _exit(0);
+}
+
+/* -------------------------------------------------------------------------- */
+/* Legacy reader, as implemented in the MadManager listener                   */
+/* -------------------------------------------------------------------------- */
+
+static unsigned int legacy_reader(int fd, unsigned int num)
+{
+    std::ostringstream buffer;
+
+    unsigned int count = 0;
+
+    fd_set in_pipes, rfds;
+    struct timeval tv;
+
+    char c;
+    int  rc;
+
+    while ( count < num )
+    {
+        FD_ZERO(&in_pipes);
+        FD_SET(fd, &in_pipes);
+
+        if ( select(fd + 1, &in_pipes, 0, 0, 0) <= 0 )
+        {
+            continue;
+        }
+
+        buffer.str("");
+
+        do
+        {
+            FD_ZERO(&rfds);
+            FD_SET(fd, &rfds);
+
+            tv.tv_sec  = 0;
+            tv.tv_usec = 25000;
+
+            rc = select(fd + 1, &rfds, 0, 0, &tv);
+
+            if ( rc <= 0 )
+            {
+                break;
+            }
+
+            rc = read(fd, (void *) &c, sizeof(char));
+            buffer.put(c);
+        }
+        while ( rc > 0 && c != '\n');
+
+        if ( rc <= 0 )
+        {
+            break;
+        }
+
+        std::string msg = buffer.str();
+
+        count++;
+    }
+
+    return count;
+}
+
+/* -------------------------------------------------------------------------- */
+/* Buffered epoll reader, as implemented in the MadManager listener           */
+/* -------------------------------------------------------------------------- */
+
+static unsigned int epoll_reader(int fd, unsigned int num, bool framed)
+{
+    MadReader reader(fd, framed);
+
+    std::vector<std::string> lines;
+
+    struct epoll_event ev, events[16];
+
+    unsigned int count = 0;
+
+    int efd = epoll_create1(EPOLL_CLOEXEC);
+
+    ev.events  = EPOLLIN;
+    ev.data.fd = fd;
+
+    epoll_ctl(efd, EPOLL_CTL_ADD, fd, &ev);
+
+    while ( count < num )
+    {
+        int n = epoll_wait(efd, events, 16, -1);
+
+        for (int i = 0; i < n; i++)
+        {
+            lines.clear();
+
+            int rc = reader.read_lines(lines);
+
+            count += lines.size();
+
+            if ( rc != 0 )
+            {
+                close(efd);
+                return count;
+            }
+        }
+    }
+
+    close(efd);
+
+    return count;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv)
+{
+    unsigned int num    = 100000;
+    unsigned int size   = 256;
+    bool         legacy = false;
+    bool         framed = false;
+    const char * driver = 0;
+
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:lfd:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                num = strtoul(optarg, 0, 10);
+                break;
+            case 's':
+                size = strtoul(optarg, 0, 10);
+                break;
+            case 'l':
+                legacy = true;
+                break;
+            case 'f':
+                framed = true;
+                break;
+            case 'd':
+                driver = optarg;
+                break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-n messages] "
+                    << "[-s message_size] [-l] [-f] [-d driver]" << std::endl;
+                return -1;
+        }
+    }
+
+    int pipes[2];
+    int init_pipes[2];
+
+    if ( pipe(pipes) == -1 || pipe(init_pipes) == -1 )
+    {
+        perror("pipe");
+        return -1;
+    }
+
+    pid_t pid = fork();
+
+    switch (pid)
+    {
+        case -1:
+            perror("fork");
+            return -1;
+
+        case 0:
+            close(pipes[0]);
+
+            if ( driver != 0 )
+            {
+                dup2(init_pipes[0], 0);
+                dup2(pipes[1], 1);
+
+                close(init_pipes[0]);
+                close(init_pipes[1]);
+                close(pipes[1]);
+
+                execlp(driver, driver, (char *) 0);
+
+                _exit(-1);
+            }
+
+            dummy_driver(pipes[1], num, size, framed);
+
+        default:
+            close(pipes[1]);
+            close(init_pipes[0]);
+    }
+
+    if ( driver != 0 ) // INIT message, its reply is counted as a message
+    {
+        write(init_pipes[1], "INIT\n", 5);
+
+        num++;
+    }
+
+    struct timeval start, end;
+
+    gettimeofday(&start, 0);
+
+    unsigned int count;
+
+    if ( legacy )
+    {
+        count = legacy_reader(pipes[0], num);
+    }
+    else
+    {
+        count = epoll_reader(pipes[0], num, framed);
+    }
+
+    gettimeofday(&end, 0);
+
+    kill(pid, SIGTERM);
+    waitpid(pid, 0, 0);
+
+    close(pipes[0]);
+    close(init_pipes[1]);
+
+    double secs = (end.tv_sec - start.tv_sec) +
+        (end.tv_usec - start.tv_usec) / 1000000.0;
+
+    std::cout << (legacy ? "legacy" : (framed ? "framed" : "epoll"))
+        << " reader: " << count
+        << " messages of " << size << " bytes in " << secs << "s, "
+        << count / secs << " msg/s, "
+        << (count * (double) size) / (secs * 1024 * 1024) << " MB/s"
+        << std::endl;
+
+    return count == num ? 0 : -1;
+}
@@ -106,7 +106,8 @@ void Nebula::start(bool bootstrap_only)
                                        clevel,
                                        log_fname.c_str(),
                                        ios_base::trunc,
-                                       "oned");
+                                       "oned",
+                                       get_log_flush_interval());
         }
         else
         {
@@ -233,12 +234,16 @@ void Nebula::start(bool bootstrap_only)
 
     unsigned int log_retention;
 
+    bool linearizable_reads;
+
     vatt->vector_value("LOG_PURGE_TIMEOUT", log_purge);
     vatt->vector_value("ELECTION_TIMEOUT_MS", election_ms);
     vatt->vector_value("BROADCAST_TIMEOUT_MS", bcast_ms);
     vatt->vector_value("XMLRPC_TIMEOUT_MS", xmlrpc_ms);
     vatt->vector_value("LOG_RETENTION", log_retention);
 
+    vatt->vector_value("LINEARIZABLE_READS", linearizable_reads);
+
     Log::set_zone_id(zone_id);
 
     // -----------------------------------------------------------
@@ -519,6 +524,8 @@ void Nebula::start(bool bootstrap_only)
         vector<const SingleAttribute *> vm_restricted_attrs;
 
         time_t vm_expiration;
+        time_t minute_expiration = 0;
+        time_t hour_expiration   = 0;
         bool   vm_submit_on_hold;
 
         float cpu_cost;
@@ -533,6 +540,15 @@ void Nebula::start(bool bootstrap_only)
 
         nebula_configuration->get("VM_MONITORING_EXPIRATION_TIME",vm_expiration);
 
+        const VectorAttribute * rollup = nebula_configuration->get(
+                "MONITORING_ROLLUP");
+
+        if ( rollup != 0 )
+        {
+            rollup->vector_value("MINUTE_EXPIRATION_TIME", minute_expiration);
+            rollup->vector_value("HOUR_EXPIRATION_TIME", hour_expiration);
+        }
+
         nebula_configuration->get("VM_SUBMIT_ON_HOLD",vm_submit_on_hold);
 
         default_cost = nebula_configuration->get("DEFAULT_COST");
@@ -554,7 +570,8 @@ void Nebula::start(bool bootstrap_only)
 
         vmpool = new VirtualMachinePool(logdb, vm_hooks, hook_location,
             remotes_location, vm_restricted_attrs, vm_expiration,
-            vm_submit_on_hold, cpu_cost, mem_cost, disk_cost);
+            minute_expiration, hour_expiration, vm_submit_on_hold, cpu_cost,
+            mem_cost, disk_cost);
 
         /* ---------------------------- Host Pool --------------------------- */
         vector<const VectorAttribute *> host_hooks;
@@ -567,7 +584,7 @@ void Nebula::start(bool bootstrap_only)
                 host_expiration);
 
         hpool  = new HostPool(logdb, host_hooks, hook_location, remotes_location,
-            host_expiration);
+            host_expiration, minute_expiration, hour_expiration);
 
         /* --------------------- VirtualRouter Pool ------------------------- */
         vector<const VectorAttribute *> vrouter_hooks;
@@ -725,7 +742,8 @@ void Nebula::start(bool bootstrap_only)
     try
     {
         raftm = new RaftManager(server_id, raft_leader_hook, raft_follower_hook,
-                log_purge, bcast_ms, election_ms, xmlrpc_ms, remotes_location);
+                log_purge, bcast_ms, election_ms, xmlrpc_ms, linearizable_reads,
+                remotes_location);
     }
     catch (bad_alloc&)
     {
@@ -802,7 +820,11 @@ void Nebula::start(bool bootstrap_only)
     // ---- Life-cycle Manager ----
     try
     {
-        lcm = new LifeCycleManager();
+        unsigned int workers;
+
+        nebula_configuration->get("VM_ACTION_WORKERS", workers);
+
+        lcm = new LifeCycleManager(workers);
     }
     catch (bad_alloc&)
     {
@@ -875,7 +897,11 @@ void Nebula::start(bool bootstrap_only)
     // ---- Dispatch Manager ----
     try
     {
-        dm = new DispatchManager();
+        unsigned int workers;
+
+        nebula_configuration->get("VM_ACTION_WORKERS", workers);
+
+        dm = new DispatchManager(workers);
     }
     catch (bad_alloc&)
     {
@@ -898,7 +924,7 @@ void Nebula::start(bool bootstrap_only)
 
         if (!auth_mads.empty())
         {
-            authm = new AuthManager(timer_period, auth_mads);
+            authm = new AuthManager(auth_mads);
         }
         else
         {
@@ -973,7 +999,7 @@ void Nebula::start(bool bootstrap_only)
 
         nebula_configuration->get("IPAM_MAD", ipam_mads);
 
-        ipamm = new IPAMManager(timer_period, ipam_mads);
+        ipamm = new IPAMManager(ipam_mads);
     }
     catch (bad_alloc&)
     {
@@ -1092,15 +1118,27 @@ void Nebula::start(bool bootstrap_only)
     }
 
     // -----------------------------------------------------------
-    // Wait for a SIGTERM or SIGINT signal
+    // Wait for a SIGTERM or SIGINT signal, SIGHUP reopens the log
     // -----------------------------------------------------------
 
     sigemptyset(&mask);
 
     sigaddset(&mask, SIGINT);
     sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGHUP);
+
+    do
+    {
+        sigwait(&mask, &signal);
 
-    sigwait(&mask, &signal);
+        if ( signal == SIGHUP )
+        {
+            NebulaLog::reopen_log_system();
+
+            NebulaLog::log("ONE", Log::INFO, "Log file reopened.");
+        }
+    }
+    while ( signal == SIGHUP );
 
     // -----------------------------------------------------------
     // Stop the managers & free resources
@@ -1143,6 +1181,13 @@ void Nebula::start(bool bootstrap_only)
         pthread_join(aclm->get_thread_id(),0);
     }
 
+    // Write the pending updates and monitoring samples kept in memory
+    hpool->flush_updates();
+    vmpool->flush_updates();
+
+    hpool->flush_monitoring();
+    vmpool->flush_monitoring();
+
     //XML Library
     xmlCleanupParser();
 
@@ -1150,6 +1195,8 @@ void Nebula::start(bool bootstrap_only)
 
     NebulaLog::log("ONE", Log::INFO, "All modules finalized, exiting.\n");
 
+    NebulaLog::flush_log_system();
+
     return;
 
 error_mad:
@@ -1204,6 +1251,23 @@ NebulaLog::LogType Nebula::get_log_system() const
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+unsigned int Nebula::get_log_flush_interval() const
+{
+    unsigned int flush_interval = 500;
+
+    const VectorAttribute * log = nebula_configuration->get("LOG");
+
+    if ( log != 0 )
+    {
+        log->vector_value("FLUSH_INTERVAL", flush_interval);
+    }
+
+    return flush_interval;
+};
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 void Nebula::get_ds_location(string& dsloc)
 {
     get_configuration_attribute("DATASTORE_LOCATION", dsloc);
@@ -386,6 +386,7 @@ void OpenNebulaTemplate::set_conf_default()
     set_conf_single("MANAGER_TIMER", "15");
     set_conf_single("MONITORING_INTERVAL", "60");
     set_conf_single("MONITORING_THREADS", "50");
+    set_conf_single("VM_ACTION_WORKERS", "1");
     set_conf_single("HOST_PER_INTERVAL", "15");
     set_conf_single("HOST_MONITORING_EXPIRATION_TIME", "43200");
     set_conf_single("VM_INDIVIDUAL_MONITORING", "no");
@@ -406,6 +407,7 @@ void OpenNebulaTemplate::set_conf_default()
     vvalue.clear();
     vvalue.insert(make_pair("SYSTEM","file"));
     vvalue.insert(make_pair("DEBUG_LEVEL","3"));
+    vvalue.insert(make_pair("FLUSH_INTERVAL","500"));
 
     vattribute = new VectorAttribute("LOG",vvalue);
     conf_default.insert(make_pair(vattribute->name(),vattribute));
@@ -434,6 +436,7 @@ void OpenNebulaTemplate::set_conf_default()
 #   ELECTION_TIMEOUT_MS
 #   BROADCAST_TIMEOUT_MS
 #   XMLRPC_TIMEOUT_MS
+#   LINEARIZABLE_READS
 #*******************************************************************************
 */
     // FEDERATION
@@ -453,11 +456,40 @@ void OpenNebulaTemplate::set_conf_default()
     vvalue.insert(make_pair("ELECTION_TIMEOUT_MS","1500"));
     vvalue.insert(make_pair("BROADCAST_TIMEOUT_MS","500"));
     vvalue.insert(make_pair("XMLRPC_TIMEOUT_MS","100"));
+    vvalue.insert(make_pair("LINEARIZABLE_READS","NO"));
 
     vattribute = new VectorAttribute("RAFT",vvalue);
     conf_default.insert(make_pair(vattribute->name(),vattribute));
 /*
 #*******************************************************************************
+# Monitoring rollups
+#-------------------------------------------------------------------------------
+#  MONITORING_ROLLUP
+#*******************************************************************************
+*/
+    vvalue.clear();
+    vvalue.insert(make_pair("MINUTE_EXPIRATION_TIME","604800"));
+    vvalue.insert(make_pair("HOUR_EXPIRATION_TIME","31536000"));
+
+    vattribute = new VectorAttribute("MONITORING_ROLLUP",vvalue);
+    conf_default.insert(make_pair(vattribute->name(),vattribute));
+
+/*
+#*******************************************************************************
+# VM monitoring updates
+#-------------------------------------------------------------------------------
+#  VM_MONITORING_DELTA
+#*******************************************************************************
+*/
+    vvalue.clear();
+    vvalue.insert(make_pair("THRESHOLD","5"));
+    vvalue.insert(make_pair("REFRESH_TIME","300"));
+
+    vattribute = new VectorAttribute("VM_MONITORING_DELTA",vvalue);
+    conf_default.insert(make_pair(vattribute->name(),vattribute));
+
+/*
+#*******************************************************************************
 # Default showback cost
 #*******************************************************************************
 */
@@ -86,6 +86,8 @@ static void oned_main()
     }
     catch (exception &e)
     {
+        NebulaLog::flush_log_system();
+
         cerr << e.what() << endl;
 
         return;
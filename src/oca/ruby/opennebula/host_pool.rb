@@ -58,6 +58,10 @@ module OpenNebula
         # Retrieves the monitoring data for all the Hosts in the pool
         #
         # @param [Array<String>] xpath_expressions Elements to retrieve.
+        # @param [Integer] start_time Optional, first sample time. -1 no limit
+        # @param [Integer] end_time Optional, last sample time. -1 no limit
+        # @param [Integer] resolution Optional, period of the samples in
+        #   seconds: 0 (raw), 60 (per-minute rollup) or 3600 (per-hour rollup)
         #
         # @return [Hash<String, <Hash<String, Array<Array<int>>>>>,
         #   OpenNebula::Error] The first level hash uses the Host ID as keys,
@@ -78,16 +82,24 @@ module OpenNebula
         #     {"TEMPLATE/CUSTOM_PROBE"=>[],
         #      "HOST_SHARE/FREE_CPU"=>[["1337609673", "800"]],
         #      "HOST_SHARE/RUNNING_VMS"=>[["1337609673", "3"]]}}
-        def monitoring(xpath_expressions)
+        def monitoring(xpath_expressions, start_time=-1, end_time=-1,
+            resolution=0)
             return super(HOST_POOL_METHODS[:monitoring],
-                'HOST', 'LAST_MON_TIME', xpath_expressions)
+                'HOST', 'LAST_MON_TIME', xpath_expressions, start_time,
+                end_time, resolution)
         end
 
         # Retrieves the monitoring data for all the Hosts in the pool, in XML
         #
+        # @param [Integer] start_time Optional, first sample time. -1 no limit
+        # @param [Integer] end_time Optional, last sample time. -1 no limit
+        # @param [Integer] resolution Optional, period of the samples in
+        #   seconds: 0 (raw), 60 (per-minute rollup) or 3600 (per-hour rollup)
+        #
         # @return [String] VM monitoring data, in XML
-        def monitoring_xml()
-            return @client.call(HOST_POOL_METHODS[:monitoring])
+        def monitoring_xml(start_time=-1, end_time=-1, resolution=0)
+            return @client.call(HOST_POOL_METHODS[:monitoring], start_time,
+                end_time, resolution)
         end
     end
 end
@@ -189,10 +189,11 @@ module OpenNebula
         #
         # @return [Hash<String, Array<Array<int>>, OpenNebula::Error] Hash with
         #   the requested xpath expressions, and an Array of [timestamp, value].
-        def monitoring(xml_method, root_elem, timestamp_elem, xpath_expressions)
+        def monitoring(xml_method, root_elem, timestamp_elem, xpath_expressions,
+            *args)
             return Error.new('ID not defined') if !@pe_id
 
-            rc = @client.call(xml_method, @pe_id)
+            rc = @client.call(xml_method, @pe_id, *args)
 
             if ( OpenNebula.is_error?(rc) )
                 return rc
@@ -30,6 +30,7 @@ module OpenNebula
             :groupquotaupdate   => "groupquota.update",
             :version            => "system.version",
             :config             => "system.config",
+            :queues             => "system.queues",
             :sql                => "system.sql",
             :sqlquery           => "system.sqlquery"
         }
@@ -115,6 +116,23 @@ module OpenNebula
             return config
         end
 
+        # Gets the action queue statistics of the oned managers
+        #
+        # @return [XMLElement, OpenNebula::Error] the queue statistics in case
+        #   of success, Error otherwise
+        def get_queues()
+            rc = @client.call(SYSTEM_METHODS[:queues])
+
+            if OpenNebula.is_error?(rc)
+                return rc
+            end
+
+            queues = XMLElement.new
+            queues.initialize_xml(rc, 'QUEUES')
+
+            return queues
+        end
+
         # Gets the default user quota limits
         #
         # @return [XMLElement, OpenNebula::Error] the default user quota in case
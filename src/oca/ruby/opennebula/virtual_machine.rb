@@ -552,6 +552,10 @@ module OpenNebula
         # Retrieves this VM's monitoring data from OpenNebula
         #
         # @param [Array<String>] xpath_expressions Elements to retrieve.
+        # @param [Integer] start_time Optional, first sample time. -1 no limit
+        # @param [Integer] end_time Optional, last sample time. -1 no limit
+        # @param [Integer] resolution Optional, period of the samples in
+        #   seconds: 0 (raw), 60 (per-minute rollup) or 3600 (per-hour rollup)
         #
         # @return [Hash<String, Array<Array<int>>>, OpenNebula::Error] Hash with
         #   the requested xpath expressions, and an Array of 'timestamp, value'.
@@ -566,18 +570,26 @@ module OpenNebula
         #      ["1435085410", "50"], ["1435085566", "50"], ["1435085723", "50"]]
         #   }
         #
-        def monitoring(xpath_expressions)
+        def monitoring(xpath_expressions, start_time=-1, end_time=-1,
+            resolution=0)
             return super(VM_METHODS[:monitoring], 'VM',
-                'LAST_POLL', xpath_expressions)
+                'LAST_POLL', xpath_expressions, start_time, end_time,
+                resolution)
         end
 
         # Retrieves this VM's monitoring data from OpenNebula, in XML
         #
+        # @param [Integer] start_time Optional, first sample time. -1 no limit
+        # @param [Integer] end_time Optional, last sample time. -1 no limit
+        # @param [Integer] resolution Optional, period of the samples in
+        #   seconds: 0 (raw), 60 (per-minute rollup) or 3600 (per-hour rollup)
+        #
         # @return [String] VM monitoring data, in XML
-        def monitoring_xml()
+        def monitoring_xml(start_time=-1, end_time=-1, resolution=0)
             return Error.new('ID not defined') if !@pe_id
 
-            return @client.call(VM_METHODS[:monitoring], @pe_id)
+            return @client.call(VM_METHODS[:monitoring], @pe_id, start_time,
+                end_time, resolution)
         end
 
         # Renames this VM
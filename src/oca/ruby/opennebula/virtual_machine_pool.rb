@@ -125,6 +125,10 @@ module OpenNebula
         # @param [Array<String>] xpath_expressions Elements to retrieve.
         # @param [Integer] filter_flag Optional filter flag to retrieve all or
         #   part of the Pool. Possible values: INFO_ALL, INFO_GROUP, INFO_MINE.
+        # @param [Integer] start_time Optional, first sample time. -1 no limit
+        # @param [Integer] end_time Optional, last sample time. -1 no limit
+        # @param [Integer] resolution Optional, period of the samples in
+        #   seconds: 0 (raw), 60 (per-minute rollup) or 3600 (per-hour rollup)
         #
         # @return [Hash<String, <Hash<String, Array<Array<int>>>>>,
         #   OpenNebula::Error] The first level hash uses the VM ID as keys, and
@@ -150,19 +154,27 @@ module OpenNebula
         #     }
         #   }
         #
-        def monitoring(xpath_expressions, filter_flag=INFO_ALL)
+        def monitoring(xpath_expressions, filter_flag=INFO_ALL,
+            start_time=-1, end_time=-1, resolution=0)
             return super(VM_POOL_METHODS[:monitoring],
-                'VM', 'LAST_POLL', xpath_expressions, filter_flag)
+                'VM', 'LAST_POLL', xpath_expressions, filter_flag, start_time,
+                end_time, resolution)
         end
 
         # Retrieves the monitoring data for all the VMs in the pool, in XML
         #
         # @param [Integer] filter_flag Optional filter flag to retrieve all or
         #   part of the Pool. Possible values: INFO_ALL, INFO_GROUP, INFO_MINE.
+        # @param [Integer] start_time Optional, first sample time. -1 no limit
+        # @param [Integer] end_time Optional, last sample time. -1 no limit
+        # @param [Integer] resolution Optional, period of the samples in
+        #   seconds: 0 (raw), 60 (per-minute rollup) or 3600 (per-hour rollup)
         #
         # @return [String] VM monitoring data, in XML
-        def monitoring_xml(filter_flag=INFO_ALL)
-            return @client.call(VM_POOL_METHODS[:monitoring], filter_flag)
+        def monitoring_xml(filter_flag=INFO_ALL, start_time=-1, end_time=-1,
+            resolution=0)
+            return @client.call(VM_POOL_METHODS[:monitoring], filter_flag,
+                start_time, end_time, resolution)
         end
 
         # Processes all the history records, and stores the monthly cost for
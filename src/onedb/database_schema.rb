@@ -67,7 +67,17 @@ class OneDBBacKEnd
         }
     }
 
-    LATEST_DB_VERSION = "5.3.80"
+    # Each version includes the schema of the previous one
+    VERSION_SCHEMA["5.3.85"] = VERSION_SCHEMA["5.3.80"].merge(
+        host_monitoring: "hid INTEGER, resolution INTEGER, " <<
+            "start_time INTEGER, end_time INTEGER, body MEDIUMTEXT, " <<
+            "PRIMARY KEY(hid, resolution, start_time)",
+        vm_monitoring: "vmid INTEGER, resolution INTEGER, " <<
+            "start_time INTEGER, end_time INTEGER, body MEDIUMTEXT, " <<
+            "PRIMARY KEY(vmid, resolution, start_time)"
+    )
+
+    LATEST_DB_VERSION = "5.3.85"
 
     def get_schema(type, version = nil)
         if !version
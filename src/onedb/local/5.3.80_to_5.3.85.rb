@@ -0,0 +1,50 @@
+# -------------------------------------------------------------------------- #
+# Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                #
+#                                                                            #
+# Licensed under the Apache License, Version 2.0 (the "License"); you may    #
+# not use this file except in compliance with the License. You may obtain    #
+# a copy of the License at                                                   #
+#                                                                            #
+# http://www.apache.org/licenses/LICENSE-2.0                                 #
+#                                                                            #
+# Unless required by applicable law or agreed to in writing, software        #
+# distributed under the License is distributed on an "AS IS" BASIS,          #
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   #
+# See the License for the specific language governing permissions and        #
+# limitations under the License.                                             #
+#--------------------------------------------------------------------------- #
+
+$: << File.dirname(__FILE__)
+
+module Migrator
+    def db_version
+        "5.3.85"
+    end
+
+    def one_version
+        "OpenNebula 5.3.85"
+    end
+
+    def up
+        init_log_time()
+
+        monitoring_segments()
+
+        log_time()
+
+        return true
+    end
+
+    private
+
+    ############################################################################
+    # Monitoring time series
+    # The monitoring history is stored in segments of encoded samples, with
+    # a resolution (raw samples, per-minute and per-hour rollups). The
+    # previous samples (full XML documents) are discarded
+    ############################################################################
+    def monitoring_segments
+        create_table(:host_monitoring)
+        create_table(:vm_monitoring)
+    end
+end
@@ -0,0 +1,1575 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+#include "MonitoringStore.h"
+#include "NebulaLog.h"
+#include "NebulaUtil.h"
+
+#include <signal.h>
+#include <errno.h>
+
+#include <climits>
+#include <iomanip>
+#include <cstdlib>
+#include <set>
+
+/* -------------------------------------------------------------------------- */
+/* Encoding helpers                                                           */
+/* -------------------------------------------------------------------------- */
+
+static const unsigned long long SEGMENT_VERSION = 1;
+
+static void put_varint(string& data, unsigned long long value)
+{
+    while ( value >= 0x80 )
+    {
+        data.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+
+    data.push_back(static_cast<char>(value));
+}
+
+/* -------------------------------------------------------------------------- */
+
+static bool get_varint(const string& data, size_t& pos, unsigned long long& value)
+{
+    unsigned int shift = 0;
+
+    value = 0;
+
+    while ( pos < data.size() && shift < 64 )
+    {
+        unsigned char c = static_cast<unsigned char>(data[pos++]);
+
+        value |= static_cast<unsigned long long>(c & 0x7F) << shift;
+
+        if ( (c & 0x80) == 0 )
+        {
+            return true;
+        }
+
+        shift += 7;
+    }
+
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static unsigned long long zigzag(long long value)
+{
+    return (static_cast<unsigned long long>(value) << 1) ^ (value >> 63);
+}
+
+static long long unzigzag(unsigned long long value)
+{
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static long long power10(unsigned int exp)
+{
+    long long p = 1;
+
+    for (unsigned int i = 0; i < exp; i++)
+    {
+        p *= 10;
+    }
+
+    return p;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ *  Parses a decimal number as a fixed point value, e.g. "12.50" -> 125, 1
+ *    @return false if the string is not a number or does not fit
+ */
+static bool parse_fixed(const string& str, unsigned int max_scale,
+        long long& value, unsigned int& scale)
+{
+    size_t pos = str.find_first_not_of(" \t");
+    size_t end = str.find_last_not_of(" \t");
+
+    if ( pos == string::npos )
+    {
+        return false;
+    }
+
+    bool negative = false;
+
+    if ( str[pos] == '-' || str[pos] == '+' )
+    {
+        negative = str[pos] == '-';
+        pos++;
+    }
+
+    unsigned long long mantissa    = 0;
+    unsigned int       significant = 0;
+    unsigned int       decimals    = 0;
+
+    bool any_digit = false;
+    bool point     = false;
+    bool extra     = false;
+    bool round_up  = false;
+
+    for (; pos <= end; pos++)
+    {
+        char c = str[pos];
+
+        if ( c == '.' && !point )
+        {
+            point = true;
+            continue;
+        }
+        else if ( c < '0' || c > '9' )
+        {
+            return false;
+        }
+
+        any_digit = true;
+
+        // Decimals beyond max_scale are rounded
+        if ( point && decimals == max_scale )
+        {
+            if ( !extra )
+            {
+                round_up = c >= '5';
+                extra    = true;
+            }
+
+            continue;
+        }
+
+        if ( (mantissa > 0 || c != '0') && ++significant > 18 )
+        {
+            return false;
+        }
+
+        mantissa = mantissa * 10 + (c - '0');
+
+        if ( point )
+        {
+            decimals++;
+        }
+    }
+
+    if ( !any_digit )
+    {
+        return false;
+    }
+
+    if ( round_up )
+    {
+        mantissa++;
+    }
+
+    // Trailing zeros of the decimal part do not need scale
+    while ( decimals > 0 && mantissa % 10 == 0 )
+    {
+        mantissa /= 10;
+        decimals--;
+    }
+
+    value = negative ? -static_cast<long long>(mantissa) :
+                        static_cast<long long>(mantissa);
+    scale = decimals;
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void fixed_to_str(ostringstream& oss, long long value, unsigned int scale)
+{
+    if ( scale == 0 )
+    {
+        oss << value;
+        return;
+    }
+
+    unsigned long long abs_value = value < 0 ?
+        -static_cast<unsigned long long>(value) : value;
+
+    unsigned long long factor   = power10(scale);
+    unsigned long long decimals = abs_value % factor;
+
+    if ( value < 0 )
+    {
+        oss << "-";
+    }
+
+    oss << abs_value / factor;
+
+    if ( decimals == 0 )
+    {
+        return;
+    }
+
+    while ( decimals % 10 == 0 )
+    {
+        decimals /= 10;
+        scale--;
+    }
+
+    oss << "." << setw(scale) << setfill('0') << decimals << setfill(' ');
+}
+
+/* -------------------------------------------------------------------------- */
+/* MonitoringStore::Column                                                    */
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::Column::add(int index, long long value, unsigned int vscale)
+{
+    if ( vscale > scale )
+    {
+        long long factor = power10(vscale - scale);
+
+        vector<pair<int, long long> > values;
+
+        bool fits = decode(values) == 0 && llabs(last_value) <= LLONG_MAX / factor;
+
+        for (size_t i = 0; fits && i < values.size(); i++)
+        {
+            fits = llabs(values[i].second) <= LLONG_MAX / factor;
+        }
+
+        // The column is not rescaled, the sample is rejected
+        if ( !fits )
+        {
+            return -1;
+        }
+
+        data.clear();
+
+        count      = 0;
+        last_index = -1;
+        last_value = 0;
+        scale      = vscale;
+
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            add(values[i].first, values[i].second * factor, scale);
+        }
+    }
+    else if ( vscale < scale )
+    {
+        long long factor = power10(scale - vscale);
+
+        if ( llabs(value) > LLONG_MAX / factor )
+        {
+            return -1;
+        }
+
+        value *= factor;
+    }
+
+    unsigned long long delta = static_cast<unsigned long long>(value) -
+                               static_cast<unsigned long long>(last_value);
+
+    put_varint(data, index - last_index - 1);
+    put_varint(data, zigzag(static_cast<long long>(delta)));
+
+    last_index = index;
+    last_value = value;
+
+    count++;
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::Column::decode(vector<pair<int, long long> >& values) const
+{
+    size_t pos   = 0;
+    int    index = -1;
+
+    unsigned long long value = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned long long skip, delta;
+
+        if (!get_varint(data, pos, skip) || !get_varint(data, pos, delta))
+        {
+            return -1;
+        }
+
+        index += skip + 1;
+        value += static_cast<unsigned long long>(unzigzag(delta));
+
+        values.push_back(make_pair(index, static_cast<long long>(value)));
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* MonitoringStore::Segment                                                   */
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::Segment::add(time_t timestamp, const Metrics& metrics)
+{
+    if ( count == 0 )
+    {
+        start = timestamp;
+    }
+    else
+    {
+        put_varint(times, timestamp - last);
+    }
+
+    last = timestamp;
+
+    for (Metrics::const_iterator it = metrics.begin(); it != metrics.end(); ++it)
+    {
+        long long    value;
+        unsigned int scale;
+
+        if ( !parse_fixed(it->second, MAX_SCALE, value, scale) )
+        {
+            continue;
+        }
+
+        if ( columns[it->first].add(count, value, scale) != 0 )
+        {
+            ostringstream oss;
+
+            oss << "Value " << it->second << " of monitoring metric "
+                << it->first << " out of range, sample discarded.";
+
+            NebulaLog::log("ONE", Log::WARNING, oss);
+        }
+    }
+
+    count++;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::Segment::encode(string& body) const
+{
+    string data;
+
+    put_varint(data, SEGMENT_VERSION);
+    put_varint(data, count);
+    put_varint(data, start);
+
+    data.append(times);
+
+    put_varint(data, columns.size());
+
+    for (map<string, Column>::const_iterator it = columns.begin();
+            it != columns.end(); ++it)
+    {
+        const Column& col = it->second;
+
+        put_varint(data, it->first.size());
+        data.append(it->first);
+
+        put_varint(data, col.scale);
+        put_varint(data, col.count);
+        put_varint(data, col.data.size());
+        data.append(col.data);
+    }
+
+    string * b64 = one_util::base64_encode(data);
+
+    if ( b64 != 0 )
+    {
+        body = *b64;
+        delete b64;
+    }
+    else
+    {
+        body.clear();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::Segment::to_xml(ostringstream& oss, const string& body,
+        int oid, const string& root, const string& time_elem, time_t start_time,
+        time_t end_time)
+{
+    struct Metric
+    {
+        string prefix;
+        string name;
+
+        Column col;
+
+        vector<pair<int, long long> > values;
+        size_t pos;
+    };
+
+    string * data = one_util::base64_decode(body);
+
+    if ( data == 0 )
+    {
+        return -1;
+    }
+
+    size_t pos = 0;
+    int    rc  = -1;
+
+    unsigned long long version, num, start, num_cols;
+
+    vector<time_t> times;
+    vector<Metric> metrics;
+
+    if (!get_varint(*data, pos, version) || version != SEGMENT_VERSION ||
+        !get_varint(*data, pos, num) || !get_varint(*data, pos, start))
+    {
+        goto error;
+    }
+
+    times.push_back(start);
+
+    for (unsigned long long i = 1; i < num; i++)
+    {
+        unsigned long long delta;
+
+        if (!get_varint(*data, pos, delta))
+        {
+            goto error;
+        }
+
+        times.push_back(times.back() + delta);
+    }
+
+    if (!get_varint(*data, pos, num_cols))
+    {
+        goto error;
+    }
+
+    metrics.resize(num_cols);
+
+    for (unsigned long long i = 0; i < num_cols; i++)
+    {
+        Metric& m = metrics[i];
+
+        unsigned long long len, scale, count;
+
+        if (!get_varint(*data, pos, len) || pos + len > data->size())
+        {
+            goto error;
+        }
+
+        string name = data->substr(pos, len);
+        pos += len;
+
+        size_t slash = name.find('/');
+
+        if ( slash != string::npos )
+        {
+            m.prefix = name.substr(0, slash);
+            m.name   = name.substr(slash + 1);
+        }
+        else
+        {
+            m.name = name;
+        }
+
+        if (!get_varint(*data, pos, scale) || !get_varint(*data, pos, count) ||
+            !get_varint(*data, pos, len) || pos + len > data->size())
+        {
+            goto error;
+        }
+
+        m.col.scale = scale;
+        m.col.count = count;
+        m.col.data  = data->substr(pos, len);
+
+        pos += len;
+
+        if ( m.col.decode(m.values) != 0 )
+        {
+            goto error;
+        }
+
+        m.pos = 0;
+    }
+
+    for (unsigned int i = 0; i < times.size(); i++)
+    {
+        string prefix;
+
+        bool in_range = (start_time == -1 || times[i] >= start_time) &&
+                        (end_time   == -1 || times[i] <= end_time);
+
+        if ( !in_range )
+        {
+            for (vector<Metric>::iterator it = metrics.begin();
+                    it != metrics.end(); ++it)
+            {
+                if ( it->pos < it->values.size() &&
+                     it->values[it->pos].first == static_cast<int>(i) )
+                {
+                    it->pos++;
+                }
+            }
+
+            continue;
+        }
+
+        oss << "<" << root << ">"
+            << "<ID>" << oid << "</ID>"
+            << "<" << time_elem << ">" << times[i] << "</" << time_elem << ">";
+
+        for (vector<Metric>::iterator it = metrics.begin(); it != metrics.end();
+                ++it)
+        {
+            if ( it->pos >= it->values.size() ||
+                 it->values[it->pos].first != static_cast<int>(i) )
+            {
+                continue;
+            }
+
+            if ( it->prefix != prefix )
+            {
+                if ( !prefix.empty() )
+                {
+                    oss << "</" << prefix << ">";
+                }
+
+                prefix = it->prefix;
+
+                if ( !prefix.empty() )
+                {
+                    oss << "<" << prefix << ">";
+                }
+            }
+
+            oss << "<" << it->name << ">";
+
+            fixed_to_str(oss, it->values[it->pos].second, it->col.scale);
+
+            oss << "</" << it->name << ">";
+
+            it->pos++;
+        }
+
+        if ( !prefix.empty() )
+        {
+            oss << "</" << prefix << ">";
+        }
+
+        oss << "</" << root << ">";
+    }
+
+    rc = 0;
+
+error:
+    delete data;
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* MonitoringStore::Rollup                                                    */
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::Rollup::add(const Metrics& sample)
+{
+    for (Metrics::const_iterator it = sample.begin(); it != sample.end(); ++it)
+    {
+        long long    value;
+        unsigned int scale;
+
+        if ( !parse_fixed(it->second, MAX_SCALE, value, scale) )
+        {
+            continue;
+        }
+
+        double dvalue = static_cast<double>(value) / power10(scale);
+
+        map<string, Aggregate>::iterator jt = metrics.find(it->first);
+
+        if ( jt == metrics.end() )
+        {
+            Aggregate agg = {dvalue, dvalue, dvalue, 1, scale};
+
+            metrics.insert(make_pair(it->first, agg));
+            continue;
+        }
+
+        Aggregate& agg = jt->second;
+
+        if ( dvalue < agg.min )
+        {
+            agg.min = dvalue;
+        }
+
+        if ( dvalue > agg.max )
+        {
+            agg.max = dvalue;
+        }
+
+        if ( scale > agg.scale )
+        {
+            agg.scale = scale;
+        }
+
+        agg.sum += dvalue;
+        agg.count++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::Rollup::to_metrics(Metrics& sample) const
+{
+    map<string, Aggregate>::const_iterator it;
+
+    for (it = metrics.begin(); it != metrics.end(); ++it)
+    {
+        const Aggregate& agg = it->second;
+
+        // The average gets two extra decimals
+        unsigned int avg_scale = agg.scale + 2 > MAX_SCALE ? MAX_SCALE :
+                                 agg.scale + 2;
+        ostringstream avg, min, max;
+
+        avg << fixed << setprecision(avg_scale) << agg.sum / agg.count;
+        min << fixed << setprecision(agg.scale) << agg.min;
+        max << fixed << setprecision(agg.scale) << agg.max;
+
+        sample[it->first]          = avg.str();
+        sample[it->first + "_MIN"] = min.str();
+        sample[it->first + "_MAX"] = max.str();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* MonitoringStore                                                            */
+/* -------------------------------------------------------------------------- */
+
+const time_t MonitoringStore::PERIOD[] = {0, 60, 3600};
+
+const time_t MonitoringStore::SEGMENT_TIME[] = {900, 3600, 86400};
+
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::resolution(int seconds, Resolution& res)
+{
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        if ( PERIOD[i] == seconds )
+        {
+            res = static_cast<Resolution>(i);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+MonitoringStore::MonitoringStore(SqlDB * _db, const char * _table,
+        const char * _oid_column, const char * _pool_table, const char * _root,
+        const char * _time_elem, time_t raw_expiration, time_t minute_expiration,
+        time_t hour_expiration):db(_db), table(_table), oid_column(_oid_column),
+        pool_table(_pool_table), root(_root), time_elem(_time_elem),
+        num_pending(0)
+{
+    expiration[RAW]    = raw_expiration;
+    expiration[MINUTE] = minute_expiration;
+    expiration[HOUR]   = hour_expiration;
+
+    pthread_mutex_init(&mutex, 0);
+
+    pthread_mutex_init(&write_mutex, 0);
+
+    // -------------------------------------------------------------------------
+    // Start the expiration thread, if any series expires
+    // -------------------------------------------------------------------------
+    pthread_condattr_t cattr;
+    sigset_t           mask;
+    sigset_t           old_mask;
+
+    pthread_mutex_init(&expire_mutex, 0);
+
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+
+    pthread_cond_init(&expire_cond, &cattr);
+
+    pthread_condattr_destroy(&cattr);
+
+    expire_stop    = false;
+    expire_started = false;
+
+    if ( raw_expiration == 0 && minute_expiration == 0 && hour_expiration == 0)
+    {
+        return;
+    }
+
+    // Signals are handled by the daemon threads
+    sigfillset(&mask);
+
+    pthread_sigmask(SIG_BLOCK, &mask, &old_mask);
+
+    expire_started = pthread_create(&expire_thread, 0, monitoring_expire_loop,
+            (void *) this) == 0;
+
+    pthread_sigmask(SIG_SETMASK, &old_mask, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+MonitoringStore::~MonitoringStore()
+{
+    map<int, Segment *>::iterator it;
+
+    if ( expire_started )
+    {
+        pthread_mutex_lock(&expire_mutex);
+
+        expire_stop = true;
+
+        pthread_cond_signal(&expire_cond);
+
+        pthread_mutex_unlock(&expire_mutex);
+
+        pthread_join(expire_thread, 0);
+    }
+
+    pthread_cond_destroy(&expire_cond);
+
+    pthread_mutex_destroy(&expire_mutex);
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        for (it = open[i].begin(); it != open[i].end(); ++it)
+        {
+            delete it->second;
+        }
+
+        drop_sealed(static_cast<Resolution>(i), pending[i]);
+    }
+
+    pthread_mutex_destroy(&write_mutex);
+
+    pthread_mutex_destroy(&mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::add_sample(Resolution res, int oid, time_t timestamp,
+        const Metrics& metrics, SegmentList& full)
+{
+    Segment * seg;
+
+    map<int, Segment *>::iterator it = open[res].find(oid);
+
+    if ( it == open[res].end() )
+    {
+        seg = new Segment;
+
+        open[res].insert(make_pair(oid, seg));
+    }
+    else
+    {
+        seg = it->second;
+
+        if ( seg->count >= SEGMENT_SAMPLES ||
+             window(res, oid, seg->start) != window(res, oid, timestamp) )
+        {
+            sealed[res].insert(make_pair(oid, seg));
+
+            full.push_back(make_pair(oid, seg));
+
+            seg = new Segment;
+
+            it->second = seg;
+        }
+    }
+
+    seg->add(timestamp, metrics);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::add_rollups(int oid, time_t timestamp,
+        const Metrics& metrics, SegmentList full[RESOLUTIONS])
+{
+    for (int i = MINUTE; i < RESOLUTIONS; i++)
+    {
+        Resolution res = static_cast<Resolution>(i);
+
+        if ( expiration[res] == 0 )
+        {
+            continue;
+        }
+
+        time_t start = timestamp - timestamp % PERIOD[res];
+
+        Rollup& rollup = rollups[res][oid];
+
+        if ( !rollup.metrics.empty() && rollup.start != start )
+        {
+            Metrics sample;
+
+            rollup.to_metrics(sample);
+
+            add_sample(res, oid, rollup.start, sample, full[res]);
+
+            rollup.metrics.clear();
+        }
+
+        rollup.start = start;
+
+        rollup.add(metrics);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::append(int oid, time_t timestamp, const Metrics& metrics)
+{
+    SegmentList full[RESOLUTIONS];
+
+    pthread_mutex_lock(&mutex);
+
+    map<int, Segment *>::iterator it = open[RAW].find(oid);
+
+    if ( it != open[RAW].end() && timestamp <= it->second->last )
+    {
+        pthread_mutex_unlock(&mutex);
+        return 0;
+    }
+
+    add_sample(RAW, oid, timestamp, metrics, full[RAW]);
+
+    add_rollups(oid, timestamp, metrics, full);
+
+    add_pending(full, false);
+
+    pthread_mutex_unlock(&mutex);
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        write(static_cast<Resolution>(i), full[i]);
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::add_pending(SegmentList segments[RESOLUTIONS], bool all)
+{
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        pending[i].insert(pending[i].end(), segments[i].begin(),
+                segments[i].end());
+
+        num_pending += segments[i].size();
+
+        segments[i].clear();
+    }
+
+    if ( !all && num_pending < WRITE_SEGMENTS )
+    {
+        return;
+    }
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        segments[i].swap(pending[i]);
+    }
+
+    num_pending = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::write(Resolution res, const SegmentList& segments)
+{
+    pthread_mutex_lock(&write_mutex);
+
+    write_rows(res, segments);
+
+    pthread_mutex_unlock(&write_mutex);
+
+    pthread_mutex_lock(&mutex);
+
+    drop_sealed(res, segments);
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::write_open()
+{
+    SegmentList copies[RESOLUTIONS];
+
+    pthread_mutex_lock(&write_mutex);
+
+    pthread_mutex_lock(&mutex);
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        map<int, Segment *>::iterator it;
+
+        for (it = open[i].begin(); it != open[i].end(); ++it)
+        {
+            Segment * seg = it->second;
+
+            if ( seg->count > seg->written )
+            {
+                seg->written = seg->count;
+
+                copies[i].push_back(make_pair(it->first, new Segment(*seg)));
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        write_rows(static_cast<Resolution>(i), copies[i]);
+
+        for (size_t j = 0; j < copies[i].size(); j++)
+        {
+            delete copies[i][j].second;
+        }
+    }
+
+    pthread_mutex_unlock(&write_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::write_rows(Resolution res, const SegmentList& segments)
+{
+    SegmentList::const_iterator it = segments.begin();
+
+    ostringstream oss;
+
+    vector<string> cmds;
+
+    string sql_start;
+
+    oss << "REPLACE INTO " << table << " (" << oid_column
+        << ", resolution, start_time, end_time, body) VALUES ";
+
+    sql_start = oss.str();
+
+    // Use a single statement with all the segments if supported, or a
+    // statement per segment written in a single transaction otherwise
+    bool multiple = db->multiple_values_support();
+
+    while ( it != segments.end() )
+    {
+        int    num  = 0;
+        size_t size = 0;
+
+        oss.str("");
+
+        do
+        {
+            string body;
+
+            it->second->encode(body);
+
+            if ( body.empty() )
+            {
+                ostringstream eoss;
+
+                eoss << "Error encoding monitoring segment of object "
+                     << it->first;
+
+                NebulaLog::log("ONE", Log::ERROR, eoss);
+            }
+            else
+            {
+                if ( num > 0 && !multiple )
+                {
+                    cmds.push_back(oss.str());
+
+                    oss.str("");
+                }
+
+                if ( num++ == 0 || !multiple )
+                {
+                    oss << sql_start;
+                }
+                else
+                {
+                    oss << ",";
+                }
+
+                oss << "(" << it->first << "," << PERIOD[res] << ","
+                    << it->second->start << "," << it->second->last << ",'"
+                    << body << "')";
+
+                size += body.size() + 64;
+            }
+
+            ++it;
+        }
+        while ( it != segments.end() && size < MAX_STATEMENT );
+
+        if ( num == 0 )
+        {
+            continue;
+        }
+
+        int rc;
+
+        if ( multiple )
+        {
+            rc = db->exec_local_wr(oss);
+        }
+        else
+        {
+            cmds.push_back(oss.str());
+
+            rc = db->exec_local_trx(cmds);
+
+            cmds.clear();
+        }
+
+        if ( rc != 0 )
+        {
+            oss.str("");
+
+            oss << "Error writing " << num << " monitoring segments to "
+                << table;
+
+            NebulaLog::log("ONE", Log::ERROR, oss);
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::drop_sealed(Resolution res, const SegmentList& segments)
+{
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        int       oid = segments[i].first;
+        Segment * seg = segments[i].second;
+
+        pair<multimap<int, Segment *>::iterator,
+             multimap<int, Segment *>::iterator> range;
+
+        range = sealed[res].equal_range(oid);
+
+        for (multimap<int, Segment *>::iterator it = range.first;
+                it != range.second; ++it)
+        {
+            if ( it->second == seg )
+            {
+                sealed[res].erase(it);
+                break;
+            }
+        }
+
+        delete seg;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::dump_cb(void * _bodies, int num, char **values,
+        char **names)
+{
+    map<int, vector<Body> > * bodies;
+
+    bodies = static_cast<map<int, vector<Body> > *>(_bodies);
+
+    if ( num != 4 || values == 0 || values[0] == 0 || values[1] == 0 ||
+            values[2] == 0 || values[3] == 0 )
+    {
+        return -1;
+    }
+
+    Body b;
+
+    b.start = static_cast<time_t>(strtoll(values[1], 0, 10));
+    b.end   = static_cast<time_t>(strtoll(values[2], 0, 10));
+    b.body  = values[3];
+
+    (*bodies)[atoi(values[0])].push_back(b);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::dump(ostringstream& oss, const string& where,
+        const vector<int>& oids, Resolution res, time_t start_time,
+        time_t end_time)
+{
+    map<int, vector<Body> > mem_bodies;
+    map<int, vector<Body> > db_bodies;
+
+    ostringstream cmd;
+
+    int rc;
+
+    // -------------------------------------------------------------------------
+    // Segments in memory first. A segment may also be in the DB, written
+    // while it was open or meanwhile; the copy with more samples is used.
+    // -------------------------------------------------------------------------
+    pthread_mutex_lock(&mutex);
+
+    for (vector<int>::const_iterator it = oids.begin(); it != oids.end(); ++it)
+    {
+        vector<Segment *> segs;
+
+        pair<multimap<int, Segment *>::iterator,
+             multimap<int, Segment *>::iterator> range;
+
+        range = sealed[res].equal_range(*it);
+
+        for (multimap<int, Segment *>::iterator jt = range.first;
+                jt != range.second; ++jt)
+        {
+            segs.push_back(jt->second);
+        }
+
+        map<int, Segment *>::iterator jt = open[res].find(*it);
+
+        if ( jt != open[res].end() )
+        {
+            segs.push_back(jt->second);
+        }
+
+        for (vector<Segment *>::iterator jt = segs.begin(); jt != segs.end();
+                ++jt)
+        {
+            if ( (*jt)->count == 0 ||
+                 (start_time != -1 && (*jt)->last  < start_time) ||
+                 (end_time   != -1 && (*jt)->start > end_time) )
+            {
+                continue;
+            }
+
+            Body b;
+
+            b.start = (*jt)->start;
+            b.end   = (*jt)->last;
+
+            (*jt)->encode(b.body);
+
+            mem_bodies[*it].push_back(b);
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    // -------------------------------------------------------------------------
+    // Segments in the DB for the objects that match the filter
+    // -------------------------------------------------------------------------
+    cmd << "SELECT " << table << "." << oid_column << ", " << table
+        << ".start_time, " << table << ".end_time, " << table
+        << ".body FROM " << table
+        << " INNER JOIN " << pool_table << " WHERE " << oid_column << " = oid"
+        << " AND " << table << ".resolution = " << PERIOD[res];
+
+    if ( start_time != -1 )
+    {
+        cmd << " AND " << table << ".end_time >= " << start_time;
+    }
+
+    if ( end_time != -1 )
+    {
+        cmd << " AND " << table << ".start_time <= " << end_time;
+    }
+
+    if ( !where.empty() )
+    {
+        cmd << " AND " << where;
+    }
+
+    cmd << " ORDER BY " << oid_column << ", " << table << ".start_time";
+
+    set_callback(static_cast<Callbackable::Callback>(&MonitoringStore::dump_cb),
+                 static_cast<void *>(&db_bodies));
+
+    rc = db->exec_rd(cmd, this);
+
+    unset_callback();
+
+    if ( rc != 0 )
+    {
+        return rc;
+    }
+
+    // -------------------------------------------------------------------------
+    // Render the samples of each object
+    // -------------------------------------------------------------------------
+    set<int> sorted(oids.begin(), oids.end());
+
+    oss << "<MONITORING_DATA>";
+
+    for (set<int>::iterator it = sorted.begin(); it != sorted.end(); ++it)
+    {
+        map<time_t, Body *> segments;
+
+        vector<Body>& dbb  = db_bodies[*it];
+        vector<Body>& memb = mem_bodies[*it];
+
+        for (vector<Body>::iterator jt = dbb.begin(); jt != dbb.end(); ++jt)
+        {
+            segments[jt->start] = &(*jt);
+        }
+
+        for (vector<Body>::iterator jt = memb.begin(); jt != memb.end(); ++jt)
+        {
+            Body *& b = segments[jt->start];
+
+            if ( b == 0 || b->end < jt->end )
+            {
+                b = &(*jt);
+            }
+        }
+
+        for (map<time_t, Body *>::iterator jt = segments.begin();
+                jt != segments.end(); ++jt)
+        {
+            Segment::to_xml(oss, jt->second->body, *it, root, time_elem,
+                    start_time, end_time);
+        }
+    }
+
+    oss << "</MONITORING_DATA>";
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::write_ended()
+{
+    SegmentList ended[RESOLUTIONS];
+
+    time_t the_time = time(0);
+
+    pthread_mutex_lock(&mutex);
+
+    // Rollups of past periods of objects without new samples
+    for (int i = MINUTE; i < RESOLUTIONS; i++)
+    {
+        Resolution res = static_cast<Resolution>(i);
+
+        map<int, Rollup>::iterator it = rollups[res].begin();
+
+        while ( it != rollups[res].end() )
+        {
+            if ( it->second.start + PERIOD[res] <= the_time )
+            {
+                Metrics sample;
+
+                it->second.to_metrics(sample);
+
+                add_sample(res, it->first, it->second.start, sample, ended[res]);
+
+                rollups[res].erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // Segments whose time window has ended
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        Resolution res = static_cast<Resolution>(i);
+
+        map<int, Segment *>::iterator it = open[res].begin();
+
+        while ( it != open[res].end() )
+        {
+            if (window(res, it->first, it->second->last) !=
+                window(res, it->first, the_time))
+            {
+                sealed[res].insert(*it);
+
+                ended[res].push_back(*it);
+
+                open[res].erase(it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    add_pending(ended, true);
+
+    pthread_mutex_unlock(&mutex);
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        write(static_cast<Resolution>(i), ended[i]);
+    }
+
+    write_open();
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+extern "C" void * monitoring_expire_loop(void *arg)
+{
+    MonitoringStore * store = static_cast<MonitoringStore *>(arg);
+
+    store->expire_loop();
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool MonitoringStore::expire_wait(unsigned int ms)
+{
+    struct timespec timeout;
+
+    clock_gettime(CLOCK_MONOTONIC, &timeout);
+
+    timeout.tv_sec  += ms / 1000;
+    timeout.tv_nsec += (ms % 1000) * 1000000;
+
+    if ( timeout.tv_nsec >= 1000000000 )
+    {
+        timeout.tv_sec  += 1;
+        timeout.tv_nsec -= 1000000000;
+    }
+
+    while ( !expire_stop )
+    {
+        if (pthread_cond_timedwait(&expire_cond, &expire_mutex, &timeout) ==
+                ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    return !expire_stop;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::expire_loop()
+{
+    pthread_mutex_lock(&expire_mutex);
+
+    while ( expire_wait(EXPIRE_PERIOD * 1000) )
+    {
+        pthread_mutex_unlock(&expire_mutex);
+
+        expire(time(0));
+
+        pthread_mutex_lock(&expire_mutex);
+    }
+
+    pthread_mutex_unlock(&expire_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::expire(time_t the_time)
+{
+    ostringstream oss;
+    ostringstream filter;
+
+    int num = 0;
+    int oid = -1;
+
+    single_cb<int> cb;
+
+    // Segments of each resolution older than its expiration time
+    filter << "(";
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        if ( expiration[i] == 0 )
+        {
+            continue;
+        }
+
+        if ( num++ > 0 )
+        {
+            filter << " OR ";
+        }
+
+        filter << "(resolution = " << PERIOD[i] << " AND end_time < "
+               << the_time - expiration[i] << ")";
+    }
+
+    filter << ")";
+
+    if ( num == 0 )
+    {
+        return 0;
+    }
+
+    while ( true )
+    {
+        int rc;
+
+        // Next object with segments, skips the gaps in the oid sequence
+        oss.str("");
+
+        oss << "SELECT " << oid_column << " FROM " << table << " WHERE "
+            << oid_column << " > " << oid << " ORDER BY " << oid_column
+            << " LIMIT 1";
+
+        oid = -1;
+
+        cb.set_callback(&oid);
+
+        rc = db->exec_rd(oss, &cb);
+
+        cb.unset_callback();
+
+        if ( rc != 0 )
+        {
+            return -1;
+        }
+
+        if ( oid == -1 )
+        {
+            return 0;
+        }
+
+        oss.str("");
+
+        oss << "DELETE FROM " << table << " WHERE " << oid_column << " >= "
+            << oid << " AND " << oid_column << " < " << oid + EXPIRE_OIDS
+            << " AND " << filter.str();
+
+        if ( db->exec_local_wr(oss) != 0 )
+        {
+            return -1;
+        }
+
+        oid = oid + EXPIRE_OIDS - 1;
+
+        pthread_mutex_lock(&expire_mutex);
+
+        bool running = expire_wait(EXPIRE_PAUSE);
+
+        pthread_mutex_unlock(&expire_mutex);
+
+        if ( !running )
+        {
+            return -1;
+        }
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+int MonitoringStore::clean_all()
+{
+    ostringstream oss;
+
+    pthread_mutex_lock(&mutex);
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        map<int, Segment *>::iterator it;
+
+        for (it = open[i].begin(); it != open[i].end(); ++it)
+        {
+            delete it->second;
+        }
+
+        open[i].clear();
+
+        rollups[i].clear();
+
+        drop_sealed(static_cast<Resolution>(i), pending[i]);
+
+        pending[i].clear();
+    }
+
+    num_pending = 0;
+
+    pthread_mutex_unlock(&mutex);
+
+    oss << "DELETE FROM " << table;
+
+    return db->exec_local_wr(oss);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void MonitoringStore::flush()
+{
+    SegmentList segments[RESOLUTIONS];
+
+    pthread_mutex_lock(&mutex);
+
+    for (int i = MINUTE; i < RESOLUTIONS; i++)
+    {
+        Resolution res = static_cast<Resolution>(i);
+
+        map<int, Rollup>::iterator it;
+
+        for (it = rollups[res].begin(); it != rollups[res].end(); ++it)
+        {
+            Metrics sample;
+
+            it->second.to_metrics(sample);
+
+            add_sample(res, it->first, it->second.start, sample, segments[res]);
+        }
+
+        rollups[res].clear();
+    }
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        map<int, Segment *>::iterator it;
+
+        for (it = open[i].begin(); it != open[i].end(); ++it)
+        {
+            sealed[i].insert(*it);
+
+            segments[i].push_back(*it);
+        }
+
+        open[i].clear();
+    }
+
+    add_pending(segments, true);
+
+    pthread_mutex_unlock(&mutex);
+
+    for (int i = 0; i < RESOLUTIONS; i++)
+    {
+        write(static_cast<Resolution>(i), segments[i]);
+    }
+}
@@ -88,7 +88,7 @@ void PoolSQL::set_lastOID(int _last_oid)
 /* -------------------------------------------------------------------------- */
 
 PoolSQL::PoolSQL(SqlDB * _db, const char * _table):
-    db(_db), table(_table)
+    db(_db), batch(0), table(_table)
 {
     pthread_mutex_init(&mutex,0);
 };
@@ -112,6 +112,8 @@ PoolSQL::~PoolSQL()
     pthread_mutex_unlock(&mutex);
 
     pthread_mutex_destroy(&mutex);
+
+    delete batch;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -177,6 +179,8 @@ PoolObjectSQL * PoolSQL::get(int oid, bool olock)
 
     flush_cache(oid);
 
+    flush_batch(oid);
+
     PoolObjectSQL * objectsql = create();
 
     objectsql->oid = oid;
@@ -217,6 +221,8 @@ PoolObjectSQL * PoolSQL::get(const string& name, int ouid, bool olock)
 
     flush_cache(name_key);
 
+    flush_batch();
+
     PoolObjectSQL * objectsql = create();
 
     int rc = objectsql->select(db, name, ouid);
@@ -377,6 +383,8 @@ int PoolSQL::dump(ostringstream& oss, const string& root_elem_name,
 {
     int rc;
 
+    flush_batch();
+
     oss << "<" << root_elem_name << ">";
 
     set_callback(static_cast<Callbackable::Callback>(&PoolSQL::dump_cb),
@@ -422,6 +430,8 @@ int PoolSQL::search(
     ostringstream   sql;
     int             rc;
 
+    flush_batch();
+
     set_callback(static_cast<Callbackable::Callback>(&PoolSQL::search_cb),
                  static_cast<void *>(&oids));
 
@@ -0,0 +1,188 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+#include "UpdateBatch.h"
+#include "NebulaLog.h"
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+UpdateBatch::UpdateBatch(SqlDB * _db):db(_db), num_rows(0)
+{
+    pthread_mutex_init(&mutex, 0);
+
+    pthread_mutex_init(&write_mutex, 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+UpdateBatch::~UpdateBatch()
+{
+    pthread_mutex_destroy(&mutex);
+
+    pthread_mutex_destroy(&write_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void UpdateBatch::add(const char * table, const char * db_names, int oid,
+        const string& row)
+{
+    bool full;
+
+    pthread_mutex_lock(&mutex);
+
+    Table& t = tables[table];
+
+    if ( t.db_names.empty() )
+    {
+        t.db_names = db_names;
+    }
+
+    pair<map<int, string>::iterator, bool> rc;
+
+    rc = t.rows.insert(make_pair(oid, row));
+
+    if ( rc.second == false )
+    {
+        rc.first->second = row;
+    }
+    else
+    {
+        num_rows++;
+    }
+
+    oids.insert(oid);
+
+    full = num_rows >= MAX_ROWS;
+
+    pthread_mutex_unlock(&mutex);
+
+    if ( full )
+    {
+        flush();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void UpdateBatch::flush(int oid)
+{
+    bool pending;
+
+    // Wait for any write in progress, it may include rows of the object
+    pthread_mutex_lock(&write_mutex);
+
+    pthread_mutex_lock(&mutex);
+
+    pending = oids.count(oid) > 0;
+
+    pthread_mutex_unlock(&mutex);
+
+    if ( pending )
+    {
+        write();
+    }
+
+    pthread_mutex_unlock(&write_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void UpdateBatch::flush()
+{
+    pthread_mutex_lock(&write_mutex);
+
+    write();
+
+    pthread_mutex_unlock(&write_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void UpdateBatch::write()
+{
+    map<string, Table> _tables;
+
+    pthread_mutex_lock(&mutex);
+
+    _tables.swap(tables);
+
+    oids.clear();
+
+    num_rows = 0;
+
+    pthread_mutex_unlock(&mutex);
+
+    bool multiple = db->multiple_values_support();
+
+    for (map<string, Table>::iterator it = _tables.begin();
+            it != _tables.end(); ++it)
+    {
+        map<int, string>& rows = it->second.rows;
+
+        map<int, string>::iterator jt = rows.begin();
+
+        ostringstream oss;
+
+        string sql_start;
+
+        oss << "REPLACE INTO " << it->first << " (" << it->second.db_names
+            << ") VALUES ";
+
+        sql_start = oss.str();
+
+        // Use a single statement with all the rows if supported or a
+        // statement per row otherwise. Statements are replicated and applied
+        // within a transaction, so they cannot include their own.
+        while ( jt != rows.end() )
+        {
+            int    num  = 0;
+            size_t size = 0;
+
+            oss.str("");
+
+            oss << sql_start;
+
+            do
+            {
+                if ( num++ > 0 )
+                {
+                    oss << ",";
+                }
+
+                oss << jt->second;
+
+                size += jt->second.size() + 1;
+
+                ++jt;
+            }
+            while ( multiple && jt != rows.end() &&
+                    size + jt->second.size() < MAX_STATEMENT );
+
+            if ( db->exec_wr(oss) != 0 )
+            {
+                oss.str("");
+
+                oss << "Error writing " << num << " rows to " << it->first;
+
+                NebulaLog::log("ONE", Log::ERROR, oss);
+            }
+        }
+    }
+}
@@ -0,0 +1,335 @@
+/* -------------------------------------------------------------------------- */
+/* Copyright 2002-2017, OpenNebula Project, OpenNebula Systems                */
+/*                                                                            */
+/* Licensed under the Apache License, Version 2.0 (the "License"); you may    */
+/* not use this file except in compliance with the License. You may obtain    */
+/* a copy of the License at                                                   */
+/*                                                                            */
+/* http://www.apache.org/licenses/LICENSE-2.0                                 */
+/*                                                                            */
+/* Unless required by applicable law or agreed to in writing, software        */
+/* distributed under the License is distributed on an "AS IS" BASIS,          */
+/* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.   */
+/* See the License for the specific language governing permissions and        */
+/* limitations under the License.                                             */
+/* -------------------------------------------------------------------------- */
+
+/**
+ *  Benchmark of the DB statements issued by the monitoring ingestion. Each
+ *  monitoring cycle every host reports its state and the state of its VMs,
+ *  the reports are spread over the monitoring interval.
+ *
+ *    - direct: one statement per write, as the monitor threads did before:
+ *      host row, host sample, and for each VM the history record, VM row
+ *      and VM sample.
+ *    - batched: the rows are added to an UpdateBatch and the samples to a
+ *      MonitoringStore. The batch is flushed every timer period (as the IM
+ *      and VMM timers do).
+ *
+ *  Usage: monitoring_db_bench [-h hosts] [-v vms] [-c cycles] [-t timer]
+ *    -h number of hosts (default 1000)
+ *    -v number of VMs per host (default 10)
+ *    -c number of monitoring cycles (default 60)
+ *    -t timer period in seconds, the interval is 60s (default 15)
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <iostream>
+
+#include "SqliteDB.h"
+#include "UpdateBatch.h"
+#include "MonitoringStore.h"
+#include "NebulaLog.h"
+
+/* -------------------------------------------------------------------------- */
+/* DB wrapper that counts the write statements                                */
+/* -------------------------------------------------------------------------- */
+
+class CountingDB : public SqlDB
+{
+public:
+    CountingDB(SqlDB * _db):db(_db), writes(0){};
+
+    int exec_local_wr(ostringstream& cmd)
+    {
+        writes++;
+        return db->exec_local_wr(cmd);
+    }
+
+    int exec_wr(ostringstream& cmd)
+    {
+        writes++;
+        return db->exec_wr(cmd);
+    }
+
+    int exec_rd(ostringstream& cmd, Callbackable* obj)
+    {
+        return db->exec_rd(cmd, obj);
+    }
+
+    int exec_local_trx(const std::vector<std::string>& cmds)
+    {
+        writes++;
+        return db->exec_local_trx(cmds);
+    }
+
+    char * escape_str(const string& str)
+    {
+        return db->escape_str(str);
+    }
+
+    void free_str(char * str)
+    {
+        db->free_str(str);
+    }
+
+    bool multiple_values_support()
+    {
+        return db->multiple_values_support();
+    }
+
+    SqlDB *            db;
+
+    unsigned long long writes;
+
+protected:
+    int exec(ostringstream& cmd, Callbackable* obj, bool quiet)
+    {
+        return -1;
+    }
+};
+
+/* -------------------------------------------------------------------------- */
+
+static const char * tables[] = {
+    "CREATE TABLE host_pool (oid INTEGER PRIMARY KEY, body MEDIUMTEXT)",
+    "CREATE TABLE vm_pool (oid INTEGER PRIMARY KEY, body MEDIUMTEXT)",
+    "CREATE TABLE history (vid INTEGER, seq INTEGER, body MEDIUMTEXT, "
+        "PRIMARY KEY(vid,seq))",
+    "CREATE TABLE host_monitoring (hid INTEGER, resolution INTEGER, "
+        "start_time INTEGER, end_time INTEGER, body MEDIUMTEXT, "
+        "PRIMARY KEY(hid, resolution, start_time))",
+    "CREATE TABLE vm_monitoring (vmid INTEGER, resolution INTEGER, "
+        "start_time INTEGER, end_time INTEGER, body MEDIUMTEXT, "
+        "PRIMARY KEY(vmid, resolution, start_time))",
+    0
+};
+
+static const int INTERVAL = 60;
+
+static string body(const char * root, int oid, time_t t, size_t size)
+{
+    ostringstream oss;
+
+    oss << "<" << root << "><ID>" << oid << "</ID><TIME>" << t << "</TIME>"
+        << "<TEMPLATE>" << string(size, 'x') << "</TEMPLATE></" << root << ">";
+
+    return oss.str();
+}
+
+static string row(int oid, const string& body)
+{
+    ostringstream oss;
+
+    oss << "(" << oid << ",'" << body << "')";
+
+    return oss.str();
+}
+
+static void metrics(MonitoringStore::Metrics& m, const char * prefix,
+        int num, long long value)
+{
+    for (int i = 0; i < num; i++)
+    {
+        ostringstream name, val;
+
+        name << prefix << "METRIC_" << i;
+        val  << value + i * 1024;
+
+        m[name.str()] = val.str();
+    }
+}
+
+static long long now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void run(bool batched, int hosts, int vms, int cycles, int timer)
+{
+    string file = batched ? "/tmp/monitoring_db_bench_b.db" :
+                            "/tmp/monitoring_db_bench_d.db";
+    unlink(file.c_str());
+
+    SqliteDB   sqlite(file);
+    CountingDB db(&sqlite);
+
+    for (int i = 0; tables[i] != 0; i++)
+    {
+        ostringstream oss(tables[i]);
+
+        sqlite.exec_local_wr(oss);
+    }
+
+    UpdateBatch batch(&db);
+
+    MonitoringStore hstore(&db, "host_monitoring", "hid", "host_pool", "HOST",
+            "LAST_MON_TIME", 86400, 0, 0);
+    MonitoringStore vstore(&db, "vm_monitoring", "vmid", "vm_pool", "VM",
+            "LAST_POLL", 86400, 0, 0);
+
+    time_t    t0    = time(0) - cycles * INTERVAL;
+    long long start = now_ms();
+
+    for (int c = 0; c < cycles; c++)
+    {
+        for (int h = 0; h < hosts; h++)
+        {
+            // Reports are evenly spread over the interval
+            int    offset = (h * INTERVAL) / hosts;
+            time_t t      = t0 + c * INTERVAL + offset;
+
+            if ( batched && h > 0 && offset / timer !=
+                    (((h - 1) * INTERVAL) / hosts) / timer )
+            {
+                batch.flush();
+            }
+
+            string hbody = body("HOST", h, t, 2048);
+
+            MonitoringStore::Metrics hm;
+
+            metrics(hm, "HOST_SHARE/", 15, c * 10 + h);
+
+            if ( batched )
+            {
+                batch.add("host_pool", "oid, body", h, row(h, hbody));
+
+                hstore.append(h, t, hm);
+            }
+            else
+            {
+                ostringstream hrow, hmon;
+
+                hrow << "REPLACE INTO host_pool (oid, body) VALUES "
+                     << row(h, hbody);
+                db.exec_wr(hrow);
+
+                hmon << "REPLACE INTO host_monitoring VALUES (" << h << ",0,"
+                     << t << "," << t << ",'" << hbody << "')";
+                db.exec_local_wr(hmon);
+            }
+
+            for (int v = 0; v < vms; v++)
+            {
+                int vid = h * vms + v;
+
+                string vbody = body("VM", vid, t, 4096);
+
+                ostringstream hist;
+
+                hist << "(" << vid << ",0,'" << vbody << "')";
+
+                MonitoringStore::Metrics vmm;
+
+                metrics(vmm, "MONITORING/", 8, c * 10 + vid);
+
+                if ( batched )
+                {
+                    batch.add("history", "vid, seq, body", vid, hist.str());
+
+                    batch.add("vm_pool", "oid, body", vid, row(vid, vbody));
+
+                    vstore.append(vid, t, vmm);
+                }
+                else
+                {
+                    ostringstream hsql, vsql, msql;
+
+                    hsql << "REPLACE INTO history (vid, seq, body) VALUES "
+                         << hist.str();
+                    db.exec_wr(hsql);
+
+                    vsql << "REPLACE INTO vm_pool (oid, body) VALUES "
+                         << row(vid, vbody);
+                    db.exec_wr(vsql);
+
+                    msql << "REPLACE INTO vm_monitoring VALUES (" << vid
+                         << ",0," << t << "," << t << ",'" << vbody << "')";
+                    db.exec_local_wr(msql);
+                }
+            }
+        }
+    }
+
+    if ( batched )
+    {
+        batch.flush();
+
+        hstore.flush();
+        vstore.flush();
+    }
+
+    long long elapsed = now_ms() - start;
+
+    cout << (batched ? "batched" : "direct ") << ": "
+         << db.writes << " statements, "
+         << db.writes / cycles << " per cycle, "
+         << elapsed << " ms" << endl;
+
+    unlink(file.c_str());
+}
+
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char ** argv)
+{
+    int hosts  = 1000;
+    int vms    = 10;
+    int cycles = 60;
+    int timer  = 15;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "h:v:c:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'h': hosts  = atoi(optarg); break;
+            case 'v': vms    = atoi(optarg); break;
+            case 'c': cycles = atoi(optarg); break;
+            case 't': timer  = atoi(optarg); break;
+            default:
+                cerr << "Usage: " << argv[0]
+                     << " [-h hosts] [-v vms] [-c cycles] [-t timer]" << endl;
+                return -1;
+        }
+    }
+
+    if ( hosts <= 0 || vms < 0 || cycles <= 0 || timer <= 0 )
+    {
+        cerr << "Wrong arguments" << endl;
+        return -1;
+    }
+
+    NebulaLog::init_log_system(NebulaLog::STD, Log::ERROR, 0, ios_base::out,
+            "bench");
+
+    cout << hosts << " hosts, " << vms << " VMs per host, " << cycles
+         << " cycles, " << timer << "s timer" << endl;
+
+    run(false, hosts, vms, cycles, timer);
+
+    run(true, hosts, vms, cycles, timer);
+
+    return 0;
+}
@@ -18,12 +18,17 @@
 #include "ReplicaThread.h"
 #include "Nebula.h"
 #include "Client.h"
+#include "Request.h"
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
 const time_t FedReplicaManager::xmlrpc_timeout_ms = 10000;
 
+const unsigned int FedReplicaManager::batch_size = 100;
+
+const size_t FedReplicaManager::batch_bytes = 512 * 1024;
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
@@ -58,8 +63,8 @@ FedReplicaManager::~FedReplicaManager()
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int FedReplicaManager::apply_log_record(int index, int prev, 
-        const std::string& sql)
+int FedReplicaManager::apply_log_records(int prev,
+        const std::map<int, std::string>& records)
 {
     int rc;
 
@@ -75,9 +80,7 @@ int FedReplicaManager::apply_log_record(int index, int prev,
         return rc;
     }
 
-    std::ostringstream oss(sql);
-
-    if ( logdb->exec_federated_wr(oss, index) != 0 )
+    if ( logdb->exec_federated_wr(records) != 0 )
     {
         pthread_mutex_unlock(&mutex);
         return -1;
@@ -273,9 +276,11 @@ ReplicaThread * FedReplicaManager::thread_factory(int zone_id)
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int FedReplicaManager::get_next_record(int zone_id, std::string& zedp,
-        LogDBRecord& lr, std::string& error)
+int FedReplicaManager::get_next_records(int zone_id, std::string& zedp,
+        std::map<int, std::string>& records, std::string& error)
 {
+    size_t bytes = 0;
+
     pthread_mutex_lock(&mutex);
 
     std::map<int, ZoneServers *>::iterator it = zones.find(zone_id);
@@ -300,35 +305,60 @@ int FedReplicaManager::get_next_record(int zone_id, std::string& zedp,
     if ( zs->last == zs->next )
     {
         zs->next = logdb->next_federated(zs->next);
+    }
 
-        if ( zs->last == zs->next ) //no new records
-        {
-            pthread_mutex_unlock(&mutex);
-            return -1;
-        }
+    if ( zs->next == -1 || zs->last == zs->next ) //no new records
+    {
+        pthread_mutex_unlock(&mutex);
+        return -1;
     }
 
-    int rc = logdb->get_log_record(zs->next, lr);
+    unsigned int max_records = batch_size;
 
-    if ( rc == -1 )
+    if ( zs->next <= zs->single_until )
     {
-        std::ostringstream oss;
+        max_records = 1;
+    }
 
-        oss << "Failed to load federation log record " << zs->next
-            << " for zone " << zs->zone_id;
+    //Load consecutive federated records up to the batch limits
+    for (int index = zs->next; index != -1 && records.size() < max_records &&
+            bytes < batch_bytes; index = logdb->next_federated(index))
+    {
+        LogDBRecord lr;
+
+        if ( logdb->get_log_record(index, lr) != 0 )
+        {
+            std::ostringstream oss;
 
-        error = oss.str();
+            oss << "Failed to load federation log record " << index
+                << " for zone " << zs->zone_id;
+
+            error = oss.str();
+
+            break;
+        }
+
+        records.insert(std::make_pair(index, lr.zsql));
+
+        bytes += lr.zsql.size();
     }
 
+    zs->last_batch = records.size();
+
     pthread_mutex_unlock(&mutex);
 
-    return rc;
+    if ( records.empty() )
+    {
+        return -1;
+    }
+
+    return 0;
 }
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-void FedReplicaManager::replicate_success(int zone_id)
+void FedReplicaManager::replicate_success(int zone_id, int last)
 {
     pthread_mutex_lock(&mutex);
 
@@ -342,9 +372,11 @@ void FedReplicaManager::replicate_success(int zone_id)
 
     ZoneServers * zs = it->second;
 
-    zs->last = zs->next;
+    zs->last = last;
+
+    zs->next = logdb->next_federated(last);
 
-    zs->next = logdb->next_federated(zs->next);
+    zs->last_success = time(0);
 
     if ( zs->next != -1 )
     {
@@ -382,6 +414,103 @@ void FedReplicaManager::replicate_failure(int zone_id, int last_zone)
     pthread_mutex_unlock(&mutex);
 }
 
+/* -------------------------------------------------------------------------- */
+
+int FedReplicaManager::replicate_error(int zone_id, int first, int last)
+{
+    std::ostringstream oss;
+
+    int rc = -1;
+
+    pthread_mutex_lock(&mutex);
+
+    std::map<int, ZoneServers *>::iterator it = zones.find(zone_id);
+
+    if ( it != zones.end() )
+    {
+        if ( first == last )
+        {
+            oss << "Skipping federation log record " << first << " on zone "
+                << zone_id << ", it cannot be applied";
+
+            rc = first;
+        }
+        else
+        {
+            oss << "Cannot apply federation log records " << first << " - "
+                << last << " on zone " << zone_id << ", retrying one by one";
+
+            it->second->single_until = last;
+        }
+
+        NebulaLog::log("FRM", Log::ERROR, oss);
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void FedReplicaManager::update_stats(int zone_id, unsigned int rtt_ms,
+        bool error)
+{
+    pthread_mutex_lock(&mutex);
+
+    std::map<int, ZoneServers *>::iterator it = zones.find(zone_id);
+
+    if ( it != zones.end() )
+    {
+        it->second->last_rtt_ms = rtt_ms;
+
+        if ( error )
+        {
+            it->second->errors++;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+std::string& FedReplicaManager::to_xml(std::string& xml)
+{
+    std::ostringstream oss;
+
+    std::map<int, ZoneServers *>::iterator it;
+
+    pthread_mutex_lock(&mutex);
+
+    oss << "<FEDERATION_REPLICATION>";
+
+    for ( it = zones.begin() ; it != zones.end() ; ++it )
+    {
+        ZoneServers * zs = it->second;
+
+        int lag = logdb->pending_federated(zs->last);
+
+        oss << "<ZONE>"
+            << "<ID>"           << zs->zone_id      << "</ID>"
+            << "<LAST_INDEX>"   << zs->last         << "</LAST_INDEX>"
+            << "<LAG>"          << lag              << "</LAG>"
+            << "<LAST_SUCCESS>" << zs->last_success << "</LAST_SUCCESS>"
+            << "<LAST_BATCH>"   << zs->last_batch   << "</LAST_BATCH>"
+            << "<LAST_RTT_MS>"  << zs->last_rtt_ms  << "</LAST_RTT_MS>"
+            << "<ERRORS>"       << zs->errors       << "</ERRORS>"
+            << "</ZONE>";
+    }
+
+    oss << "</FEDERATION_REPLICATION>";
+
+    pthread_mutex_unlock(&mutex);
+
+    xml = oss.str();
+
+    return xml;
+}
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
@@ -395,14 +524,22 @@ int FedReplicaManager::xmlrpc_replicate_log(int zone_id, bool& success,
 
 	int xml_rc = 0;
 
-    LogDBRecord lr;
+    std::map<int, std::string> records;
+    std::map<int, std::string>::iterator it;
+
+    std::vector<xmlrpc_c::value> xml_records;
+
+    struct timespec start, end;
 
-    if ( get_next_record(zone_id, zedp, lr, error) != 0 )
+    if ( get_next_records(zone_id, zedp, records, error) != 0 )
     {
         return -1;
     }
 
-    int prev_index = logdb->previous_federated(lr.index);
+    int first_index = records.begin()->first;
+    int last_index  = records.rbegin()->first;
+
+    int prev_index = logdb->previous_federated(first_index);
 
     // -------------------------------------------------------------------------
     // Get parameters to call append entries on follower
@@ -412,20 +549,37 @@ int FedReplicaManager::xmlrpc_replicate_log(int zone_id, bool& success,
         return -1;
     }
 
+    for ( it = records.begin(); it != records.end(); ++it )
+    {
+        std::vector<xmlrpc_c::value> xml_record;
+
+        xml_record.push_back(xmlrpc_c::value_int(it->first));
+        xml_record.push_back(xmlrpc_c::value_bytestring(
+                std::vector<unsigned char>(it->second.begin(), it->second.end())));
+
+        xml_records.push_back(xmlrpc_c::value_array(xml_record));
+    }
+
     xmlrpc_c::value result;
     xmlrpc_c::paramList replica_params;
 
     replica_params.add(xmlrpc_c::value_string(secret));
-    replica_params.add(xmlrpc_c::value_int(lr.index));
     replica_params.add(xmlrpc_c::value_int(prev_index));
-    replica_params.add(xmlrpc_c::value_string(lr.sql));
+    replica_params.add(xmlrpc_c::value_array(xml_records));
 
     // -------------------------------------------------------------------------
     // Do the XML-RPC call
     // -------------------------------------------------------------------------
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
     xml_rc = Client::client()->call(zedp, replica_method, replica_params,
         xmlrpc_timeout_ms, &result, error);
 
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    update_stats(zone_id, (end.tv_sec - start.tv_sec) * 1000 +
+            (end.tv_nsec - start.tv_nsec) / 1000000, xml_rc != 0);
+
     if ( xml_rc == 0 )
     {
         vector<xmlrpc_c::value> values;
@@ -441,14 +595,20 @@ int FedReplicaManager::xmlrpc_replicate_log(int zone_id, bool& success,
         {
             error = xmlrpc_c::value_string(values[1]);
             last  = xmlrpc_c::value_int(values[3]);
+
+            if ( xmlrpc_c::value_int(values[2]) == Request::INTERNAL )
+            {
+                last = replicate_error(zone_id, first_index, last_index);
+            }
         }
     }
     else
     {
         std::ostringstream ess;
 
-        ess << "Error replicating log entry " << lr.index << " on zone "
-            << zone_id << " (" << zedp << "): " << error;
+        ess << "Error replicating log entries " << first_index << " - "
+            << last_index << " on zone " << zone_id << " (" << zedp << "): "
+            << error;
 
         NebulaLog::log("FRM", Log::ERROR, ess);
 
@@ -457,3 +617,4 @@ int FedReplicaManager::xmlrpc_replicate_log(int zone_id, bool& success,
 
     return xml_rc;
 }
+
@@ -47,9 +47,10 @@ static unsigned int get_zone_servers(std::map<int, std::string>& _s);
 
 RaftManager::RaftManager(int id, const VectorAttribute * leader_hook_mad,
         const VectorAttribute * follower_hook_mad, time_t log_purge,
-        long long bcast, long long elect, time_t xmlrpc,
+        long long bcast, long long elect, time_t xmlrpc, bool lreads,
         const string& remotes_location):server_id(id), term(0), num_servers(0),
-        commit(0), leader_hook(0), follower_hook(0)
+        commit(0), linearizable_reads(lreads), term_index(0), leader_hook(0),
+        follower_hook(0)
 {
     Nebula& nd    = Nebula::instance();
     LogDB * logdb = nd.get_logdb();
@@ -120,9 +121,12 @@ RaftManager::RaftManager(int id, const VectorAttribute * leader_hook_mad,
     set_timeout(elect, election_timeout);
 
     // 5 seconds warm-up to start election
-    clock_gettime(CLOCK_REALTIME, &last_heartbeat);
+    clock_gettime(CLOCK_MONOTONIC, &last_heartbeat);
     last_heartbeat.tv_sec += 5;
 
+    leader_heartbeat.tv_sec  = 0;
+    leader_heartbeat.tv_nsec = 0;
+
     // -------------------------------------------------------------------------
     // Initialize Hooks
     // -------------------------------------------------------------------------
@@ -413,6 +417,10 @@ void RaftManager::leader()
 
     requests.clear();
 
+    lease.clear();
+
+    term_index = index;
+
     if ( leader_hook != 0 )
     {
         leader_hook->do_hook(0);
@@ -511,6 +519,8 @@ void RaftManager::follower(unsigned int _term)
 
     requests.clear();
 
+    lease.clear();
+
     pthread_mutex_unlock(&mutex);
 
     if ( nd.is_federation_master() )
@@ -530,6 +540,12 @@ void RaftManager::replicate_log(ReplicaRequest * request)
 
     if ( state != LEADER )
     {
+        request->result  = false;
+        request->timeout = false;
+        request->message = "oned is now follower";
+
+        request->notify();
+
         pthread_mutex_unlock(&mutex);
         return;
     }
@@ -640,6 +656,106 @@ void RaftManager::replicate_failure(int follower_id)
     pthread_mutex_unlock(&mutex);
 }
 
+void RaftManager::heartbeat_success(int follower_id,
+        const struct timespec& sent)
+{
+    pthread_mutex_lock(&mutex);
+
+    if ( state == LEADER )
+    {
+        lease[follower_id] = sent;
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int RaftManager::get_read_index(unsigned int& index)
+{
+    std::map<int, struct timespec>::iterator it;
+
+    struct timespec the_time;
+
+    unsigned int acks = 1; //leader
+
+    clock_gettime(CLOCK_MONOTONIC, &the_time);
+
+    pthread_mutex_lock(&mutex);
+
+    if ( state != LEADER || commit < term_index )
+    {
+        pthread_mutex_unlock(&mutex);
+        return -1;
+    }
+
+    for ( it = lease.begin() ; it != lease.end() ; ++it )
+    {
+        time_t sec  = it->second.tv_sec + election_timeout.tv_sec;
+        long   nsec = it->second.tv_nsec + election_timeout.tv_nsec;
+
+        if ( nsec >= 1000000000 )
+        {
+            sec  += 1;
+            nsec -= 1000000000;
+        }
+
+        if ((sec > the_time.tv_sec) || (sec == the_time.tv_sec &&
+                nsec > the_time.tv_nsec))
+        {
+            acks++;
+        }
+    }
+
+    if ( acks <= num_servers / 2 )
+    {
+        pthread_mutex_unlock(&mutex);
+        return -1;
+    }
+
+    index = commit;
+
+    pthread_mutex_unlock(&mutex);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int RaftManager::read_barrier(std::string& error)
+{
+    Nebula& nd    = Nebula::instance();
+    LogDB * logdb = nd.get_logdb();
+
+    unsigned int read_index, lindex, lterm;
+
+    if ( xmlrpc_read_index(read_index, error) != 0 )
+    {
+        return -1;
+    }
+
+    // The leader has committed up to read_index, records already in the
+    // local log can be applied without waiting for the next heartbeat
+    logdb->get_last_record_index(lindex, lterm);
+
+    logdb->apply_log_records(update_commit(read_index, lindex));
+
+    if ( logdb->wait_log_record(read_index, xmlrpc_timeout_ms) != 0 )
+    {
+        std::ostringstream oss;
+
+        oss << "Log record " << read_index << " not applied in time";
+
+        error = oss.str();
+
+        return -1;
+    }
+
+    return 0;
+}
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 /* Raft state interface                                                       */
@@ -648,13 +764,76 @@ void RaftManager::replicate_failure(int follower_id)
 
 void RaftManager::update_last_heartbeat(int _leader_id)
 {
+    std::vector<std::string> stale;
+
     pthread_mutex_lock(&mutex);
 
+    if ( leader_id != _leader_id )
+    {
+        std::map<int, std::string>::iterator it;
+
+        for (it = servers.begin(); it != servers.end() ; ++it )
+        {
+            if ( it->first != _leader_id )
+            {
+                stale.push_back(it->second);
+            }
+        }
+    }
+
     leader_id = _leader_id;
 
-	clock_gettime(CLOCK_REALTIME, &last_heartbeat);
+	clock_gettime(CLOCK_MONOTONIC, &last_heartbeat);
+
+    if ( leader_id != -1 )
+    {
+        leader_heartbeat = last_heartbeat;
+    }
 
     pthread_mutex_unlock(&mutex);
+
+    // Leadership changed, drop pooled connections to the previous leader
+    for (std::vector<std::string>::iterator jt = stale.begin();
+            jt != stale.end(); ++jt)
+    {
+        Client::close_connections(*jt);
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool RaftManager::leader_alive()
+{
+    struct timespec the_time;
+
+    bool alive;
+
+    clock_gettime(CLOCK_MONOTONIC, &the_time);
+
+    pthread_mutex_lock(&mutex);
+
+    if ( state == LEADER )
+    {
+        alive = true;
+    }
+    else
+    {
+        time_t sec  = leader_heartbeat.tv_sec + election_timeout.tv_sec;
+        long   nsec = leader_heartbeat.tv_nsec + election_timeout.tv_nsec;
+
+        if ( nsec >= 1000000000 )
+        {
+            sec  += 1;
+            nsec -= 1000000000;
+        }
+
+        alive = (sec > the_time.tv_sec) || (sec == the_time.tv_sec &&
+                nsec > the_time.tv_nsec);
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return alive;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -669,13 +848,19 @@ unsigned int RaftManager::update_commit(unsigned int leader_commit,
 
     if ( leader_commit > commit )
     {
-        if ( index < leader_commit )
-        {
-            commit = index;
-        }
-        else
+        // The leader commits the last record of a federated batch, use the
+        // last leader commit included in the log
+        std::set<unsigned int>::iterator it;
+
+        leader_commits.insert(leader_commit);
+
+        it = leader_commits.upper_bound(index);
+
+        if ( it != leader_commits.begin() )
         {
-            commit = leader_commit;
+            commit = *(--it);
+
+            leader_commits.erase(leader_commits.begin(), ++it);
         }
     }
 
@@ -752,7 +937,7 @@ void RaftManager::timer_action(const ActionRequest& ar)
 	// Leadership
 	struct timespec the_time;
 
-	clock_gettime(CLOCK_REALTIME, &the_time);
+	clock_gettime(CLOCK_MONOTONIC, &the_time);
 
 	pthread_mutex_lock(&mutex);
 
@@ -767,7 +952,7 @@ void RaftManager::timer_action(const ActionRequest& ar)
 		{
 			heartbeat_manager.replicate();
 
-            clock_gettime(CLOCK_REALTIME, &last_heartbeat);
+            clock_gettime(CLOCK_MONOTONIC, &last_heartbeat);
 
             pthread_mutex_unlock(&mutex);
 		}
@@ -1030,7 +1215,8 @@ int RaftManager::xmlrpc_replicate_log(int follower_id, LogDBRecord * lr,
     replica_params.add(xmlrpc_c::value_int(lr->prev_index));
     replica_params.add(xmlrpc_c::value_int(lr->prev_term));
     replica_params.add(xmlrpc_c::value_int(lr->fed_index));
-    replica_params.add(xmlrpc_c::value_string(lr->sql));
+    replica_params.add(xmlrpc_c::value_bytestring(
+                std::vector<unsigned char>(lr->zsql.begin(), lr->zsql.end())));
 
     // -------------------------------------------------------------------------
     // Do the XML-RPC call
@@ -1163,6 +1349,55 @@ int RaftManager::xmlrpc_request_vote(int follower_id, unsigned int lindex,
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+int RaftManager::xmlrpc_read_index(unsigned int& index, std::string& error)
+{
+    static const std::string read_index_method = "one.zone.readindex";
+
+    std::string secret;
+    std::string leader_edp;
+
+    if ( get_leader_endpoint(leader_edp) != 0 )
+    {
+        error = "Cannot find leader end point";
+        return -1;
+    }
+
+    if ( Client::read_oneauth(secret, error) == -1 )
+    {
+        return -1;
+    }
+
+    xmlrpc_c::value result;
+    xmlrpc_c::paramList read_params;
+
+    read_params.add(xmlrpc_c::value_string(secret));
+
+    int xml_rc = Client::call(leader_edp, read_index_method, read_params,
+            xmlrpc_timeout_ms, &result, error);
+
+    if ( xml_rc != 0 )
+    {
+        return -1;
+    }
+
+    vector<xmlrpc_c::value> values;
+
+    values = xmlrpc_c::value_array(result).vectorValueValue();
+
+    if ( !xmlrpc_c::value_boolean(values[0]) )
+    {
+        error = xmlrpc_c::value_string(values[1]);
+        return -1;
+    }
+
+    index = xmlrpc_c::value_int(values[1]);
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 std::string& RaftManager::to_xml(std::string& raft_xml)
 {
     Nebula& nd    = Nebula::instance();
@@ -1172,8 +1407,15 @@ std::string& RaftManager::to_xml(std::string& raft_xml)
 
     std::ostringstream oss;
 
+    std::string fed_xml;
+
     logdb->get_last_record_index(lindex, lterm);
 
+    if ( nd.is_federation_master() )
+    {
+        nd.get_frm()->to_xml(fed_xml);
+    }
+
 	pthread_mutex_lock(&mutex);
 
     oss << "<RAFT>"
@@ -1203,7 +1445,7 @@ std::string& RaftManager::to_xml(std::string& raft_xml)
         oss << "<FEDLOG_INDEX>-1</FEDLOG_INDEX>";
     }
 
-    oss << "</RAFT>";
+    oss << fed_xml << "</RAFT>";
 
 	pthread_mutex_unlock(&mutex);
 
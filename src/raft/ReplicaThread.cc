@@ -258,7 +258,7 @@ int FedReplicaThread::replicate()
 
     if ( success )
     {
-        frm->replicate_success(follower_id);
+        frm->replicate_success(follower_id, last);
     }
     else
     {
@@ -301,13 +301,23 @@ int HeartBeatThread::replicate()
 	lr.term = 0;
 	lr.prev_term = 0;
 
-	lr.sql = "";
+	lr.sql  = "";
+	lr.zsql = "";
 
 	lr.timestamp = 0;
     lr.fed_index = -1;
 
+    struct timespec sent;
+
+    clock_gettime(CLOCK_MONOTONIC, &sent);
+
     rc = raftm->xmlrpc_replicate_log(follower_id, &lr, success, fterm, error);
 
+    if ( rc == 0 && success )
+    {
+        raftm->heartbeat_success(follower_id, sent);
+    }
+
     if ( rc == -1 )
     {
         num_errors++;
@@ -298,7 +298,23 @@ void Request::execute(
         return;
     }
 
-    if ( raftm->is_follower() && leader_only)
+    bool forward = leader_only;
+
+    if ( raftm->is_follower() && read_only &&
+            raftm->linearizable_reads_enabled() )
+    {
+        string error;
+
+        if ( raftm->read_barrier(error) != 0 )
+        {
+            NebulaLog::log("ReM", Log::DEBUG, "Forwarding read request to "
+                    "leader: " + error);
+
+            forward = true;
+        }
+    }
+
+    if ( raftm->is_follower() && forward )
     {
         string leader_endpoint, error;
 
@@ -363,6 +379,51 @@ bool Request::basic_authorization(int oid,
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+bool Request::monitoring_range(xmlrpc_c::paramList const& paramList,
+        unsigned int index, MonitoringStore::Resolution& res,
+        time_t& start_time, time_t& end_time, RequestAttributes& att)
+{
+    int seconds = 0;
+
+    res        = MonitoringStore::RAW;
+    start_time = -1;
+    end_time   = -1;
+
+    if ( paramList.size() > index )
+    {
+        start_time = xmlrpc_c::value_int(paramList.getInt(index));
+    }
+
+    if ( paramList.size() > index + 1 )
+    {
+        end_time = xmlrpc_c::value_int(paramList.getInt(index + 1));
+    }
+
+    if ( paramList.size() > index + 2 )
+    {
+        seconds = xmlrpc_c::value_int(paramList.getInt(index + 2));
+    }
+
+    if ( MonitoringStore::resolution(seconds, res) != 0 )
+    {
+        att.resp_msg = "Incorrect resolution, it must be 0, 60 or 3600";
+        failure_response(XML_RPC_API, att);
+        return false;
+    }
+
+    if ( start_time != -1 && end_time != -1 && end_time < start_time )
+    {
+        att.resp_msg = "Incorrect time range";
+        failure_response(XML_RPC_API, att);
+        return false;
+    }
+
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 Request::ErrorCode Request::basic_authorization(
         PoolSQL*                pool,
         int                     oid,
@@ -446,6 +446,7 @@ void RequestManager::register_xml_methods()
     // System Methods
     xmlrpc_c::methodPtr system_version(new SystemVersion());
     xmlrpc_c::methodPtr system_config(new SystemConfig());
+    xmlrpc_c::methodPtr system_queues(new SystemQueues());
     xmlrpc_c::methodPtr system_sql(new SystemSql());
     xmlrpc_c::methodPtr system_sqlquery(new SystemSqlQuery());
 
@@ -790,6 +791,7 @@ void RequestManager::register_xml_methods()
     xmlrpc_c::methodPtr zone_replicatelog(new ZoneReplicateLog());
     xmlrpc_c::methodPtr zone_voterequest(new ZoneVoteRequest());
     xmlrpc_c::methodPtr zone_raftstatus(new ZoneRaftStatus());
+    xmlrpc_c::methodPtr zone_readindex(new ZoneReadIndex());
     xmlrpc_c::methodPtr zone_fedreplicatelog(new ZoneReplicateFedLog());
 
     xmlrpc_c::methodPtr zone_info(new ZoneInfo());
@@ -804,6 +806,7 @@ void RequestManager::register_xml_methods()
     RequestManagerRegistry.addMethod("one.zone.fedreplicate",zone_fedreplicatelog);
     RequestManagerRegistry.addMethod("one.zone.voterequest",zone_voterequest);
     RequestManagerRegistry.addMethod("one.zone.raftstatus", zone_raftstatus);
+    RequestManagerRegistry.addMethod("one.zone.readindex", zone_readindex);
 
     RequestManagerRegistry.addMethod("one.zone.addserver", zone_addserver);
     RequestManagerRegistry.addMethod("one.zone.delserver", zone_delserver);
@@ -1065,6 +1068,7 @@ void RequestManager::register_xml_methods()
     /* System related methods */
     RequestManagerRegistry.addMethod("one.system.version", system_version);
     RequestManagerRegistry.addMethod("one.system.config", system_config);
+    RequestManagerRegistry.addMethod("one.system.queues", system_queues);
     RequestManagerRegistry.addMethod("one.system.sql", system_sql);
     RequestManagerRegistry.addMethod("one.system.sqlquery", system_sqlquery);
 };
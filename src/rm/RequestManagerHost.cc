@@ -81,12 +81,22 @@ void HostMonitoring::request_execute(
 
     ostringstream oss;
 
+    MonitoringStore::Resolution res;
+    time_t                      start_time;
+    time_t                      end_time;
+
+    if (!monitoring_range(paramList, 2, res, start_time, end_time, att))
+    {
+        return;
+    }
+
     if ( basic_authorization(id, att) == false )
     {
         return;
     }
 
-    rc = (static_cast<HostPool *>(pool))->dump_monitoring(oss, id);
+    rc = (static_cast<HostPool *>(pool))->dump_monitoring(oss, id, res,
+            start_time, end_time);
 
     if ( rc != 0 )
     {
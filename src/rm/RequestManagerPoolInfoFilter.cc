@@ -220,6 +220,10 @@ void VirtualMachinePoolMonitoring::request_execute(
     string        where;
     int           rc;
 
+    MonitoringStore::Resolution res;
+    time_t                      start_time;
+    time_t                      end_time;
+
     if ( filter_flag < GROUP )
     {
         att.resp_msg = "Incorrect filter_flag";
@@ -227,9 +231,15 @@ void VirtualMachinePoolMonitoring::request_execute(
         return;
     }
 
+    if (!monitoring_range(paramList, 2, res, start_time, end_time, att))
+    {
+        return;
+    }
+
     where_filter(att, filter_flag, -1, -1, "", "", false, false, false, where);
 
-    rc = (static_cast<VirtualMachinePool *>(pool))->dump_monitoring(oss, where);
+    rc = (static_cast<VirtualMachinePool *>(pool))->dump_monitoring(oss, where,
+            res, start_time, end_time);
 
     if ( rc != 0 )
     {
@@ -264,9 +274,19 @@ void HostPoolMonitoring::request_execute(
     string        where;
     int           rc;
 
+    MonitoringStore::Resolution res;
+    time_t                      start_time;
+    time_t                      end_time;
+
+    if (!monitoring_range(paramList, 1, res, start_time, end_time, att))
+    {
+        return;
+    }
+
     where_filter(att, ALL, -1, -1, "", "", false, false, false, where);
 
-    rc = (static_cast<HostPool *>(pool))->dump_monitoring(oss, where);
+    rc = (static_cast<HostPool *>(pool))->dump_monitoring(oss, where, res,
+            start_time, end_time);
 
     if ( rc != 0 )
     {
@@ -52,6 +52,53 @@ void SystemConfig::request_execute(xmlrpc_c::paramList const& paramList,
 /* ------------------------------------------------------------------------- */
 /* ------------------------------------------------------------------------- */
 
+void SystemQueues::request_execute(xmlrpc_c::paramList const& paramList,
+                                 RequestAttributes& att)
+{
+    Nebula& nd = Nebula::instance();
+
+    ostringstream oss;
+
+    if ( att.gid != GroupPool::ONEADMIN_ID )
+    {
+        att.resp_msg = "The queue statistics can only be retrieved by users "
+            "in the oneadmin group";
+        failure_response(AUTHORIZATION, att);
+        return;
+    }
+
+    oss << "<QUEUES>";
+
+    oss << "<QUEUE><NAME>LCM</NAME>";
+    nd.get_lcm()->queue_to_xml(oss);
+    oss << "</QUEUE>";
+
+    oss << "<QUEUE><NAME>DM</NAME>";
+    nd.get_dm()->queue_to_xml(oss);
+    oss << "</QUEUE>";
+
+    oss << "<QUEUE><NAME>TM</NAME>";
+    nd.get_tm()->queue_to_xml(oss);
+    oss << "</QUEUE>";
+
+    oss << "<QUEUE><NAME>VMM</NAME>";
+    nd.get_vmm()->queue_to_xml(oss);
+    oss << "</QUEUE>";
+
+    oss << "<QUEUE><NAME>MONITOR</NAME>";
+    nd.get_im()->queue_to_xml(oss);
+    oss << "</QUEUE>";
+
+    oss << "</QUEUES>";
+
+    success_response(oss.str(), att);
+
+    return;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ------------------------------------------------------------------------- */
+
 void SystemSql::request_execute(xmlrpc_c::paramList const& paramList,
                                  RequestAttributes& att)
 {
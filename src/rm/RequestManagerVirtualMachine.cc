@@ -1587,6 +1587,15 @@ void VirtualMachineMonitoring::request_execute(
 
     ostringstream oss;
 
+    MonitoringStore::Resolution res;
+    time_t                      start_time;
+    time_t                      end_time;
+
+    if (!monitoring_range(paramList, 2, res, start_time, end_time, att))
+    {
+        return;
+    }
+
     bool auth = vm_authorization(id, 0, 0, att, 0, 0, 0, auth_op);
 
     if ( auth == false )
@@ -1594,7 +1603,8 @@ void VirtualMachineMonitoring::request_execute(
         return;
     }
 
-    rc = (static_cast<VirtualMachinePool *>(pool))->dump_monitoring(oss, id);
+    rc = (static_cast<VirtualMachinePool *>(pool))->dump_monitoring(oss, id,
+            res, start_time, end_time);
 
     if ( rc != 0 )
     {
@@ -275,7 +275,9 @@ void ZoneReplicateLog::request_execute(xmlrpc_c::paramList const& paramList,
     unsigned int prev_term  = xmlrpc_c::value_int(paramList.getInt(7));
     unsigned int fed_index  = xmlrpc_c::value_int(paramList.getInt(8));
 
-    string sql = xmlrpc_c::value_string(paramList.getString(9));
+    std::vector<unsigned char> zsql_v = paramList.getBytestring(9);
+
+    std::string zsql(zsql_v.begin(), zsql_v.end());
 
     unsigned int current_term = raftm->get_term();
 
@@ -327,7 +329,7 @@ void ZoneReplicateLog::request_execute(xmlrpc_c::paramList const& paramList,
     // HEARTBEAT
     //--------------------------------------------------------------------------
     if ( index == 0 && prev_index == 0 && term == 0 && prev_term == 0 &&
-         sql.empty() )
+         zsql.empty() )
     {
         unsigned int lindex, lterm;
 
@@ -348,7 +350,7 @@ void ZoneReplicateLog::request_execute(xmlrpc_c::paramList const& paramList,
     //   2. Insert record in the log
     //   3. Apply log records that can be safely applied
     //--------------------------------------------------------------------------
-    if ( sql.empty() )
+    if ( zsql.empty() )
     {
         att.resp_msg = "Empty SQL command in log record";
         att.resp_id  = current_term;
@@ -391,9 +393,7 @@ void ZoneReplicateLog::request_execute(xmlrpc_c::paramList const& paramList,
         }
     }
 
-    ostringstream sql_oss(sql);
-
-    if ( logdb->insert_log_record(index, term, sql_oss, 0, fed_index) != 0 )
+    if ( logdb->insert_log_record(index, term, zsql, 0, fed_index) != 0 )
     {
         att.resp_msg = "Error writing log record";
         att.resp_id  = current_term;
@@ -448,7 +448,19 @@ void ZoneVoteRequest::request_execute(xmlrpc_c::paramList const& paramList,
         failure_response(ACTION, att);
         return;
     }
-    else if ( candidate_term > current_term  )
+
+    // A live leader may be serving reads under its lease, the vote is not
+    // granted (and the term not updated) until it times out
+    if ( raftm->leader_alive() )
+    {
+        att.resp_msg = "Zone has a live leader";
+        att.resp_id  = current_term;
+
+        failure_response(ACTION, att);
+        return;
+    }
+
+    if ( candidate_term > current_term  )
     {
         std::ostringstream oss;
 
@@ -509,6 +521,35 @@ void ZoneRaftStatus::request_execute(xmlrpc_c::paramList const& paramList,
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+void ZoneReadIndex::request_execute(xmlrpc_c::paramList const& paramList,
+    RequestAttributes& att)
+{
+    Nebula& nd = Nebula::instance();
+
+    RaftManager * raftm = nd.get_raftm();
+
+    unsigned int index;
+
+    if ( att.uid != 0 )
+    {
+        failure_response(AUTHORIZATION, att);
+        return;
+    }
+
+    if ( raftm->get_read_index(index) != 0 )
+    {
+        att.resp_msg = "Not a leader or leader lease expired";
+
+        failure_response(ACTION, att);
+        return;
+    }
+
+    success_response(static_cast<int>(index), att);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 void ZoneReplicateFedLog::request_execute(xmlrpc_c::paramList const& paramList,
     RequestAttributes& att)
 {
@@ -518,9 +559,12 @@ void ZoneReplicateFedLog::request_execute(xmlrpc_c::paramList const& paramList,
 
     FedReplicaManager * frm = nd.get_frm();
 
-    int index  = xmlrpc_c::value_int(paramList.getInt(1));
-    int prev   = xmlrpc_c::value_int(paramList.getInt(2));
-    string sql = xmlrpc_c::value_string(paramList.getString(3));
+    int prev = xmlrpc_c::value_int(paramList.getInt(1));
+
+    std::vector<xmlrpc_c::value> xml_records = paramList.getArray(2);
+    std::vector<xmlrpc_c::value>::iterator it;
+
+    std::map<int, std::string> records;
 
     if ( att.uid != 0 )
     {
@@ -530,13 +574,36 @@ void ZoneReplicateFedLog::request_execute(xmlrpc_c::paramList const& paramList,
         return;
     }
 
-    if ( sql.empty() )
+    for ( it = xml_records.begin(); it != xml_records.end(); ++it )
     {
-        oss << "Received an empty SQL command at index" << index;
+        std::vector<xmlrpc_c::value> xml_record =
+            xmlrpc_c::value_array(*it).vectorValueValue();
 
-        NebulaLog::log("ReM", Log::ERROR, oss);
+        int index = xmlrpc_c::value_int(xml_record[0]);
 
-        att.resp_msg = oss.str();
+        std::vector<unsigned char> zsql =
+            xmlrpc_c::value_bytestring(xml_record[1]).vectorUcharValue();
+
+        if ( zsql.empty() )
+        {
+            oss << "Received an empty SQL command at index " << index;
+
+            NebulaLog::log("ReM", Log::ERROR, oss);
+
+            att.resp_msg = oss.str();
+            att.resp_id  = -1;
+
+            failure_response(ACTION, att);
+            return;
+        }
+
+        records.insert(std::make_pair(index,
+                    std::string(zsql.begin(), zsql.end())));
+    }
+
+    if ( records.empty() )
+    {
+        att.resp_msg = "Received an empty batch of log records";
         att.resp_id  = -1;
 
         failure_response(ACTION, att);
@@ -556,22 +623,26 @@ void ZoneReplicateFedLog::request_execute(xmlrpc_c::paramList const& paramList,
         return;
     }
 
-    int rc = frm->apply_log_record(index, prev, sql);
+    int last = records.rbegin()->first;
+
+    int rc = frm->apply_log_records(prev, records);
 
     if ( rc == 0 )
     {
-        success_response(index, att);
+        success_response(last, att);
     }
     else if ( rc < 0 )
     {
-        oss << "Error replicating log entry " << index << " in zone";
+        // The master sends the records one by one and skips the failing one
+        oss << "Error replicating log entries " << records.begin()->first
+            << " - " << last << " in zone";
 
         NebulaLog::log("ReM", Log::INFO, oss);
 
         att.resp_msg = oss.str();
-        att.resp_id  = index;
+        att.resp_id  = -1;
 
-        failure_response(ACTION, att);
+        failure_response(INTERNAL, att);
     }
     else // rc == last_index in log
     {
@@ -27,6 +27,8 @@ const char * LogDB::table = "logdb";
 
 const char * LogDB::db_names = "log_index, term, sqlcmd, timestamp, fed_index";
 
+const unsigned int LogDB::apply_batch_size = 100;
+
 const char * LogDB::db_bootstrap = "CREATE TABLE IF NOT EXISTS "
     "logdb (log_index INTEGER PRIMARY KEY, term INTEGER, sqlcmd MEDIUMTEXT, "
     "timestamp INTEGER, fed_index INTEGER)";
@@ -42,13 +44,11 @@ int LogDBRecord::select_cb(void *nil, int num, char **values, char **names)
         return -1;
     }
 
-    std::string zsql;
-
+    std::string * _zsql;
     std::string * _sql;
 
     index = static_cast<unsigned int>(atoi(values[0]));
     term  = static_cast<unsigned int>(atoi(values[1]));
-    zsql  = values[2];
 
     timestamp  = static_cast<unsigned int>(atoi(values[3]));
 
@@ -57,23 +57,38 @@ int LogDBRecord::select_cb(void *nil, int num, char **values, char **names)
     prev_index = static_cast<unsigned int>(atoi(values[5]));
     prev_term  = static_cast<unsigned int>(atoi(values[6]));
 
-    _sql = one_util::zlib_decompress(zsql, true);
+    _zsql = one_util::base64_decode(values[2]);
 
-    if ( _sql == 0 )
+    if ( _zsql == 0 )
     {
+        std::ostringstream oss;
+
+        oss << "Error decoding log record " << index << ", " << fed_index;
+
+        NebulaLog::log("DBM", Log::ERROR, oss);
+
+        return -1;
+    }
+
+    _sql = LogDB::decompress_sql(*_zsql);
 
+    if ( _sql == 0 )
+    {
         std::ostringstream oss;
 
-        oss << "Error zlib inflate for " << index << ", " << fed_index
-            << ", " << zsql;
+        oss << "Error zlib inflate for " << index << ", " << fed_index;
 
         NebulaLog::log("DBM", Log::ERROR, oss);
 
+        delete _zsql;
+
         return -1;
     }
 
-    sql = *_sql;
+    zsql = *_zsql;
+    sql  = *_sql;
 
+    delete _zsql;
     delete _sql;
 
     return 0;
@@ -82,14 +97,40 @@ int LogDBRecord::select_cb(void *nil, int num, char **values, char **names)
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+extern "C" void * logdb_apply_loop(void *arg)
+{
+    LogDB * logdb;
+
+    if ( arg == 0 )
+    {
+        return 0;
+    }
+
+    logdb = static_cast<LogDB *>(arg);
+
+    NebulaLog::log("DBM", Log::INFO, "LogDB applier started.");
+
+    logdb->apply_loop();
+
+    NebulaLog::log("DBM", Log::INFO, "LogDB applier stopped.");
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
 LogDB::LogDB(SqlDB * _db, bool _solo, unsigned int _lret):solo(_solo), db(_db),
     next_index(0), last_applied(-1), last_index(-1), last_term(-1),
-    log_retention(_lret)
+    log_retention(_lret), commit_index(0), apply_failed(false),
+    failed_index(0), apply_end(false)
 {
     int r, i;
 
     pthread_mutex_init(&mutex, 0);
 
+    pthread_cond_init(&apply_cond, 0);
+    pthread_cond_init(&applied_cond, 0);
+
     LogDBRecord lr;
 
     if ( get_log_record(0, lr) != 0 )
@@ -102,10 +143,38 @@ LogDB::LogDB(SqlDB * _db, bool _solo, unsigned int _lret):solo(_solo), db(_db),
     }
 
     setup_index(r, i);
+
+    if ( !solo )
+    {
+        pthread_attr_t pattr;
+
+        pthread_attr_init(&pattr);
+        pthread_attr_setdetachstate(&pattr, PTHREAD_CREATE_JOINABLE);
+
+        pthread_create(&apply_thread, &pattr, logdb_apply_loop, (void *) this);
+    }
 };
 
 LogDB::~LogDB()
 {
+    if ( !solo )
+    {
+        pthread_mutex_lock(&mutex);
+
+        apply_end = true;
+
+        pthread_cond_signal(&apply_cond);
+
+        pthread_mutex_unlock(&mutex);
+
+        pthread_join(apply_thread, 0);
+    }
+
+    pthread_cond_destroy(&apply_cond);
+    pthread_cond_destroy(&applied_cond);
+
+    pthread_mutex_destroy(&mutex);
+
     delete db;
 };
 
@@ -154,6 +223,11 @@ int LogDB::setup_index(int& _last_applied, int& _last_index)
     if ( rc == 0 )
     {
         last_applied = _last_applied;
+
+        if ( commit_index < last_applied )
+        {
+            commit_index = last_applied;
+        }
     }
 
     rc += get_log_record(last_index, lr);
@@ -275,33 +349,38 @@ int LogDB::update_raft_state(std::string& raft_xml)
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int LogDB::insert(int index, int term, const std::string& sql, time_t tstamp,
-        int fed_index)
+int LogDB::insert_sql(std::ostringstream& oss, int index, int term,
+        const std::string& zsql, time_t tstamp, int fed_index)
 {
-    std::ostringstream oss;
+    // base64 output has no quotes, it does not need to be escaped
+    std::string * zsql64 = one_util::base64_encode(zsql);
 
-    std::string * zsql;
-
-    zsql = one_util::zlib_compress(sql, true);
-
-    if ( zsql == 0 )
+    if ( zsql64 == 0 )
     {
         return -1;
     }
 
-    char * sql_db = db->escape_str(zsql->c_str());
+    oss << "INSERT INTO " << table << " ("<< db_names <<") VALUES ("
+        << index << "," << term << "," << "'" << *zsql64 << "'," << tstamp
+        << "," << fed_index << ")";
+
+    delete zsql64;
 
-    delete zsql;
+    return 0;
+}
 
-    if ( sql_db == 0 )
+/* -------------------------------------------------------------------------- */
+
+int LogDB::insert(int index, int term, const std::string& zsql, time_t tstamp,
+        int fed_index)
+{
+    std::ostringstream oss;
+
+    if ( insert_sql(oss, index, term, zsql, tstamp, fed_index) != 0 )
     {
         return -1;
     }
 
-    oss << "INSERT INTO " << table << " ("<< db_names <<") VALUES ("
-        << index << "," << term << "," << "'" << sql_db << "'," << tstamp
-        << "," << fed_index << ")";
-
     int rc = db->exec_wr(oss);
 
     if ( rc != 0 )
@@ -320,19 +399,17 @@ int LogDB::insert(int index, int term, const std::string& sql, time_t tstamp,
         }
     }
 
-    db->free_str(sql_db);
-
     return rc;
 }
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int LogDB::apply_log_record(LogDBRecord * lr)
+int LogDB::apply_log_record(unsigned int index, const std::string& sql)
 {
     ostringstream oss_sql;
 
-    oss_sql.str(lr->sql);
+    oss_sql.str(sql);
 
     int rc = db->exec_wr(oss_sql);
 
@@ -341,14 +418,12 @@ int LogDB::apply_log_record(LogDBRecord * lr)
         std::ostringstream oss;
 
         oss << "UPDATE logdb SET timestamp = " << time(0) << " WHERE "
-            << "log_index = " << lr->index << " AND timestamp = 0";
+            << "log_index = " << index << " AND timestamp = 0";
 
         if ( db->exec_wr(oss) != 0 )
         {
             NebulaLog::log("DBM", Log::ERROR, "Cannot update log record");
         }
-
-        last_applied = lr->index;
     }
 
     return rc;
@@ -359,6 +434,26 @@ int LogDB::apply_log_record(LogDBRecord * lr)
 
 int LogDB::insert_log_record(unsigned int term, std::ostringstream& sql,
         time_t timestamp, int fed_index)
+{
+    std::string * zsql = compress_sql(sql.str());
+
+    if ( zsql == 0 )
+    {
+        NebulaLog::log("DBM", Log::ERROR, "Cannot compress log record");
+        return -1;
+    }
+
+    int rc = insert_log_record(term, *zsql, timestamp, fed_index);
+
+    delete zsql;
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int LogDB::insert_log_record(unsigned int term, const std::string& zsql,
+        time_t timestamp, int fed_index)
 {
     pthread_mutex_lock(&mutex);
 
@@ -375,7 +470,7 @@ int LogDB::insert_log_record(unsigned int term, std::ostringstream& sql,
         _fed_index = fed_index;
     }
 
-    if ( insert(index, term, sql.str(), timestamp, _fed_index) != 0 )
+    if ( insert(index, term, zsql, timestamp, _fed_index) != 0 )
     {
         NebulaLog::log("DBM", Log::ERROR, "Cannot insert log record in DB");
 
@@ -400,17 +495,89 @@ int LogDB::insert_log_record(unsigned int term, std::ostringstream& sql,
     return index;
 }
 
+/* -------------------------------------------------------------------------- */
+
+int LogDB::insert_log_records(unsigned int term,
+        const std::map<int, std::string>& records, time_t timestamp)
+{
+    std::map<int, std::string>::const_iterator it;
+
+    std::vector<std::string> cmds;
+
+    pthread_mutex_lock(&mutex);
+
+    unsigned int index = next_index;
+
+    for ( it = records.begin(); it != records.end(); ++it, ++index )
+    {
+        std::ostringstream oss;
+
+        if (insert_sql(oss, index, term, it->second, timestamp, it->first)!=0)
+        {
+            pthread_mutex_unlock(&mutex);
+            return -1;
+        }
+
+        cmds.push_back(oss.str());
+    }
+
+    if ( db->exec_local_trx(cmds) != 0 )
+    {
+        NebulaLog::log("DBM", Log::ERROR, "Cannot insert log records in DB");
+
+        pthread_mutex_unlock(&mutex);
+
+        return -1;
+    }
+
+    last_index = index - 1;
+
+    last_term  = term;
+
+    next_index = index;
+
+    for ( it = records.begin(); it != records.end(); ++it )
+    {
+        fed_log.insert(it->first);
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return last_index;
+}
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
 int LogDB::insert_log_record(unsigned int index, unsigned int term,
         std::ostringstream& sql, time_t timestamp, int fed_index)
+{
+    std::string * zsql = compress_sql(sql.str());
+
+    if ( zsql == 0 )
+    {
+        NebulaLog::log("DBM", Log::ERROR, "Cannot compress log record");
+        return -1;
+    }
+
+    int rc = insert_log_record(index, term, *zsql, timestamp, fed_index);
+
+    delete zsql;
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int LogDB::insert_log_record(unsigned int index, unsigned int term,
+        const std::string& zsql, time_t timestamp, int fed_index)
 {
     int rc;
 
     pthread_mutex_lock(&mutex);
 
-    rc = insert(index, term, sql.str(), timestamp, fed_index);
+    rc = insert(index, term, zsql, timestamp, fed_index);
 
     if ( rc == 0 )
     {
@@ -488,7 +655,9 @@ int LogDB::_exec_wr(ostringstream& cmd, int federated_index)
     }
     else if ( rr.result == true ) //Record replicated on majority of followers
     {
-		rc = apply_log_records(rindex);
+        apply_log_records(rindex);
+
+        rc = wait_log_record(rindex);
     }
     else
     {
@@ -507,6 +676,98 @@ int LogDB::_exec_wr(ostringstream& cmd, int federated_index)
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
+int LogDB::exec_federated_wr(const std::map<int, std::string>& records)
+{
+    std::map<int, std::string>::const_iterator it;
+
+    RaftManager * raftm = Nebula::instance().get_raftm();
+
+    if ( records.empty() )
+    {
+        return 0;
+    }
+
+    // -------------------------------------------------------------------------
+    // OpenNebula was started in solo mode, apply the batch in a transaction
+    // -------------------------------------------------------------------------
+    if ( solo )
+    {
+        std::vector<std::string> cmds;
+
+        for ( it = records.begin(); it != records.end(); ++it )
+        {
+            std::string * sql = decompress_sql(it->second);
+
+            if ( sql == 0 )
+            {
+                NebulaLog::log("DBM", Log::ERROR, "Cannot decompress "
+                        "federated log record");
+                return -1;
+            }
+
+            cmds.push_back(*sql);
+
+            delete sql;
+        }
+
+        if ( db->exec_local_trx(cmds) != 0 )
+        {
+            return -1;
+        }
+
+        insert_log_records(0, records, time(0));
+
+        return 0;
+    }
+    else if ( raftm == 0 || !raftm->is_leader() )
+    {
+        NebulaLog::log("DBM", Log::ERROR,"Tried to modify DB being a follower");
+        return -1;
+    }
+
+    // -------------------------------------------------------------------------
+    // Insert the log entries and replicate them on followers. The entries are
+    // consecutive and only the last one is committed, so the applier thread
+    // applies the batch in a single transaction.
+    // -------------------------------------------------------------------------
+    int rindex = insert_log_records(raftm->get_term(), records, 0);
+
+    if ( rindex == -1 )
+    {
+        return -1;
+    }
+
+    ReplicaRequest rr(rindex);
+
+    raftm->replicate_log(&rr);
+
+    rr.wait();
+
+    if ( !raftm->is_leader() )
+    {
+        NebulaLog::log("DBM", Log::ERROR, "Not applying log record, oned is"
+                " now a follower");
+        return -1;
+    }
+    else if ( rr.result == false )
+    {
+        std::ostringstream oss;
+
+        oss << "Cannot replicate log record on followers: " << rr.message;
+
+        NebulaLog::log("DBM", Log::ERROR, oss);
+
+        return -1;
+    }
+
+    apply_log_records(rindex);
+
+    return wait_log_record(rindex);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
 int LogDB::delete_log_records(unsigned int start_index)
 {
     std::ostringstream oss;
@@ -540,30 +801,235 @@ int LogDB::delete_log_records(unsigned int start_index)
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int LogDB::apply_log_records(unsigned int commit_index)
+int LogDB::apply_log_records(unsigned int _commit_index)
 {
     pthread_mutex_lock(&mutex);
 
-	while (last_applied < commit_index )
-	{
-    	LogDBRecord lr;
+    if ( _commit_index > commit_index )
+    {
+        commit_index = _commit_index;
+    }
 
-		if ( get_log_record(last_applied + 1, lr) != 0 )
-		{
-            pthread_mutex_unlock(&mutex);
-			return -1;
-		}
+    // Retry failed records
+    apply_failed = false;
 
-		if ( apply_log_record(&lr) != 0 )
-		{
-            pthread_mutex_unlock(&mutex);
-			return -1;
-		}
-	}
+    if ( last_applied < commit_index )
+    {
+        pthread_cond_signal(&apply_cond);
+    }
 
     pthread_mutex_unlock(&mutex);
 
-	return 0;
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int LogDB::wait_log_record(unsigned int index, unsigned int timeout_ms)
+{
+    int rc = 0;
+
+    struct timespec timeout;
+
+    if ( timeout_ms != 0 )
+    {
+        clock_gettime(CLOCK_REALTIME, &timeout);
+
+        timeout.tv_sec  += timeout_ms / 1000;
+        timeout.tv_nsec += (timeout_ms % 1000) * 1000000;
+
+        if ( timeout.tv_nsec >= 1000000000 )
+        {
+            timeout.tv_sec  += 1;
+            timeout.tv_nsec -= 1000000000;
+        }
+    }
+
+    pthread_mutex_lock(&mutex);
+
+    while ( last_applied < index )
+    {
+        if ( apply_failed && failed_index <= index )
+        {
+            rc = -1;
+            break;
+        }
+
+        if ( timeout_ms == 0 )
+        {
+            pthread_cond_wait(&applied_cond, &mutex);
+        }
+        else if (pthread_cond_timedwait(&applied_cond,&mutex,&timeout)!=0)
+        {
+            rc = last_applied < index ? -1 : 0;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&mutex);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+void LogDB::apply_loop()
+{
+    pthread_mutex_lock(&mutex);
+
+    while (true)
+    {
+        while ( !apply_end && (apply_failed || last_applied >= commit_index) )
+        {
+            pthread_cond_wait(&apply_cond, &mutex);
+        }
+
+        if ( apply_end )
+        {
+            break;
+        }
+
+        unsigned int start = last_applied + 1;
+        unsigned int end   = commit_index;
+
+        if ( end - start >= apply_batch_size )
+        {
+            end = start + apply_batch_size - 1;
+        }
+
+        unsigned int commit = commit_index;
+
+        pthread_mutex_unlock(&mutex);
+
+        unsigned int applied;
+
+        int rc = apply_log_records(start, end, commit, applied);
+
+        pthread_mutex_lock(&mutex);
+
+        if ( applied != start - 1 ) //At least one record applied
+        {
+            last_applied = applied;
+        }
+
+        if ( rc != 0 )
+        {
+            std::ostringstream oss;
+
+            oss << "Cannot apply log record " << applied + 1;
+
+            NebulaLog::log("DBM", Log::ERROR, oss);
+
+            apply_failed = true;
+            failed_index = applied + 1;
+        }
+
+        pthread_cond_broadcast(&applied_cond);
+    }
+
+    pthread_mutex_unlock(&mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int LogDB::apply_log_records(unsigned int start, unsigned int end,
+        unsigned int commit, unsigned int& applied)
+{
+    std::vector<std::string> cmds;
+    std::vector<bool>        federated;
+
+    std::ostringstream oss;
+
+    applied = start - 1;
+
+    for (unsigned int i = start; i <= commit; ++i)
+    {
+        LogDBRecord lr;
+
+        bool fed;
+
+        if ( get_log_record(i, lr) != 0 )
+        {
+            if ( i == start )
+            {
+                return -1;
+            }
+
+            break;
+        }
+
+        fed = lr.fed_index != -1;
+
+        // Do not split a run of federated records (a federated batch)
+        if ( i > end && !(fed && federated.back()) )
+        {
+            break;
+        }
+
+        cmds.push_back(lr.sql);
+        federated.push_back(fed);
+    }
+
+    end = start + cmds.size() - 1;
+
+    oss << "UPDATE logdb SET timestamp = " << time(0) << " WHERE log_index >= "
+        << start << " AND log_index <= " << end << " AND timestamp = 0";
+
+    cmds.push_back(oss.str());
+
+    if ( db->exec_local_trx(cmds) == 0 )
+    {
+        applied = end;
+        return 0;
+    }
+
+    // Some commands cannot be run within a transaction (e.g. they open their
+    // own transaction), apply the records one by one. Federated runs are
+    // applied in their own transaction.
+    for (unsigned int i = start; i <= end; ++i)
+    {
+        if ( !federated[i - start] )
+        {
+            if ( apply_log_record(i, cmds[i - start]) != 0 )
+            {
+                return -1;
+            }
+
+            applied = i;
+
+            continue;
+        }
+
+        std::vector<std::string> fed_cmds;
+        std::ostringstream       fed_oss;
+
+        unsigned int fed_start = i;
+
+        for (; i <= end && federated[i - start]; ++i)
+        {
+            fed_cmds.push_back(cmds[i - start]);
+        }
+
+        --i;
+
+        fed_oss << "UPDATE logdb SET timestamp = " << time(0)
+            << " WHERE log_index >= " << fed_start << " AND log_index <= " << i
+            << " AND timestamp = 0";
+
+        fed_cmds.push_back(fed_oss.str());
+
+        if ( db->exec_local_trx(fed_cmds) != 0 )
+        {
+            return -1;
+        }
+
+        applied = i;
+    }
+
+    return 0;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -690,6 +1156,19 @@ int LogDB::next_federated(int i)
     return findex;
 }
 
+/* -------------------------------------------------------------------------- */
+
+int LogDB::pending_federated(int i)
+{
+    pthread_mutex_lock(&mutex);
+
+    int pending = std::distance(fed_log.upper_bound(i), fed_log.end());
+
+    pthread_mutex_unlock(&mutex);
+
+    return pending;
+}
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
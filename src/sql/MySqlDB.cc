@@ -254,6 +254,45 @@ int MySqlDB::exec(ostringstream& cmd, Callbackable* obj, bool quiet)
 
 /* -------------------------------------------------------------------------- */
 
+int MySqlDB::exec_local_trx(const std::vector<std::string>& cmds)
+{
+    std::vector<std::string>::const_iterator it;
+
+    MYSQL * db = get_db_connection();
+
+    int rc = mysql_query(db, "START TRANSACTION");
+
+    for (it = cmds.begin(); it != cmds.end() && rc == 0; ++it)
+    {
+        rc = mysql_query(db, it->c_str());
+    }
+
+    if ( rc == 0 )
+    {
+        rc = mysql_query(db, "COMMIT");
+    }
+
+    if ( rc != 0 )
+    {
+        ostringstream oss;
+
+        oss << "SQL transaction rolled back, error " << mysql_errno(db)
+            << " : " << mysql_error(db);
+
+        mysql_query(db, "ROLLBACK");
+
+        NebulaLog::log("ONE", Log::ERROR, oss);
+
+        rc = -1;
+    }
+
+    free_db_connection(db);
+
+    return rc;
+}
+
+/* -------------------------------------------------------------------------- */
+
 char * MySqlDB::escape_str(const string& str)
 {
     char * result = new char[str.size()*2+1];
@@ -147,6 +147,56 @@ int SqliteDB::exec(ostringstream& cmd, Callbackable* obj, bool quiet)
 
 /* -------------------------------------------------------------------------- */
 
+int SqliteDB::exec_local_trx(const std::vector<std::string>& cmds)
+{
+    char * err_msg = 0;
+
+    std::vector<std::string>::const_iterator it;
+
+    lock();
+
+    int rc = sqlite3_exec(db, "BEGIN TRANSACTION", 0, 0, &err_msg);
+
+    for (it = cmds.begin(); it != cmds.end() && rc == SQLITE_OK; ++it)
+    {
+        rc = sqlite3_exec(db, it->c_str(), 0, 0, &err_msg);
+    }
+
+    if ( rc == SQLITE_OK )
+    {
+        rc = sqlite3_exec(db, "COMMIT", 0, 0, &err_msg);
+    }
+
+    if ( rc != SQLITE_OK )
+    {
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+    }
+
+    unlock();
+
+    if (rc != SQLITE_OK)
+    {
+        ostringstream oss;
+
+        oss << "SQL transaction rolled back, error: ";
+
+        if ( err_msg != 0 )
+        {
+            oss << err_msg;
+
+            sqlite3_free(err_msg);
+        }
+
+        NebulaLog::log("ONE", Log::ERROR, oss);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
 char * SqliteDB::escape_str(const string& str)
 {
     return sqlite3_mprintf("%q",str.c_str());
@@ -157,22 +157,16 @@ void History::non_persistent_data()
 int History::insert_replace(SqlDB *db, bool replace)
 {
     ostringstream   oss;
-
-    string xml_body;
-    char * sql_xml;
-
-    int    rc;
+    string          values;
 
     if (seq == -1)
     {
         return 0;
     }
 
-    sql_xml = db->escape_str(to_db_xml(xml_body).c_str());
-
-    if ( sql_xml == 0 )
+    if ( to_row(db, values) != 0 )
     {
-        goto error_body;
+        return -1;
     }
 
     if(replace)
@@ -184,21 +178,39 @@ int History::insert_replace(SqlDB *db, bool replace)
         oss << "INSERT";
     }
 
-    oss << " INTO " << table << " ("<< db_names <<") VALUES ("
+    oss << " INTO " << table << " ("<< db_names <<") VALUES " << values;
+
+    return db->exec_wr(oss);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int History::to_row(SqlDB *db, string& values)
+{
+    ostringstream   oss;
+
+    string xml_body;
+    char * sql_xml;
+
+    sql_xml = db->escape_str(to_db_xml(xml_body).c_str());
+
+    if ( sql_xml == 0 )
+    {
+        return -1;
+    }
+
+    oss << "("
         <<          oid             << ","
         <<          seq             << ","
         << "'" <<   sql_xml         << "',"
         <<          stime           << ","
         <<          etime           << ")";
 
-    rc = db->exec_wr(oss);
-
     db->free_str(sql_xml);
 
-    return rc;
+    values = oss.str();
 
-error_body:
-    return -1;
+    return 0;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -467,11 +467,9 @@ const char * VirtualMachine::db_bootstrap = "CREATE TABLE IF NOT EXISTS "
 
 const char * VirtualMachine::monit_table = "vm_monitoring";
 
-const char * VirtualMachine::monit_db_names = "vmid, last_poll, body";
-
 const char * VirtualMachine::monit_db_bootstrap = "CREATE TABLE IF NOT EXISTS "
-    "vm_monitoring (vmid INTEGER, last_poll INTEGER, body MEDIUMTEXT, "
-    "PRIMARY KEY(vmid, last_poll))";
+    "vm_monitoring (vmid INTEGER, resolution INTEGER, start_time INTEGER, "
+    "end_time INTEGER, body MEDIUMTEXT, PRIMARY KEY(vmid, resolution, start_time))";
 
 
 const char * VirtualMachine::showback_table = "vm_showback";
@@ -1473,7 +1471,32 @@ int VirtualMachine::automatic_requirements(set<int>& cluster_ids,
 int VirtualMachine::insert_replace(SqlDB *db, bool replace, string& error_str)
 {
     ostringstream   oss;
-    int             rc;
+    string          values;
+
+    if ( to_row(db, values, error_str) != 0 )
+    {
+        return -1;
+    }
+
+    if(replace)
+    {
+        oss << "REPLACE";
+    }
+    else
+    {
+        oss << "INSERT";
+    }
+
+    oss << " INTO " << table << " ("<< db_names <<") VALUES " << values;
+
+    return db->exec_wr(oss);
+}
+
+/* -------------------------------------------------------------------------- */
+
+int VirtualMachine::to_row(SqlDB *db, string& values, string& error_str)
+{
+    ostringstream   oss;
 
     string xml_body;
     char * sql_name;
@@ -1498,16 +1521,7 @@ int VirtualMachine::insert_replace(SqlDB *db, bool replace, string& error_str)
         goto error_xml;
     }
 
-    if(replace)
-    {
-        oss << "REPLACE";
-    }
-    else
-    {
-        oss << "INSERT";
-    }
-
-    oss << " INTO " << table << " ("<< db_names <<") VALUES ("
+    oss << "("
         <<          oid             << ","
         << "'" <<   sql_name        << "',"
         << "'" <<   sql_xml         << "',"
@@ -1523,9 +1537,9 @@ int VirtualMachine::insert_replace(SqlDB *db, bool replace, string& error_str)
     db->free_str(sql_name);
     db->free_str(sql_xml);
 
-    rc = db->exec_wr(oss);
+    values = oss.str();
 
-    return rc;
+    return 0;
 
 error_xml:
     db->free_str(sql_name);
@@ -1548,73 +1562,18 @@ error_common:
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int VirtualMachine::update_monitoring(SqlDB * db)
+void VirtualMachine::monitoring_metrics(MonitoringStore::Metrics& metrics) const
 {
-    ostringstream oss;
-    int           rc;
+    string cpu;
+    string memory;
 
-    string xml_body;
-    string error_str;
-    char * sql_xml;
-
-    float       cpu = 0;
-    long long   memory = 0;
+    monitoring.metrics("MONITORING/", metrics);
 
     obj_template->get("CPU", cpu);
     obj_template->get("MEMORY", memory);
 
-    oss << "<VM>"
-        << "<ID>" << oid << "</ID>"
-        << "<LAST_POLL>" << last_poll << "</LAST_POLL>"
-        << monitoring.to_xml(xml_body)
-        << "<TEMPLATE>"
-        <<   "<CPU>"    << cpu << "</CPU>"
-        <<   "<MEMORY>" << memory << "</MEMORY>"
-        << "</TEMPLATE>"
-        << "</VM>";
-
-    sql_xml = db->escape_str(oss.str().c_str());
-
-    if ( sql_xml == 0 )
-    {
-        goto error_body;
-    }
-
-    if ( validate_xml(sql_xml) != 0 )
-    {
-        goto error_xml;
-    }
-
-    oss.str("");
-
-    oss << "REPLACE INTO " << monit_table << " ("<< monit_db_names <<") VALUES ("
-        <<          oid             << ","
-        <<          last_poll       << ","
-        << "'" <<   sql_xml         << "')";
-
-    db->free_str(sql_xml);
-
-    rc = db->exec_local_wr(oss);
-
-    return rc;
-
-error_xml:
-    db->free_str(sql_xml);
-
-    error_str = "could not transform the VM to XML.";
-
-    goto error_common;
-
-error_body:
-    error_str = "could not insert the VM in the DB.";
-
-error_common:
-    oss.str("");
-    oss << "Error updating VM monitoring information, " << error_str;
-
-    NebulaLog::log("ONE",Log::ERROR, oss);
-
-    return -1;
+    metrics["TEMPLATE/CPU"]    = cpu;
+    metrics["TEMPLATE/MEMORY"] = memory;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -2206,6 +2165,27 @@ int VirtualMachine::update_info(const string& monitor_data)
     return 0;
 };
 
+/* -------------------------------------------------------------------------- */
+
+int VirtualMachine::update_info(const VirtualMachineMonitorInfo& monitor_info)
+{
+    ostringstream oss;
+
+    last_poll = time(0);
+
+    monitoring.merge(&monitor_info);
+
+    set_vm_info();
+
+    clear_template_monitor_error();
+
+    oss << "VM " << oid << " successfully monitored.";
+
+    NebulaLog::log("VMM", Log::DEBUG, oss);
+
+    return 0;
+};
+
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
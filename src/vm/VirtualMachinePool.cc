@@ -43,15 +43,24 @@ VirtualMachinePool::VirtualMachinePool(
         const string&               remotes_location,
         vector<const SingleAttribute *>&  restricted_attrs,
         time_t                      expire_time,
+        time_t                      minute_expire_time,
+        time_t                      hour_expire_time,
         bool                        on_hold,
         float                       default_cpu_cost,
         float                       default_mem_cost,
         float                       default_disk_cost)
     : PoolSQL(db, VirtualMachine::table),
-    _monitor_expiration(expire_time), _submit_on_hold(on_hold),
+    _monitor_expiration(expire_time), monitoring(db, VirtualMachine::monit_table,
+    "vmid", VirtualMachine::table, "VM", "LAST_POLL", expire_time,
+    minute_expire_time, hour_expire_time), _submit_on_hold(on_hold),
     _default_cpu_cost(default_cpu_cost), _default_mem_cost(default_mem_cost),
     _default_disk_cost(default_disk_cost)
 {
+    // Deferred writes are not used in HA, rows are replicated when updated
+    if ( Nebula::instance().get_server_id() == -1 )
+    {
+        batch = new UpdateBatch(db);
+    }
 
     string name;
     string on;
@@ -453,64 +462,124 @@ int VirtualMachinePool::dump_showback(ostringstream& oss,
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int VirtualMachinePool::clean_expired_monitoring()
+int VirtualMachinePool::update_batch(VirtualMachine * vm, bool history)
 {
-    if ( _monitor_expiration == 0 )
+    string values;
+    string history_values;
+    string error;
+
+    int oid = vm->get_oid();
+
+    if ( batch == 0 )
+    {
+        if ( history && vm->history != 0 && vm->history->seq != -1 )
+        {
+            update_history(vm);
+        }
+
+        return update(vm);
+    }
+
+    if ( vm->to_row(db, values, error) != 0 )
+    {
+        return -1;
+    }
+
+    if ( history && vm->history != 0 && vm->history->seq != -1 )
+    {
+        if ( vm->history->to_row(db, history_values) != 0 )
+        {
+            return -1;
+        }
+
+        batch->add(History::table, History::db_names, oid, history_values);
+    }
+
+    batch->add(VirtualMachine::table, VirtualMachine::db_names, oid, values);
+
+    do_hooks(vm, Hook::UPDATE);
+
+    vm->set_prev_state();
+
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
+
+int VirtualMachinePool::update_last_poll(const vector<int>& oids,
+        time_t last_poll)
+{
+    ostringstream oss;
+
+    if ( oids.empty() )
     {
         return 0;
     }
 
-    time_t          max_last_poll;
-    int             rc;
-    ostringstream   oss;
+    // Pending rows of the VMs would set back last_poll when written
+    for (vector<int>::const_iterator it = oids.begin(); it != oids.end(); ++it)
+    {
+        flush_batch(*it);
+    }
 
-    max_last_poll = time(0) - _monitor_expiration;
+    oss << "UPDATE " << VirtualMachine::table << " SET last_poll = "
+        << last_poll << " WHERE last_poll < " << last_poll << " AND oid IN (";
+
+    for (vector<int>::const_iterator it = oids.begin(); it != oids.end(); ++it)
+    {
+        if ( it != oids.begin() )
+        {
+            oss << ",";
+        }
 
-    oss << "DELETE FROM " << VirtualMachine::monit_table
-        << " WHERE last_poll < " << max_last_poll;
+        oss << *it;
+    }
 
-    rc = db->exec_local_wr(oss);
+    oss << ")";
 
-    return rc;
+    return db->exec_wr(oss);
 }
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
-int VirtualMachinePool::clean_all_monitoring()
+void VirtualMachinePool::write_ended_monitoring()
 {
-    ostringstream   oss;
-    int             rc;
+    if ( _monitor_expiration == 0 )
+    {
+        return;
+    }
 
-    oss << "DELETE FROM " << VirtualMachine::monit_table;
+    monitoring.write_ended();
+}
 
-    rc = db->exec_local_wr(oss);
+/* -------------------------------------------------------------------------- */
+/* -------------------------------------------------------------------------- */
 
-    return rc;
+int VirtualMachinePool::clean_all_monitoring()
+{
+    return monitoring.clean_all();
 }
 
 /* -------------------------------------------------------------------------- */
 /* -------------------------------------------------------------------------- */
 
 int VirtualMachinePool::dump_monitoring(
-        ostringstream& oss,
-        const string&  where)
+        ostringstream&              oss,
+        const string&               where,
+        MonitoringStore::Resolution res,
+        time_t                      start_time,
+        time_t                      end_time)
 {
-    ostringstream cmd;
-
-    cmd << "SELECT " << VirtualMachine::monit_table << ".body FROM "
-        << VirtualMachine::monit_table
-        << " INNER JOIN " << VirtualMachine::table
-        << " WHERE vmid = oid";
+    vector<int> oids;
 
-    if ( !where.empty() )
+    if ( search(oids, where) != 0 )
     {
-        cmd << " AND " << where;
+        return -1;
     }
 
-    cmd << " ORDER BY vmid, " << VirtualMachine::monit_table << ".last_poll;";
-
-    return PoolSQL::dump(oss, "MONITORING_DATA", cmd);
+    return monitoring.dump(oss, where, oids, res, start_time, end_time);
 }
 
 /* -------------------------------------------------------------------------- */
@@ -694,6 +763,8 @@ int VirtualMachinePool::calculate_showback(
         set_callback(static_cast<Callbackable::Callback>(&VirtualMachinePool::db_int_cb),
                      static_cast<void *>(&start_time));
 
+        flush_batch();
+
         oss << "SELECT MIN(stime) FROM " << History::table;
 
         rc = db->exec_rd(oss, this);
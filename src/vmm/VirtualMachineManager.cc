@@ -39,7 +39,8 @@ VirtualMachineManager::VirtualMachineManager(
         timer_period(_timer_period),
         poll_period(_poll_period),
         do_vm_poll(_do_vm_poll),
-        vm_limit(_vm_limit)
+        vm_limit(_vm_limit),
+        polled_vms(0)
 {
     Nebula& nd = Nebula::instance();
 
@@ -179,6 +180,51 @@ void VirtualMachineManager::user_action(const ActionRequest& ar)
             disk_resize_action(vid);
         break;
     }
+
+    if ( am.empty() )
+    {
+        flush_batches();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+void VirtualMachineManager::flush_batches()
+{
+    vector<const VirtualMachineManagerDriver *>::iterator it;
+
+    for ( it = drivers.begin(); it != drivers.end(); ++it )
+    {
+        (*it)->flush();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+long long VirtualMachineManager::poll_messages() const
+{
+    vector<const VirtualMachineManagerDriver *>::const_iterator it;
+
+    long long messages = 0;
+
+    for ( it = drivers.begin(); it != drivers.end(); ++it )
+    {
+        messages += (*it)->get_poll_messages();
+    }
+
+    return messages;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void VirtualMachineManager::queue_to_xml(ostringstream& oss)
+{
+    am.to_xml(oss);
+
+    oss << "<POLL>"
+        <<   "<VMS>" << polled_vms.load(std::memory_order_relaxed) << "</VMS>"
+        <<   "<MESSAGES>" << poll_messages() << "</MESSAGES>"
+        << "</POLL>";
 }
 
 /* ************************************************************************** */
@@ -288,7 +334,7 @@ string * VirtualMachineManager::format_message(
         << ds_tmpl
         << "</VMM_DRIVER_ACTION_DATA>";
 
-    return one_util::base64_encode(oss.str());
+    return new string(oss.str());
 }
 
 static int do_context_command(VirtualMachine * vm, const string& password,
@@ -1347,7 +1393,7 @@ void VirtualMachineManager::poll_action(
         vm->get_ds_id(),
         -1);
 
-    vmd->poll(vid, *drv_msg);
+    vmd->poll(vid, vm->get_hid(), vm->get_hostname(), *drv_msg);
 
     delete drv_msg;
 
@@ -1400,7 +1446,9 @@ void VirtualMachineManager::driver_cancel_action(
         goto error_driver;
     }
 
-    // Invoke driver method
+    // Invoke driver method, after any batched action for the VM
+    vmd->flush();
+
     vmd->driver_cancel(vid);
 
     vm->unlock();
@@ -1440,6 +1488,16 @@ void VirtualMachineManager::timer_action(const ActionRequest& ar)
     string   vm_tmpl;
     string * drv_msg;
 
+    // VMs grouped by driver and host, for drivers that support POLLHOST
+    typedef map<int, VirtualMachineManagerDriver::HostPoll> HostPolls;
+
+    map<const VirtualMachineManagerDriver *, HostPolls>           polls;
+    map<const VirtualMachineManagerDriver *, HostPolls>::iterator pit;
+    HostPolls::iterator                                           hit;
+
+    int       num_vms  = 0;
+    long long messages = 0;
+
     mark = mark + timer_period;
 
     if ( mark >= 600 )
@@ -1448,8 +1506,10 @@ void VirtualMachineManager::timer_action(const ActionRequest& ar)
         mark = 0;
     }
 
-    // Clear the expired monitoring records
-    vmpool->clean_expired_monitoring();
+    // Write the pending VM updates and the ended monitoring segments
+    vmpool->flush_updates();
+
+    vmpool->write_ended_monitoring();
 
     // Skip monitoring the first poll_period to allow the Host monitoring to
     // gather the VM info (or if it is disabled)
@@ -1466,6 +1526,8 @@ void VirtualMachineManager::timer_action(const ActionRequest& ar)
         return;
     }
 
+    messages = poll_messages();
+
     for ( it = oids.begin(); it != oids.end(); it++ )
     {
         vm = vmpool->get(*it,true);
@@ -1506,23 +1568,38 @@ void VirtualMachineManager::timer_action(const ActionRequest& ar)
             continue;
         }
 
-        drv_msg = format_message(
-            vm->get_hostname(),
-            "",
-            vm->get_deploy_id(),
-            "",
-            "",
-            "",
-            "",
-            "",
-            "",
-            vm->to_xml(vm_tmpl),
-            vm->get_ds_id(),
-            -1);
+        if ( vmd->poll_host_supported() )
+        {
+            VirtualMachineManagerDriver::HostPoll& hp =
+                polls[vmd][vm->get_hid()];
+
+            hp.host = vm->get_hostname();
 
-        vmd->poll(*it, *drv_msg);
+            hp.oids.push_back(*it);
+            hp.deploy_ids.push_back(vm->get_deploy_id());
+        }
+        else
+        {
+            drv_msg = format_message(
+                vm->get_hostname(),
+                "",
+                vm->get_deploy_id(),
+                "",
+                "",
+                "",
+                "",
+                "",
+                "",
+                vm->to_xml(vm_tmpl),
+                vm->get_ds_id(),
+                -1);
+
+            vmd->poll(*it, vm->get_hid(), vm->get_hostname(), *drv_msg);
+
+            delete drv_msg;
+        }
 
-        delete drv_msg;
+        num_vms++;
 
         vm->set_last_poll(thetime);
 
@@ -1530,6 +1607,32 @@ void VirtualMachineManager::timer_action(const ActionRequest& ar)
 
         vm->unlock();
     }
+
+    flush_batches();
+
+    // Send a single poll request for the VMs of each host
+    for ( pit = polls.begin(); pit != polls.end(); ++pit )
+    {
+        for ( hit = pit->second.begin(); hit != pit->second.end(); ++hit )
+        {
+            pit->first->poll_host(hit->first, hit->second);
+        }
+    }
+
+    polled_vms.fetch_add(num_vms, std::memory_order_relaxed);
+
+    if ( num_vms > 0 )
+    {
+        // POLLHOST and BATCH messages count once, not once per VM
+        messages = poll_messages() - messages;
+
+        os.str("");
+
+        os << "VM poll cycle: " << num_vms << " VMs, " << messages
+           << " remote invocations.";
+
+        NebulaLog::log("VMM", Log::INFO, os);
+    }
 }
 
 /* -------------------------------------------------------------------------- */
@@ -2327,7 +2430,7 @@ void VirtualMachineManager::attach_nic_action(
         vm->get_ds_id(),
         -1);
 
-    vmd->attach_nic(vid, *drv_msg);
+    vmd->attach_nic(vid, vm->get_hid(), vm->get_hostname(), *drv_msg);
 
     delete drv_msg;
 
@@ -2413,7 +2516,7 @@ void VirtualMachineManager::detach_nic_action(
         vm->get_ds_id(),
         -1);
 
-    vmd->detach_nic(vid, *drv_msg);
+    vmd->detach_nic(vid, vm->get_hid(), vm->get_hostname(), *drv_msg);
 
     delete drv_msg;
 
@@ -2550,6 +2653,8 @@ int VirtualMachineManager::load_mads(int uid)
 
         if ( rc == 0 )
         {
+            drivers.push_back(vmm_driver);
+
             oss.str("");
             oss << "\tDriver " << name << " loaded.";
 
@@ -21,6 +21,7 @@
 #include "Nebula.h"
 #include "NebulaUtil.h"
 #include <sstream>
+#include <string.h>
 
 
 const string VirtualMachineManagerDriver::imported_actions_default =
@@ -39,7 +40,7 @@ VirtualMachineManagerDriver::VirtualMachineManagerDriver(
     bool                        sudo,
     VirtualMachinePool *        pool):
         Mad(userid,attrs,sudo), driver_conf(true), keep_snapshots(false),
-        vmpool(pool)
+        vmpool(pool), poll_messages(0)
 {
     map<string,string>::const_iterator  it;
     char *          error_msg = 0;
@@ -48,6 +49,8 @@ VirtualMachineManagerDriver::VirtualMachineManagerDriver(
     int             rc;
     string          action_defaults;
 
+    pthread_mutex_init(&batch_mutex, 0);
+
     it = attrs.find("DEFAULT");
 
     if ( it != attrs.end() )
@@ -712,10 +715,7 @@ void VirtualMachineManagerDriver::process_poll(
 {
     char state;
 
-    Nebula &ne = Nebula::instance();
-
-    LifeCycleManager* lcm      = ne.get_lcm();
-    VirtualMachinePool* vmpool = ne.get_vmpool();
+    VirtualMachinePool* vmpool = Nebula::instance().get_vmpool();
 
     /* ---------------------------------------------------------------------- */
     /* Update VM info only for VMs in ACTIVE                                  */
@@ -729,12 +729,10 @@ void VirtualMachineManagerDriver::process_poll(
         {
             if ( rc == 0)
             {
-                vmpool->update_history(vm);
-
                 vmpool->update_monitoring(vm);
             }
 
-            vmpool->update(vm);
+            vmpool->update_batch(vm, rc == 0);
         }
 
         VirtualMachineMonitorInfo &minfo = vm->get_info();
@@ -761,6 +759,47 @@ void VirtualMachineManagerDriver::process_poll(
         state = minfo.remove_state();
     }
 
+    process_state(vm, state);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void VirtualMachineManagerDriver::process_poll(
+        VirtualMachine*             vm,
+        VirtualMachineMonitorInfo&  monitor_info,
+        bool                        update_db)
+{
+    char state;
+
+    VirtualMachinePool* vmpool = Nebula::instance().get_vmpool();
+
+    if (vm->get_state() == VirtualMachine::ACTIVE)
+    {
+        vm->update_info(monitor_info);
+
+        if ( update_db )
+        {
+            vmpool->update_monitoring(vm);
+
+            vmpool->update_batch(vm, true);
+        }
+
+        state = vm->get_info().remove_state();
+    }
+    else
+    {
+        state = monitor_info.remove_state();
+    }
+
+    process_state(vm, state);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void VirtualMachineManagerDriver::process_state(VirtualMachine* vm, char state)
+{
+    LifeCycleManager* lcm = Nebula::instance().get_lcm();
+
     /* ---------------------------------------------------------------------- */
     /* Process the VM state from the monitoring info                          */
     /* ---------------------------------------------------------------------- */
@@ -830,3 +869,150 @@ void VirtualMachineManagerDriver::recover()
 {
     NebulaLog::log("VMM",Log::INFO,"Recovering VMM drivers");
 }
+
+/* ************************************************************************** */
+/* Host polling                                                               */
+/* ************************************************************************** */
+
+void VirtualMachineManagerDriver::poll_host(int hid, const HostPoll& poll) const
+{
+    ostringstream oss;
+
+    oss << "<VMM_DRIVER_POLL_DATA>"
+        <<   "<HOST_ID>" << hid << "</HOST_ID>"
+        <<   "<HOST>" << one_util::escape_xml(poll.host) << "</HOST>";
+
+    for (unsigned int i = 0; i < poll.oids.size(); i++)
+    {
+        oss << "<VM>"
+            <<   "<ID>" << poll.oids[i] << "</ID>"
+            <<   "<DEPLOY_ID>" << one_util::escape_xml(poll.deploy_ids[i])
+            <<   "</DEPLOY_ID>"
+            << "</VM>";
+    }
+
+    oss << "</VMM_DRIVER_POLL_DATA>";
+
+    write_drv("POLLHOST", hid, oss.str());
+
+    poll_messages.fetch_add(1, std::memory_order_relaxed);
+}
+
+/* ************************************************************************** */
+/* Batched actions                                                            */
+/* ************************************************************************** */
+
+void VirtualMachineManagerDriver::batch_drv(const char * aname, int oid,
+        int hid, const string& host, const string& msg) const
+{
+    if ( !capability("BATCH") )
+    {
+        write_drv(aname, oid, msg);
+
+        if ( strcmp(aname, "POLL") == 0 )
+        {
+            poll_messages.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return;
+    }
+
+    BatchAction action;
+
+    action.name = aname;
+    action.oid  = oid;
+    action.msg  = msg;
+
+    pthread_mutex_lock(&batch_mutex);
+
+    HostBatch& batch = batches[hid];
+
+    batch.host = host;
+    batch.actions.push_back(action);
+
+    if ( batch.actions.size() >= BATCH_MAX_ACTIONS )
+    {
+        write_batch(hid, batch);
+
+        batches.erase(hid);
+    }
+
+    pthread_mutex_unlock(&batch_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void VirtualMachineManagerDriver::flush() const
+{
+    map<int, HostBatch>::iterator it;
+
+    pthread_mutex_lock(&batch_mutex);
+
+    for ( it = batches.begin(); it != batches.end(); ++it )
+    {
+        write_batch(it->first, it->second);
+    }
+
+    batches.clear();
+
+    pthread_mutex_unlock(&batch_mutex);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void VirtualMachineManagerDriver::write_batch(int hid,
+        const HostBatch& batch) const
+{
+    ostringstream os;
+    ostringstream oss;
+
+    vector<BatchAction>::const_iterator it;
+
+    bool poll = false;
+
+    if ( batch.actions.empty() )
+    {
+        return;
+    }
+    else if ( batch.actions.size() == 1 )
+    {
+        const BatchAction& action = batch.actions.front();
+
+        os << action.name << " " << action.oid;
+
+        write(os, action.msg);
+
+        if ( action.name == "POLL" )
+        {
+            poll_messages.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return;
+    }
+
+    oss << "<BATCH>"
+        <<   "<HOST_ID>" << hid << "</HOST_ID>"
+        <<   "<HOST>" << one_util::escape_xml(batch.host) << "</HOST>";
+
+    for ( it = batch.actions.begin(); it != batch.actions.end(); ++it )
+    {
+        oss << "<ACTION>"
+            <<   "<NAME>" << it->name << "</NAME>"
+            <<   "<ID>" << it->oid << "</ID>"
+            <<   it->msg
+            << "</ACTION>";
+
+        poll = poll || it->name == "POLL";
+    }
+
+    oss << "</BATCH>";
+
+    os << "BATCH " << hid;
+
+    write(os, oss.str());
+
+    if ( poll )
+    {
+        poll_messages.fetch_add(1, std::memory_order_relaxed);
+    }
+}
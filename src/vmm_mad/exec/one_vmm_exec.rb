@@ -115,8 +115,8 @@ class VmmAction
     def run(steps, extra_info = nil)
         result = execute_steps(steps)
 
-        @ssh_src.close if @ssh_src
-        @ssh_dst.close if @ssh_dst
+        @vmm.close_ssh_stream(@ssh_src) if @ssh_src
+        @vmm.close_ssh_stream(@ssh_dst) if @ssh_dst
 
         #Prepare the info for the OpenNebula core
         if !extra_info.nil?
@@ -325,6 +325,10 @@ class ExecDriver < VirtualMachineDriver
         super("vmm/#{hypervisor}", @options)
 
         @hypervisor  = hypervisor
+
+        if @options[:poll_host]
+            register_action(ACTION[:poll_host].to_sym, method("poll_host"))
+        end
     end
 
     # Creates an SshStream to execute commands on the target host
@@ -332,11 +336,81 @@ class ExecDriver < VirtualMachineDriver
     # @param[String] id of the VM to log messages
     # @return [SshStreamCommand]
     def get_ssh_stream(aname, host, id)
+        stream = batch_ssh_stream(host, id)
+
+        return stream if stream
+
         SshStreamCommand.new(host,
                             @remote_scripts_base_path,
                             log_method(id), nil, @shell)
     end
 
+    # Closes an SshStream unless it is shared by the actions of a batch
+    # @param[SshStreamCommand] the stream
+    def close_ssh_stream(stream)
+        batch = Thread.current[:vmm_batch]
+
+        stream.close if batch.nil? || !batch[:stream].equal?(stream)
+    end
+
+    # Executes the actions in a remote host reusing the same SshStream
+    def do_action(parameters, id, host, aname, ops={})
+        if !ops[:ssh_stream]
+            stream = batch_ssh_stream(host, id)
+            ops    = ops.merge(:ssh_stream => stream) if stream
+        end
+
+        super(parameters, id, host, aname, ops)
+    end
+
+    #---------------------------------------------------------------------------
+    #  BATCH action, executes the actions for a host with a single connection
+    #---------------------------------------------------------------------------
+    def batch(id, drv_message)
+        xml  = decode(drv_message)
+        host = xml.elements['HOST'].text
+
+        stream = SshStreamCommand.new(host,
+                                      @remote_scripts_base_path,
+                                      nil, nil, @shell)
+
+        Thread.current[:vmm_batch] = { :host => host, :stream => stream }
+
+        begin
+            each_batch_action(drv_message) do |aname, vid, data|
+                send(aname, vid, data)
+            end
+        ensure
+            Thread.current[:vmm_batch][:stream].close
+            Thread.current[:vmm_batch] = nil
+        end
+    end
+
+    # A cancelled action may leave the shared SshStream in the middle of a
+    # command, open a new one for the rest of the batch
+    def batch_action_cancelled(vid)
+        batch = Thread.current[:vmm_batch]
+
+        return if batch.nil?
+
+        batch[:stream].close
+
+        batch[:stream] = SshStreamCommand.new(batch[:host],
+                                              @remote_scripts_base_path,
+                                              nil, nil, @shell)
+    end
+
+    # Returns the SshStream shared by the actions of the batch being
+    # executed by this thread, if the action is for the same host
+    def batch_ssh_stream(host, id)
+        batch = Thread.current[:vmm_batch]
+
+        return nil if batch.nil? || batch[:host] != host
+
+        batch[:stream].logger = log_method(id)
+        batch[:stream]
+    end
+
     #---------------------------------------------------------------------------
     #  Virtual Machine Manager Protocol Actions
     #---------------------------------------------------------------------------
@@ -614,6 +688,46 @@ class ExecDriver < VirtualMachineDriver
         do_action("#{deploy_id} #{host}", id, host, ACTION[:poll])
     end
 
+    #
+    # POLLHOST action, gets information of the VMs of a host with a single
+    # execution of the poll script. Results are sent as POLL messages
+    #
+    def poll_host(id, drv_message)
+        data = decode(drv_message)
+        host = data.elements['HOST'].text
+        vms  = {}
+
+        data.each_element('VM') do |vm|
+            vms[vm.elements['DEPLOY_ID'].text] = vm.elements['ID'].text.to_i
+        end
+
+        # Not associated to a VM, logs are sent to oned.log
+        result, info = do_action("-m #{vms.keys.join(',')}", '-', host,
+                                 ACTION[:poll], :respond => false)
+
+        if DriverExecHelper.failed?(result)
+            vms.each_value do |vid|
+                send_message(ACTION[:poll], result, vid, info)
+            end
+
+            return
+        end
+
+        info.each_line do |line|
+            deploy_id, monitor = line.strip.split(' ', 2)
+            vid = vms.delete(deploy_id)
+
+            next if vid.nil?
+
+            send_message(ACTION[:poll], RESULT[:success], vid, monitor || '-')
+        end
+
+        vms.each_value do |vid|
+            send_message(ACTION[:poll], RESULT[:failure], vid,
+                         "Missing monitoring information")
+        end
+    end
+
     #
     # REBOOT action, reboots a running VM
     #
@@ -1074,6 +1188,13 @@ class ExecDriver < VirtualMachineDriver
 
 private
 
+    def capabilities
+        caps = super
+        caps << "POLLHOST" if @options[:poll_host]
+
+        caps
+    end
+
     def ensure_xpath(xml_data, id, action, xpath)
         begin
             value = xml_data.elements[xpath].text.strip
@@ -1105,7 +1226,8 @@ opts = GetoptLong.new(
     [ '--local',             '-l', GetoptLong::REQUIRED_ARGUMENT ],
     [ '--shell',             '-s', GetoptLong::REQUIRED_ARGUMENT ],
     [ '--parallel',          '-p', GetoptLong::NO_ARGUMENT ],
-    [ '--timeout',           '-w', GetoptLong::OPTIONAL_ARGUMENT ]
+    [ '--timeout',           '-w', GetoptLong::OPTIONAL_ARGUMENT ],
+    [ '--poll-host',         '-m', GetoptLong::NO_ARGUMENT ]
 )
 
 hypervisor         = ''
@@ -1115,6 +1237,7 @@ shell              = 'bash'
 local_actions      = {}
 single_host        = true
 timeout            = nil
+poll_host          = false
 
 begin
     opts.each do |opt, arg|
@@ -1131,6 +1254,8 @@ begin
                 single_host = false
             when '--timeout'
                 timeout = arg.to_i
+            when '--poll-host'
+                poll_host = true
         end
     end
 rescue Exception => e
@@ -1149,6 +1274,7 @@ exec_driver = ExecDriver.new(hypervisor,
                 :local_actions      => local_actions,
                 :shell              => shell,
                 :single_host        => single_host,
-                :timeout            => timeout)
+                :timeout            => timeout,
+                :poll_host          => poll_host)
 
 exec_driver.start_driver
@@ -82,6 +82,26 @@ def print_one_vm_info(hypervisor, vm_id)
     puts values.zip.join(' ')
 end
 
+# Puts to STDOUT a line in the form "DEPLOY_ID VAL1=VAR1 VAL2=VAR2" for each
+# VM with its monitor attributes. VMs not found are reported with STATE=-
+# @param hypervisor [Module]
+# @param vm_ids [Array<String>] with the deploy ids of the VMs
+def print_multiple_vm_info(hypervisor, vm_ids)
+    vms = hypervisor.get_all_vm_info
+
+    exit(-1) if vms.nil?
+
+    vm_ids.each do |vm_id|
+        info = vms[vm_id] || { :state => '-' }
+
+        values = info.map do |key, value|
+            print_data(key, value)
+        end
+
+        puts "#{vm_id} #{values.zip.join(' ')}"
+    end
+end
+
 def print_all_vm_info(hypervisor)
     require 'yaml'
     require 'zlib'